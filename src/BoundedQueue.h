@@ -0,0 +1,204 @@
+#ifndef BOUNDED_QUEUE_H
+#define BOUNDED_QUEUE_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+/// lock-free ring
+
+// Bounded multi-producer / multi-consumer FIFO over a power-of-two ring
+// (Vyukov's design). Every cell carries a sequence number that says whose
+// turn it is: a producer claims a slot with one CAS on the tail counter,
+// writes the value and publishes it by bumping the cell's sequence; a
+// consumer does the same on the head counter. No mutex is taken on either
+// side, so producers firing at the top of the minute never block each other
+// or a consumer. Cells are allocated once, by the first push (racing first
+// pushes settle it with a CAS), so a queue that is never used costs only its
+// counters.
+//
+// tryPush fails when the ring is full rather than growing it.
+// waitPop blocks a consumer until an item arrives or the timeout passes (the
+// WorkerPool's idle workers sleep in it); producers only touch the wake-up
+// mutex when a consumer is actually waiting.
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacityHint) : cells(nullptr), mask(0), head(0), tail(0), waiters(0) {
+        size_t capacity = 2;
+        while (capacity < capacityHint) capacity <<= 1;
+        mask = capacity - 1;
+    }
+
+    ~BoundedQueue() {
+        delete[] cells.load(std::memory_order_relaxed);
+    }
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    bool tryPush(T value) {
+        size_t position;
+        return tryPush(std::move(value), position);
+    }
+
+    // As tryPush, also giving the item's position: how many items were
+    // pushed before it, ever
+    bool tryPush(T value, size_t& position) {
+        Cell* ring = cells.load(std::memory_order_acquire);
+        if (ring == nullptr) {
+            ring = allocate();
+        }
+        position = tail.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = ring[position & mask];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            intptr_t turn = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+            if (turn == 0) {
+                if (tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    cell.value = std::move(value);
+                    cell.sequence.store(position + 1, std::memory_order_release);
+                    wakeConsumer();
+                    return true;
+                }
+            } else if (turn < 0) {
+                return false;   // Full: the cell still holds an unconsumed item
+            } else {
+                position = tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool tryPop(T& out) {
+        Cell* ring = cells.load(std::memory_order_acquire);
+        if (ring == nullptr) {
+            return false;   // Nothing was ever pushed
+        }
+        size_t position = head.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = ring[position & mask];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            intptr_t turn = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position + 1);
+            if (turn == 0) {
+                if (head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    out = std::move(cell.value);
+                    cell.value = T();
+                    cell.sequence.store(position + mask + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (turn < 0) {
+                return false;   // Empty
+            } else {
+                position = head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Pop, sleeping up to timeout for an item to arrive
+    template <typename Rep, typename Period>
+    bool waitPop(T& out, std::chrono::duration<Rep, Period> timeout) {
+        if (tryPop(out)) return true;
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        waiters.fetch_add(1);
+        std::atomic_thread_fence(std::memory_order_seq_cst);    // Pairs with wakeConsumer's
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        bool popped = false;
+        while (!(popped = tryPop(out))) {
+            if (wakeup.wait_until(lock, deadline) == std::cv_status::timeout) {
+                popped = tryPop(out);
+                break;
+            }
+        }
+        waiters.fetch_sub(1);
+        return popped;
+    }
+
+    // Front item without removing it; false when empty. The caller must keep
+    // other consumers out while it reads (a producer cannot touch the cell)
+    bool peek(T& out) const {
+        const Cell* ring = cells.load(std::memory_order_acquire);
+        if (ring == nullptr) return false;
+        size_t position = head.load(std::memory_order_relaxed);
+        const Cell& cell = ring[position & mask];
+        if (cell.sequence.load(std::memory_order_acquire) != position + 1) return false;
+        out = cell.value;
+        return true;
+    }
+
+    // Visit published items front to back. Same rule as peek: no concurrent
+    // consumers; items pushed while this runs may or may not be included.
+    template <typename Visitor>
+    void forEach(Visitor visit) const {
+        const Cell* ring = cells.load(std::memory_order_acquire);
+        if (ring == nullptr) return;
+        size_t end = tail.load(std::memory_order_acquire);
+        for (size_t position = head.load(std::memory_order_relaxed); position != end; position++) {
+            const Cell& cell = ring[position & mask];
+            if (cell.sequence.load(std::memory_order_acquire) != position + 1) break;
+            visit(cell.value);
+        }
+    }
+
+    // Items currently queued (exact when no push/pop is in flight)
+    size_t size() const {
+        size_t popped = head.load(std::memory_order_acquire);
+        size_t pushed = tail.load(std::memory_order_acquire);
+        return pushed > popped ? pushed - popped : 0;
+    }
+
+    bool empty() const { return size() == 0; }
+
+    size_t capacity() const { return mask + 1; }
+
+    // The cells exist (something has been pushed)
+    bool allocated() const { return cells.load(std::memory_order_acquire) != nullptr; }
+
+private:
+    // Counters sit on their own cache lines so producers and consumers do
+    // not false-share
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    std::atomic<Cell*> cells;   // Null until the first push
+    size_t mask;
+    alignas(64) std::atomic<size_t> head;
+    alignas(64) std::atomic<size_t> tail;
+    alignas(64) std::atomic<int> waiters;
+    std::mutex wakeMutex;
+    std::condition_variable wakeup;
+
+    // First push: build the ring; the loser of a race frees its copy
+    Cell* allocate() {
+        Cell* fresh = new Cell[mask + 1];
+        for (size_t i = 0; i <= mask; i++) {
+            fresh[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        Cell* expected = nullptr;
+        if (!cells.compare_exchange_strong(expected, fresh, std::memory_order_acq_rel, std::memory_order_acquire)) {
+            delete[] fresh;
+            return expected;
+        }
+        return fresh;
+    }
+
+    void wakeConsumer() {
+        // Store (publish) then load (waiters) here, store (waiters) then load
+        // (the cell) in waitPop: without a full fence on each side both loads
+        // can see the old values, and the consumer sleeps out its timeout
+        // with an item waiting
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiters.load(std::memory_order_relaxed) > 0) {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            wakeup.notify_all();
+        }
+    }
+};
+
+#endif // BOUNDED_QUEUE_H
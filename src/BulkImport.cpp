@@ -0,0 +1,471 @@
+#include "BulkImport.h"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <fstream>
+
+static const char* const MEDICINE_COLUMNS[] = {"name", "dose", "timings", "category", "stock", "threshold"};
+static const char* const REMINDER_COLUMNS[] = {"medicine", "time"};
+
+enum MedicineColumn { COL_NAME, COL_DOSE, COL_TIMINGS, COL_CATEGORY, COL_STOCK, COL_THRESHOLD };
+enum ReminderColumn { COL_MEDICINE, COL_TIME };
+
+static bool isSpace(char c) {
+    return c == ' ' || c == '\t';
+}
+
+static bool equalsIgnoreCase(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        char x = a[i], y = b[i];
+        if (x >= 'A' && x <= 'Z') x += 'a' - 'A';
+        if (y >= 'A' && y <= 'Z') y += 'a' - 'A';
+        if (x != y) return false;
+    }
+    return true;
+}
+
+// Whole view must be a decimal integer >= minValue
+static bool parseInt(std::string_view text, int& value, int minValue) {
+    if (text.empty()) return false;
+    auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    return result.ec == std::errc() && result.ptr == text.data() + text.size() && value >= minValue;
+}
+
+static void appendUtf8(std::string& out, uint32_t code) {
+    if (code < 0x80) {
+        out += static_cast<char>(code);
+    } else if (code < 0x800) {
+        out += static_cast<char>(0xC0 | (code >> 6));
+        out += static_cast<char>(0x80 | (code & 0x3F));
+    } else if (code < 0x10000) {
+        out += static_cast<char>(0xE0 | (code >> 12));
+        out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (code & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (code >> 18));
+        out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (code & 0x3F));
+    }
+}
+
+static bool readHex4(std::string_view text, size_t at, uint32_t& code) {
+    if (at + 4 > text.size()) return false;
+    auto result = std::from_chars(text.data() + at, text.data() + at + 4, code, 16);
+    return result.ec == std::errc() && result.ptr == text.data() + at + 4;
+}
+
+// Body of a JSON string (between the quotes) with its escapes decoded
+static void unescapeJson(std::string_view text, std::string& out) {
+    out.clear();
+    for (size_t i = 0; i < text.size(); i++) {
+        char c = text[i];
+        if (c != '\\' || i + 1 == text.size()) {
+            out += c;
+            continue;
+        }
+        char e = text[++i];
+        switch (e) {
+        case 'b': out += '\b'; break;
+        case 'f': out += '\f'; break;
+        case 'n': out += '\n'; break;
+        case 'r': out += '\r'; break;
+        case 't': out += '\t'; break;
+        case 'u': {
+            uint32_t code;
+            if (!readHex4(text, i + 1, code)) {
+                out += e;
+                break;
+            }
+            i += 4;
+            uint32_t low;
+            if (code >= 0xD800 && code < 0xDC00 && i + 2 < text.size() && text[i + 1] == '\\' &&
+                text[i + 2] == 'u' && readHex4(text, i + 3, low) && low >= 0xDC00 && low < 0xE000) {
+                code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                i += 6;
+            }
+            appendUtf8(out, code);
+            break;
+        }
+        default: out += e; break;   // \" \\ \/
+        }
+    }
+}
+
+BulkImporter::BulkImporter(MedicineReminderSystem& system, ImportKind kind, ImportFormat format)
+    : system(system), kind(kind), format(format),
+      columnNames(kind == ImportKind::Medicines ? MEDICINE_COLUMNS : REMINDER_COLUMNS),
+      columnCount(kind == ImportKind::Medicines ? 6 : 2), lineNumber(0), headerChecked(false) {
+    for (size_t i = 0; i < columnCount; i++) {
+        csvColumns.push_back(static_cast<int>(i));
+    }
+}
+
+void BulkImporter::feed(const char* data, size_t size) {
+    const char* end = data + size;
+    const char* p = data;
+    if (!carry.empty()) {
+        const char* newline = static_cast<const char*>(std::memchr(p, '\n', size));
+        if (newline == nullptr) {
+            appendCarry(p, size);
+            return;
+        }
+        appendCarry(p, newline - p);
+        parseLine(carry);
+        carry.clear();
+        p = newline + 1;
+    }
+    while (p < end) {
+        const char* newline = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        if (newline == nullptr) {
+            appendCarry(p, end - p);
+            break;
+        }
+        parseLine(std::string_view(p, newline - p));
+        p = newline + 1;
+    }
+}
+
+// Past MAX_LINE_BYTES the rest of the line is dropped; parseLine rejects it
+void BulkImporter::appendCarry(const char* data, size_t size) {
+    carry.append(data, std::min(size, MAX_LINE_BYTES + 1 - std::min(carry.size(), MAX_LINE_BYTES + 1)));
+}
+
+const ImportReport& BulkImporter::finish() {
+    if (!carry.empty()) {
+        parseLine(carry);
+        carry.clear();
+    }
+    flush();
+    return report;
+}
+
+bool BulkImporter::importFile(MedicineReminderSystem& system, ImportKind kind, const std::string& path,
+                              ImportReport& report) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    auto endsWith = [&path](const char* suffix) {
+        size_t length = std::strlen(suffix);
+        return path.size() >= length && equalsIgnoreCase(std::string_view(path).substr(path.size() - length), suffix);
+    };
+    ImportFormat format = endsWith(".ndjson") || endsWith(".jsonl") ? ImportFormat::Ndjson : ImportFormat::Csv;
+
+    BulkImporter importer(system, kind, format);
+    std::vector<char> buffer(CHUNK_BYTES);
+    while (file) {
+        file.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        importer.feed(buffer.data(), static_cast<size_t>(file.gcount()));
+    }
+    report = importer.finish();
+    return true;
+}
+
+void BulkImporter::parseLine(std::string_view line) {
+    lineNumber++;
+    if (!line.empty() && line.back() == '\r') {
+        line.remove_suffix(1);
+    }
+    if (line.empty()) {
+        return;
+    }
+    if (line.size() > MAX_LINE_BYTES) {
+        report.rows++;
+        rowError(lineNumber, "Line too long");
+        return;
+    }
+    if (format == ImportFormat::Csv && !headerChecked) {
+        headerChecked = true;
+        if (readCsvHeader(line)) {
+            return;
+        }
+    }
+
+    report.rows++;
+    Cells cells;
+    std::fill(std::begin(cells.present), std::end(cells.present), false);
+    std::fill(std::begin(cells.escaped), std::end(cells.escaped), false);
+    std::string error;
+    bool split = format == ImportFormat::Csv ? splitCsv(line, cells, error) : splitJson(line, cells, error);
+    if (!split || !buildRow(cells, error)) {
+        rowError(lineNumber, error);
+        return;
+    }
+    rowLines.push_back(lineNumber);
+    if (rowLines.size() >= CHUNK_ROWS) {
+        flush();
+    }
+}
+
+// A first line whose first field is a column name maps columns by name
+bool BulkImporter::readCsvHeader(std::string_view line) {
+    size_t comma = line.find(',');
+    std::string_view first = line.substr(0, comma);
+    while (!first.empty() && (isSpace(first.front()) || first.front() == '"')) first.remove_prefix(1);
+    while (!first.empty() && (isSpace(first.back()) || first.back() == '"')) first.remove_suffix(1);
+    bool named = false;
+    for (size_t i = 0; i < columnCount; i++) {
+        named = named || equalsIgnoreCase(first, columnNames[i]);
+    }
+    if (!named) {
+        return false;
+    }
+
+    csvColumns.clear();
+    size_t start = 0;
+    while (start <= line.size()) {
+        size_t end = std::min(line.find(',', start), line.size());
+        std::string_view name = line.substr(start, end - start);
+        while (!name.empty() && (isSpace(name.front()) || name.front() == '"')) name.remove_prefix(1);
+        while (!name.empty() && (isSpace(name.back()) || name.back() == '"')) name.remove_suffix(1);
+        int column = -1;
+        for (size_t i = 0; i < columnCount; i++) {
+            if (equalsIgnoreCase(name, columnNames[i])) column = static_cast<int>(i);
+        }
+        csvColumns.push_back(column);
+        start = end + 1;
+    }
+    return true;
+}
+
+bool BulkImporter::splitCsv(std::string_view line, Cells& cells, std::string& error) const {
+    size_t pos = 0;
+    for (size_t field = 0; pos <= line.size(); field++) {
+        while (pos < line.size() && isSpace(line[pos])) pos++;
+
+        std::string_view value;
+        bool escaped = false;
+        if (pos < line.size() && line[pos] == '"') {
+            // Quoted: runs to the next lone quote; "" stands for a quote
+            size_t start = ++pos;
+            for (;;) {
+                const char* quote = static_cast<const char*>(std::memchr(line.data() + pos, '"', line.size() - pos));
+                if (quote == nullptr) {
+                    error = "Unterminated quoted field";
+                    return false;
+                }
+                pos = quote - line.data() + 1;
+                if (pos < line.size() && line[pos] == '"') {
+                    escaped = true;
+                    pos++;
+                    continue;
+                }
+                break;
+            }
+            value = line.substr(start, pos - 1 - start);
+            while (pos < line.size() && isSpace(line[pos])) pos++;
+            if (pos < line.size() && line[pos] != ',') {
+                error = "Unexpected text after a quoted field";
+                return false;
+            }
+        } else {
+            const char* comma = static_cast<const char*>(std::memchr(line.data() + pos, ',', line.size() - pos));
+            size_t end = comma != nullptr ? comma - line.data() : line.size();
+            value = line.substr(pos, end - pos);
+            while (!value.empty() && isSpace(value.back())) value.remove_suffix(1);
+            pos = end;
+        }
+        pos++;  // Past the comma (or the end)
+
+        int column = field < csvColumns.size() ? csvColumns[field] : -1;
+        if (column >= 0) {
+            cells.value[column] = value;
+            cells.present[column] = true;
+            cells.escaped[column] = escaped;
+        }
+    }
+    return true;
+}
+
+bool BulkImporter::splitJson(std::string_view line, Cells& cells, std::string& error) const {
+    size_t pos = 0;
+    auto skipSpace = [&]() {
+        while (pos < line.size() && (isSpace(line[pos]) || line[pos] == '\r')) pos++;
+    };
+    // Body of the string starting at pos (on its opening quote)
+    auto readString = [&](std::string_view& out, bool& escaped) {
+        size_t start = ++pos;
+        escaped = false;
+        while (pos < line.size() && line[pos] != '"') {
+            if (line[pos] == '\\') {
+                escaped = true;
+                pos++;
+            }
+            pos++;
+        }
+        if (pos >= line.size()) return false;
+        out = line.substr(start, pos - start);
+        pos++;
+        return true;
+    };
+
+    skipSpace();
+    if (pos >= line.size() || line[pos] != '{') {
+        error = "Expected a JSON object";
+        return false;
+    }
+    pos++;
+    skipSpace();
+    if (pos < line.size() && line[pos] == '}') {
+        pos++;
+    } else {
+        for (;;) {
+            std::string_view key, value;
+            bool keyEscaped, escaped = false, present = true;
+            if (pos >= line.size() || line[pos] != '"' || !readString(key, keyEscaped)) {
+                error = "Expected a quoted key";
+                return false;
+            }
+            skipSpace();
+            if (pos >= line.size() || line[pos] != ':') {
+                error = "Expected ':' after a key";
+                return false;
+            }
+            pos++;
+            skipSpace();
+            if (pos < line.size() && line[pos] == '"') {
+                if (!readString(value, escaped)) {
+                    error = "Unterminated string";
+                    return false;
+                }
+            } else {
+                // Number or literal: up to the next separator
+                size_t start = pos;
+                while (pos < line.size() && line[pos] != ',' && line[pos] != '}' && !isSpace(line[pos])) pos++;
+                value = line.substr(start, pos - start);
+                if (value.empty() || value.front() == '{' || value.front() == '[') {
+                    error = "Values must be strings or numbers";
+                    return false;
+                }
+                present = value != "null";
+            }
+            for (size_t i = 0; i < columnCount; i++) {
+                if (key == columnNames[i]) {
+                    cells.value[i] = value;
+                    cells.present[i] = present;
+                    cells.escaped[i] = escaped;
+                }
+            }
+            skipSpace();
+            if (pos < line.size() && line[pos] == ',') {
+                pos++;
+                skipSpace();
+                continue;
+            }
+            if (pos < line.size() && line[pos] == '}') {
+                pos++;
+                break;
+            }
+            error = "Expected ',' or '}'";
+            return false;
+        }
+    }
+    skipSpace();
+    if (pos != line.size()) {
+        error = "Unexpected text after the object";
+        return false;
+    }
+    return true;
+}
+
+void BulkImporter::assign(const Cells& cells, size_t column, std::string& out) const {
+    if (!cells.present[column]) {
+        out.clear();
+    } else if (!cells.escaped[column]) {
+        out.assign(cells.value[column]);
+    } else if (format == ImportFormat::Ndjson) {
+        unescapeJson(cells.value[column], out);
+    } else {
+        // CSV: "" -> "
+        std::string_view text = cells.value[column];
+        out.clear();
+        for (size_t i = 0; i < text.size(); i++) {
+            out += text[i];
+            if (text[i] == '"' && i + 1 < text.size() && text[i + 1] == '"') i++;
+        }
+    }
+}
+
+bool BulkImporter::buildRow(const Cells& cells, std::string& error) {
+    if (kind == ImportKind::Reminders) {
+        if (!cells.present[COL_MEDICINE] || cells.value[COL_MEDICINE].empty()) {
+            error = "medicine is required";
+            return false;
+        }
+        int minute;
+        ReminderRecord& reminder = reminders.emplace_back();
+        assign(cells, COL_TIME, reminder.time);
+        if (!ReminderNode::parseTime(reminder.time, minute)) {
+            reminders.pop_back();
+            error = "Invalid time (use HH:MM, 00:00-23:59)";
+            return false;
+        }
+        assign(cells, COL_MEDICINE, reminder.medicineName);
+        return true;
+    }
+
+    if (!cells.present[COL_NAME] || cells.value[COL_NAME].empty()) {
+        error = "name is required";
+        return false;
+    }
+    int stock = 0;
+    int threshold = DEFAULT_LOW_STOCK_THRESHOLD;
+    if (cells.present[COL_STOCK] && !cells.value[COL_STOCK].empty() && !parseInt(cells.value[COL_STOCK], stock, 0)) {
+        error = "Invalid stock quantity (must be a non-negative number)";
+        return false;
+    }
+    if (cells.present[COL_THRESHOLD] && !cells.value[COL_THRESHOLD].empty() &&
+        !parseInt(cells.value[COL_THRESHOLD], threshold, 1)) {
+        error = "Invalid threshold (must be a positive number)";
+        return false;
+    }
+    if (medicines.capacity() == 0) {
+        medicines.reserve(CHUNK_ROWS);
+    }
+    MedicineRecord& med = medicines.emplace_back();
+    assign(cells, COL_NAME, med.name);
+    assign(cells, COL_DOSE, med.dose);
+    assign(cells, COL_TIMINGS, med.timings);
+    assign(cells, COL_CATEGORY, med.category);
+    med.stockQuantity = stock;
+    med.lowStockThreshold = threshold;
+    return true;
+}
+
+// Hand the pending rows to the system as one import
+void BulkImporter::flush() {
+    if (rowLines.empty()) {
+        return;
+    }
+    rejected.clear();
+    bool persisted;
+    if (kind == ImportKind::Medicines) {
+        persisted = system.importMedicines(std::move(medicines), rejected);
+        medicines.clear();
+    } else {
+        persisted = system.importReminders(std::move(reminders), rejected);
+        reminders.clear();
+    }
+    if (!persisted) {
+        // The log failed: none of these rows count as imported
+        for (size_t line : rowLines) {
+            rowError(line, "Not saved (the log cannot be written)");
+        }
+        rowLines.clear();
+        return;
+    }
+    report.imported += rowLines.size() - rejected.size();
+    for (size_t index : rejected) {
+        rowError(rowLines[index], kind == ImportKind::Medicines ? "Medicine already exists" : "Invalid time");
+    }
+    rowLines.clear();
+}
+
+void BulkImporter::rowError(size_t line, std::string_view reason) {
+    report.failed++;
+    if (report.errors.size() < MAX_REPORTED_ERRORS) {
+        report.errors.push_back("line " + std::to_string(line) + ": " + std::string(reason));
+    }
+}
@@ -0,0 +1,103 @@
+#ifndef BULK_IMPORT_H
+#define BULK_IMPORT_H
+
+#include "MedicineReminderSystem.h"
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// bulk import
+
+enum class ImportKind { Medicines, Reminders };
+enum class ImportFormat { Csv, Ndjson };
+
+struct ImportReport {
+    size_t rows = 0;        // Data rows seen (header and blank lines not counted)
+    size_t imported = 0;
+    size_t failed = 0;
+    std::vector<std::string> errors;    // "line N: reason", the first MAX_REPORTED_ERRORS
+};
+
+// Streaming importer for medicine formularies and reminder sets.
+//
+// Input is fed in chunks of any size; complete lines are parsed as they
+// arrive and a partial last line is carried over to the next chunk, so a
+// file of any length goes through a fixed amount of memory. Rows are parsed
+// in place (fields are views into the chunk; only the record's own strings
+// are built) and handed to the system CHUNK_ROWS at a time, each batch one
+// lock hold and one log record (MedicineReminderSystem::importMedicines).
+//
+// Columns: medicines name, dose, timings, category, stock, threshold (name
+// required, stock defaults to 0 and threshold to the usual default);
+// reminders medicine, time.
+//   CSV: one row per line, RFC 4180 quoting within the line ("08:00,20:00",
+//   "" for a quote). A first line naming the columns maps them by name, in
+//   any order, unknown ones ignored; without it they are read in the order
+//   above.
+//   NDJSON: one flat JSON object per line, keys as the column names; stock
+//   and threshold may be numbers or numeric strings.
+// A row that does not parse, fails validation or is refused (duplicate
+// name, or the log cannot be written) is counted and reported by line
+// number; the rest still go in.
+class BulkImporter {
+public:
+    static const size_t CHUNK_ROWS = 65536;
+    static const size_t CHUNK_BYTES = 1 << 20;     // Read size for importFile
+    static const size_t MAX_REPORTED_ERRORS = 100;
+    static const size_t MAX_LINE_BYTES = 1 << 16;
+
+    BulkImporter(MedicineReminderSystem& system, ImportKind kind, ImportFormat format);
+
+    // Parse every complete line in data; the tail is kept for the next call
+    void feed(const char* data, size_t size);
+
+    // Parse the last line, hand over the remaining rows and return the totals
+    const ImportReport& finish();
+
+    // Import a whole file, CHUNK_BYTES at a time. NDJSON for .ndjson / .jsonl,
+    // CSV otherwise. False if the file cannot be opened
+    static bool importFile(MedicineReminderSystem& system, ImportKind kind, const std::string& path,
+                           ImportReport& report);
+
+private:
+    static const size_t MAX_COLUMNS = 6;
+
+    // One row's fields as views into the line; escaped fields still hold
+    // their quoting ("" in CSV, backslashes in JSON)
+    struct Cells {
+        std::string_view value[MAX_COLUMNS];
+        bool present[MAX_COLUMNS];
+        bool escaped[MAX_COLUMNS];
+    };
+
+    MedicineReminderSystem& system;
+    ImportKind kind;
+    ImportFormat format;
+    const char* const* columnNames;
+    size_t columnCount;
+
+    std::string carry;              // Partial line from the previous chunk
+    size_t lineNumber;
+    bool headerChecked;             // CSV: first line looked at
+    std::vector<int> csvColumns;    // CSV position -> column, -1 to ignore
+
+    std::vector<MedicineRecord> medicines;
+    std::vector<ReminderRecord> reminders;
+    std::vector<size_t> rowLines;   // Line of each pending row
+    std::vector<size_t> rejected;
+
+    ImportReport report;
+
+    void appendCarry(const char* data, size_t size);
+    void parseLine(std::string_view line);
+    bool splitCsv(std::string_view line, Cells& cells, std::string& error) const;
+    bool splitJson(std::string_view line, Cells& cells, std::string& error) const;
+    bool readCsvHeader(std::string_view line);
+    bool buildRow(const Cells& cells, std::string& error);
+    void assign(const Cells& cells, size_t column, std::string& out) const;
+    void flush();
+    void rowError(size_t line, std::string_view reason);
+};
+
+#endif // BULK_IMPORT_H
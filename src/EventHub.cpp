@@ -0,0 +1,55 @@
+#include "EventHub.h"
+#include <algorithm>
+
+EventHub::EventHub(size_t maxBufferedBytes) : maxBuffered(maxBufferedBytes), evicted(0) {}
+
+void EventHub::publish(std::string_view event, std::string_view data) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (subscribers.empty()) {
+        return;
+    }
+    frame.assign("event: ").append(event).append("\ndata: ").append(data).append("\n\n");
+
+    for (const std::shared_ptr<Subscriber>& subscriber : subscribers) {
+        bool wasIdle;
+        {
+            std::lock_guard<std::mutex> subscriberLock(subscriber->mutex);
+            if (subscriber->evicted) {
+                continue;
+            }
+            wasIdle = subscriber->pending.empty();
+            if (subscriber->pending.size() + frame.size() > maxBuffered) {
+                // Too far behind: drop what it has not read and let it reconnect
+                subscriber->evicted = true;
+                subscriber->pending.clear();
+                subscriber->pending.shrink_to_fit();
+                evicted.fetch_add(1, std::memory_order_relaxed);
+                wasIdle = true;
+            } else {
+                subscriber->pending += frame;
+            }
+        }
+        // Only the first frame since the connection last drained needs a wake
+        if (wasIdle) {
+            subscriber->wake();
+        }
+    }
+}
+
+std::shared_ptr<EventHub::Subscriber> EventHub::subscribe(std::function<void()> wake) {
+    std::shared_ptr<Subscriber> subscriber = std::make_shared<Subscriber>();
+    subscriber->wake = std::move(wake);
+    std::lock_guard<std::mutex> lock(mutex);
+    subscribers.push_back(subscriber);
+    return subscriber;
+}
+
+void EventHub::unsubscribe(const std::shared_ptr<Subscriber>& subscriber) {
+    std::lock_guard<std::mutex> lock(mutex);
+    subscribers.erase(std::remove(subscribers.begin(), subscribers.end(), subscriber), subscribers.end());
+}
+
+size_t EventHub::subscriberCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return subscribers.size();
+}
@@ -0,0 +1,58 @@
+#ifndef EVENT_HUB_H
+#define EVENT_HUB_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// server-sent events
+
+// Fan-out channel behind a Server-Sent Events endpoint. A handler answers
+// with HttpResponse::stream set to the hub; the connection then stays open
+// and every event published afterwards is written to it.
+//
+// publish() formats the frame once and appends it to each subscriber's own
+// buffer, then wakes the I/O thread that owns the connection; it never
+// touches a socket, so publishers (request threads, the reminder dispatcher)
+// are not held up by slow clients. A client whose unsent backlog passes
+// maxBufferedBytes is evicted: its buffer is dropped and the connection
+// closed, and EventSource reconnects it to the live stream.
+class EventHub {
+public:
+    struct Subscriber {
+        std::mutex mutex;
+        std::string pending;            // Frames not yet handed to the connection
+        bool evicted = false;
+        std::function<void()> wake;     // Called (under the hub lock) when pending gains data
+    };
+
+    explicit EventHub(size_t maxBufferedBytes = 256 << 10);
+
+    // Queue "event: <event>\ndata: <data>\n\n" for every subscriber. data
+    // must be a single line (JSON is)
+    void publish(std::string_view event, std::string_view data);
+
+    // Register a connection; wake may run on any thread. After unsubscribe
+    // returns, wake is no longer called
+    std::shared_ptr<Subscriber> subscribe(std::function<void()> wake);
+    void unsubscribe(const std::shared_ptr<Subscriber>& subscriber);
+
+    size_t maxBufferedBytes() const { return maxBuffered; }
+    size_t subscriberCount() const;
+    uint64_t evictedCount() const { return evicted.load(std::memory_order_relaxed); }
+
+private:
+    size_t maxBuffered;
+    mutable std::mutex mutex;
+    std::vector<std::shared_ptr<Subscriber>> subscribers;
+    std::string frame;                  // Reused across publishes (guarded by mutex)
+    std::atomic<uint64_t> evicted;
+};
+
+#endif // EVENT_HUB_H
@@ -0,0 +1,155 @@
+#include "HttpParser.h"
+#include <algorithm>
+#include <cstring>
+
+static bool equalsIgnoreCase(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        char x = a[i], y = b[i];
+        if (x >= 'A' && x <= 'Z') x += 'a' - 'A';
+        if (y >= 'A' && y <= 'Z') y += 'a' - 'A';
+        if (x != y) return false;
+    }
+    return true;
+}
+
+std::string_view HttpRequest::header(std::string_view name) const {
+    for (const HttpHeader& h : headers) {
+        if (equalsIgnoreCase(h.name, name)) {
+            return h.value;
+        }
+    }
+    return {};
+}
+
+bool HttpRequest::keepAlive() const {
+    std::string_view connection = header("Connection");
+    if (equalsIgnoreCase(connection, "close")) return false;
+    if (equalsIgnoreCase(connection, "keep-alive")) return true;
+    return version == "HTTP/1.1";
+}
+
+/// HttpParser
+
+HttpParser::HttpParser() : maxBodyBytes(1 << 20), maxUploadBytes(0) {
+    reset();
+}
+
+void HttpParser::reset() {
+    scanPos = 0;
+    requestLineDone = false;
+    headersDone = false;
+    method = target = version = Span{0, 0};
+    headerNames.clear();
+    headerValues.clear();
+    bodyStart = 0;
+    contentLength = 0;
+    bodyLimit = maxBodyBytes;
+    error = nullptr;
+}
+
+HttpParser::Status HttpParser::fail(const char* status) {
+    error = status;
+    return Status::Error;
+}
+
+bool HttpParser::parseRequestLine(const char* line, size_t offset, size_t length) {
+    // METHOD SP TARGET SP VERSION
+    const char* sp1 = static_cast<const char*>(std::memchr(line, ' ', length));
+    if (sp1 == nullptr) return false;
+    size_t methodLen = sp1 - line;
+    const char* rest = sp1 + 1;
+    const char* sp2 = static_cast<const char*>(std::memchr(rest, ' ', length - methodLen - 1));
+    if (sp2 == nullptr || methodLen == 0 || sp2 == rest) return false;
+
+    method = Span{offset, methodLen};
+    target = Span{offset + methodLen + 1, static_cast<size_t>(sp2 - rest)};
+    version = Span{offset + (sp2 + 1 - line), length - (sp2 + 1 - line)};
+
+    std::string_view path(rest, sp2 - rest);
+    path = path.substr(0, path.find('?'));
+    bool upload = std::find(uploadPaths.begin(), uploadPaths.end(), path) != uploadPaths.end();
+    bodyLimit = upload ? std::max(maxBodyBytes, maxUploadBytes) : maxBodyBytes;
+    return version.length >= 8 && std::memcmp(sp2 + 1, "HTTP/1.", 7) == 0;
+}
+
+bool HttpParser::parseHeaderLine(const char* line, size_t offset, size_t length) {
+    const char* colon = static_cast<const char*>(std::memchr(line, ':', length));
+    if (colon == nullptr || colon == line) return false;
+    size_t nameLen = colon - line;
+
+    size_t valueStart = nameLen + 1;
+    while (valueStart < length && (line[valueStart] == ' ' || line[valueStart] == '\t')) valueStart++;
+    size_t valueEnd = length;
+    while (valueEnd > valueStart && (line[valueEnd - 1] == ' ' || line[valueEnd - 1] == '\t')) valueEnd--;
+
+    headerNames.push_back(Span{offset, nameLen});
+    headerValues.push_back(Span{offset + valueStart, valueEnd - valueStart});
+
+    std::string_view name(line, nameLen);
+    std::string_view value(line + valueStart, valueEnd - valueStart);
+    if (equalsIgnoreCase(name, "Content-Length")) {
+        if (value.empty()) return false;
+        size_t parsed = 0;
+        for (char c : value) {
+            if (c < '0' || c > '9' || parsed > bodyLimit) return false;
+            parsed = parsed * 10 + (c - '0');
+        }
+        contentLength = parsed;
+    } else if (equalsIgnoreCase(name, "Transfer-Encoding")) {
+        error = "501 Not Implemented"; // Only Content-Length framed bodies are supported
+        return false;
+    }
+    return true;
+}
+
+HttpParser::Status HttpParser::parse(std::string_view buffer, size_t start, HttpRequest& request) {
+    const char* base = buffer.data() + start;
+    size_t available = buffer.size() - start;
+
+    while (!headersDone) {
+        const char* lineStart = base + scanPos;
+        const char* newline = static_cast<const char*>(std::memchr(lineStart, '\n', available - scanPos));
+        if (newline == nullptr) {
+            return Status::NeedMore;
+        }
+
+        size_t offset = scanPos;
+        size_t length = newline - lineStart;
+        if (length > 0 && lineStart[length - 1] == '\r') length--;
+        scanPos = newline - base + 1;
+
+        if (!requestLineDone) {
+            if (length == 0) continue; // Tolerate stray CRLF between pipelined requests
+            if (!parseRequestLine(lineStart, offset, length)) return fail("400 Bad Request");
+            requestLineDone = true;
+        } else if (length == 0) {
+            headersDone = true;
+            bodyStart = scanPos;
+        } else if (!parseHeaderLine(lineStart, offset, length)) {
+            return fail(error ? error : "400 Bad Request");
+        }
+    }
+
+    if (contentLength > bodyLimit) {
+        return fail("413 Payload Too Large");
+    }
+    if (available < bodyStart + contentLength) {
+        return Status::NeedMore;
+    }
+
+    // Whole request is buffered: hand out views
+    auto view = [base](const Span& span) { return std::string_view(base + span.offset, span.length); };
+    request.method = view(method);
+    request.target = view(target);
+    request.version = view(version);
+    size_t question = request.target.find('?');
+    request.path = request.target.substr(0, question);
+    request.query = question == std::string_view::npos ? std::string_view() : request.target.substr(question + 1);
+    request.headers.clear();
+    for (size_t i = 0; i < headerNames.size(); i++) {
+        request.headers.push_back(HttpHeader{view(headerNames[i]), view(headerValues[i])});
+    }
+    request.body = std::string_view(base + bodyStart, contentLength);
+    return Status::Complete;
+}
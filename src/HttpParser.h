@@ -0,0 +1,87 @@
+#ifndef HTTP_PARSER_H
+#define HTTP_PARSER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct HttpHeader {
+    std::string_view name;
+    std::string_view value;
+};
+
+// A parsed request. Every field is a view into the connection's read buffer,
+// so it is only valid until the handler returns.
+struct HttpRequest {
+    std::string_view method;
+    std::string_view target;    // As sent: path plus optional ?query
+    std::string_view path;
+    std::string_view query;     // Without the leading '?'
+    std::string_view version;
+    std::vector<HttpHeader> headers;
+    std::string_view body;
+
+    // Case-insensitive header lookup; empty view when absent
+    std::string_view header(std::string_view name) const;
+
+    // HTTP/1.1 is persistent unless the client says close; HTTP/1.0 only on request
+    bool keepAlive() const;
+};
+
+/// incremental request parser
+
+// Parses one request at a time out of a growing buffer. Progress is kept as
+// offsets relative to the start of the request, so the caller may append to
+// (and reallocate) the buffer between calls and nothing is rescanned.
+// Algorithm: request line and headers are consumed line by line as their CRLF
+// arrives; once the blank line is seen the body is complete as soon as
+// Content-Length bytes are buffered.
+class HttpParser {
+public:
+    enum class Status { NeedMore, Complete, Error };
+
+    HttpParser();
+
+    // Continue parsing the request that starts at buffer[start]. On Complete,
+    // request is filled in and consumed() is the full request length.
+    Status parse(std::string_view buffer, size_t start, HttpRequest& request);
+
+    // Total bytes of the completed request (headers + body)
+    size_t consumed() const { return bodyStart + contentLength; }
+
+    // Size the whole request will need once the headers are in, 0 before that
+    size_t expectedLength() const { return headersDone ? consumed() : 0; }
+
+    // HTTP status line for the last Error ("400 Bad Request", ...)
+    const char* errorStatus() const { return error; }
+
+    // Forget the current request (call after Complete)
+    void reset();
+
+    size_t maxBodyBytes;
+    // Requests for these paths (bulk uploads) may carry up to maxUploadBytes instead
+    std::vector<std::string> uploadPaths;
+    size_t maxUploadBytes;
+
+private:
+    struct Span {
+        size_t offset;
+        size_t length;
+    };
+
+    size_t scanPos;         // Next unscanned byte, relative to request start
+    bool requestLineDone;
+    bool headersDone;
+    Span method, target, version;
+    std::vector<Span> headerNames, headerValues;
+    size_t bodyStart;
+    size_t contentLength;
+    size_t bodyLimit;       // maxBodyBytes, or maxUploadBytes for an upload path
+    const char* error;
+
+    Status fail(const char* status);
+    bool parseRequestLine(const char* line, size_t offset, size_t length);
+    bool parseHeaderLine(const char* line, size_t offset, size_t length);
+};
+
+#endif // HTTP_PARSER_H
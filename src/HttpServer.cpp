@@ -0,0 +1,841 @@
+#include "HttpServer.h"
+
+#ifdef _WIN32
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/select.h>
+#endif
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#define USE_EPOLL 1
+#ifndef EPOLLEXCLUSIVE
+#define EPOLLEXCLUSIVE (1u << 28)
+#endif
+#endif
+
+#include <iostream>
+#include <csignal>
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <unordered_set>
+#include <chrono>
+
+void closeSocket(socket_t sock) {
+#ifdef _WIN32
+    closesocket(sock);
+#else
+    close(sock);
+#endif
+}
+
+bool startupSockets() {
+#ifdef _WIN32
+    WSADATA wsaData;
+    return WSAStartup(MAKEWORD(2, 2), &wsaData) == 0;
+#else
+    signal(SIGPIPE, SIG_IGN); // A client hanging up mid-response must not kill the server
+    return true;
+#endif
+}
+
+void cleanupSockets() {
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+/// stop signals
+
+static std::atomic<bool> stopSignalled{false};
+#ifdef USE_EPOLL
+static int stopSignalFd = -1;   // Readable once a stop signal came; never drained, so every loop sees it
+#endif
+
+static void onStopSignal(int) {
+    // Async-signal-safe only: a lock-free store and a write()
+    stopSignalled.store(true);
+#ifdef USE_EPOLL
+    uint64_t one = 1;
+    if (write(stopSignalFd, &one, sizeof(one)) < 0) {
+        // Counter full: already signalled
+    }
+#endif
+}
+
+void stopOnSignals() {
+#ifdef USE_EPOLL
+    if (stopSignalFd < 0) {
+        stopSignalFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    }
+#endif
+    signal(SIGINT, onStopSignal);
+    signal(SIGTERM, onStopSignal);
+}
+
+/// HttpConnection
+
+static long long nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+HttpConnection::HttpConnection(socket_t fd, const ServerConfig& config, const RequestHandler& handler)
+    : fd(fd), state(State::Reading), outOffset(0), requestsServed(0), lastActivityMs(nowMs()),
+      config(config), handler(handler), pendingKeepAlive(false) {
+    parser.maxBodyBytes = config.maxRequestBytes;
+    parser.uploadPaths = config.uploadPaths;
+    parser.maxUploadBytes = config.maxUploadBytes;
+}
+
+HttpConnection::~HttpConnection() {
+    if (subscriber) {
+        streamHub->unsubscribe(subscriber);
+    }
+    if (pending) {
+        std::lock_guard<std::mutex> lock(pending->mutex);
+        pending->wake = nullptr;
+    }
+}
+
+void HttpConnection::queueResponse(const HttpResponse& response, bool keepAlive) {
+    const std::string& body = response.sharedBody ? *response.sharedBody : response.body;
+    outBuffer += "HTTP/1.1 ";
+    outBuffer += response.status;
+    outBuffer += "\r\nContent-Type: ";
+    outBuffer += response.contentType;
+    outBuffer += "\r\n";
+    if (response.status.compare(0, 3, "304") != 0) {
+        outBuffer += "Content-Length: ";
+        outBuffer += std::to_string(body.size());
+        outBuffer += "\r\n";
+    }
+    outBuffer += response.headers;
+    if (keepAlive) {
+        outBuffer += "Connection: keep-alive\r\nKeep-Alive: timeout=";
+        outBuffer += std::to_string(config.keepAliveTimeoutMs / 1000);
+        outBuffer += ", max=";
+        outBuffer += std::to_string(config.maxRequestsPerConnection - requestsServed);
+        outBuffer += "\r\n\r\n";
+    } else {
+        outBuffer += "Connection: close\r\n\r\n";
+    }
+    outBuffer += body;
+}
+
+void HttpConnection::startStream(const HttpResponse& response) {
+    // No Content-Length: the stream runs until the connection closes
+    outBuffer += "HTTP/1.1 ";
+    outBuffer += response.status;
+    outBuffer += "\r\nContent-Type: ";
+    outBuffer += response.contentType;
+    outBuffer += "\r\n";
+    outBuffer += response.headers;
+    outBuffer += "Connection: keep-alive\r\n\r\n";
+    outBuffer += response.body;
+    streamHub = response.stream;
+    subscriber = streamHub->subscribe(wake);
+    state = State::Streaming;
+}
+
+void HttpConnection::drainEvents() {
+    if (state != State::Streaming) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(subscriber->mutex);
+    if (subscriber->evicted ||
+        outBuffer.size() - outOffset + subscriber->pending.size() > streamHub->maxBufferedBytes()) {
+        // Slow consumer: it would only fall further behind
+        subscriber->evicted = true;
+        state = State::Closed;
+        return;
+    }
+    if (outBuffer.empty()) {
+        outBuffer.swap(subscriber->pending);    // The drained buffer goes back for reuse
+    } else {
+        outBuffer += subscriber->pending;
+        subscriber->pending.clear();
+    }
+}
+
+void HttpConnection::queueHeartbeat() {
+    if (state == State::Streaming) {
+        outBuffer += ": ping\n\n";
+    }
+}
+
+void HttpConnection::queueError(const std::string& status) {
+    HttpResponse response;
+    response.status = status;
+    response.contentType = "text/plain";
+    queueResponse(response, false);
+    inBuffer.clear();
+    state = State::Writing;
+}
+
+static const size_t READ_CHUNK = 16384;
+
+char* HttpConnection::readSpace(size_t& capacity) {
+    const size_t MAX_CHUNK = 256 * 1024;
+    size_t wanted = READ_CHUNK;
+    size_t expected = parser.expectedLength();
+    if (expected > inBuffer.size()) {
+        // Large body: allocate it once and receive the rest in place
+        inBuffer.reserve(expected);
+        wanted = std::min(std::max(expected - inBuffer.size(), READ_CHUNK), MAX_CHUNK);
+    }
+    capacity = wanted;
+    return inBuffer.space(wanted);
+}
+
+void HttpConnection::commitRead(size_t length) {
+    inBuffer.commit(length);
+    if (state != State::Reading) {
+        inBuffer.clear(); // Final response queued or streaming: ignore anything after it
+        return;
+    }
+    if (length == 0) {
+        return;
+    }
+    lastActivityMs = nowMs();
+    answerRequests();
+}
+
+void HttpConnection::answerRequests() {
+    // Every complete request in the buffer, in order (pipelining)
+    size_t offset = 0;
+    while (state == State::Reading && !pending) {
+        HttpParser::Status status = parser.parse(inBuffer, offset, request);
+        if (status == HttpParser::Status::NeedMore) {
+            if (parser.expectedLength() == 0 && inBuffer.size() - offset > config.maxRequestBytes) {
+                queueError("413 Payload Too Large"); // Header block never ends
+            }
+            break;
+        }
+        if (status == HttpParser::Status::Error) {
+            queueError(parser.errorStatus());
+            break;
+        }
+
+        requestsServed++;
+        bool keepAlive = request.keepAlive() && requestsServed < config.maxRequestsPerConnection;
+        HttpResponse response = handler(request);
+        offset += parser.consumed();
+        parser.reset();
+        answer(response, keepAlive);
+    }
+
+    if (state != State::Reading) {
+        inBuffer.clear();
+    } else if (offset > 0) {
+        inBuffer.consume(offset); // Only a partial pipelined request is left to move
+    }
+    inBuffer.trim(READ_CHUNK);    // An upload's buffer goes once it has been answered
+}
+
+void HttpConnection::answer(HttpResponse& response, bool keepAlive) {
+    if (response.pending) {
+        pending = std::move(response.pending);
+        pendingKeepAlive = keepAlive;
+        {
+            std::lock_guard<std::mutex> lock(pending->mutex);
+            pending->wake = wake;
+        }
+        takePending();      // It may have completed already
+    } else if (response.stream) {
+        startStream(response);
+    } else {
+        queueResponse(response, keepAlive);
+        if (!keepAlive) {
+            state = State::Writing;
+        }
+    }
+}
+
+bool HttpConnection::takePending() {
+    HttpResponse response;
+    {
+        std::lock_guard<std::mutex> lock(pending->mutex);
+        if (!pending->done) {
+            return false;
+        }
+        response = std::move(pending->response);
+        pending->wake = nullptr;
+    }
+    pending.reset();
+    response.pending.reset();   // One wait per request
+    answer(response, pendingKeepAlive);
+    return true;
+}
+
+bool HttpConnection::resume() {
+    if (!pending || !takePending()) {
+        return false;
+    }
+    lastActivityMs = nowMs();
+    if (state == State::Reading) {
+        answerRequests();   // Pipelined behind it
+    } else {
+        inBuffer.clear();
+    }
+    return true;
+}
+
+void PendingResponse::complete(HttpResponse result) {
+    std::lock_guard<std::mutex> lock(mutex);
+    response = std::move(result);
+    done = true;
+    // Under the lock: the connection clears wake there before it goes away
+    if (wake) {
+        wake();
+    }
+}
+
+void HttpConnection::onPeerClosed() {
+    if (state == State::Reading) {
+        // Still send whatever was answered before the client half-closed
+        state = hasPendingOutput() ? State::Writing : State::Closed;
+    } else if (state == State::Streaming) {
+        state = State::Closed;
+    }
+}
+
+void HttpConnection::onFlushed() {
+    outBuffer.clear();
+    outOffset = 0;
+    lastActivityMs = nowMs();
+    if (state == State::Writing) {
+        state = State::Closed;
+    }
+}
+
+/// HttpServer
+
+struct HttpServer::EventLoop {
+    std::thread thread;
+#ifdef USE_EPOLL
+    int epollFd = -1;
+    int wakeFd = -1;
+    std::atomic<bool> wakePending{false};           // wakeFd already written, loop not yet woken
+    std::unordered_set<HttpConnection*> connections;
+    std::unordered_set<HttpConnection*> streams;    // The Streaming ones among connections
+    std::unordered_set<HttpConnection*> waiting;    // The ones waiting on a PendingResponse
+#else
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<socket_t> pending;
+#endif
+};
+
+HttpServer::HttpServer(const ServerConfig& config, RequestHandler handler)
+    : config(config), handler(std::move(handler)), listenSocket(INVALID_SOCKET),
+      running(false), activeConnections(0) {}
+
+HttpServer::~HttpServer() {
+    stop();
+    if (listenSocket != INVALID_SOCKET) {
+        closeSocket(listenSocket);
+    }
+}
+
+int HttpServer::threadCount() const {
+    if (config.ioThreads > 0) {
+        return config.ioThreads;
+    }
+    int cores = static_cast<int>(std::thread::hardware_concurrency());
+    return std::max(1, std::min(cores, 8));
+}
+
+bool HttpServer::start() {
+    listenSocket = socket(AF_INET, SOCK_STREAM, 0);
+    if (listenSocket == INVALID_SOCKET) {
+        std::cerr << "Failed to create socket\n";
+        return false;
+    }
+
+    int opt = 1;
+#ifdef _WIN32
+    setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, (const char*)&opt, sizeof(opt));
+#else
+    setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+#endif
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = INADDR_ANY;
+    address.sin_port = htons(static_cast<unsigned short>(config.port));
+
+    if (bind(listenSocket, (sockaddr*)&address, sizeof(address)) == SOCKET_ERROR) {
+        std::cerr << "Bind failed\n";
+        return false;
+    }
+
+    if (listen(listenSocket, SOMAXCONN) == SOCKET_ERROR) {
+        std::cerr << "Listen failed\n";
+        return false;
+    }
+
+#ifdef USE_EPOLL
+    fcntl(listenSocket, F_SETFL, fcntl(listenSocket, F_GETFL, 0) | O_NONBLOCK);
+#endif
+    return true;
+}
+
+bool HttpServer::admitConnection() {
+    if (activeConnections.fetch_add(1) >= config.maxConnections) {
+        activeConnections.fetch_sub(1);
+        return false;
+    }
+    return true;
+}
+
+void HttpServer::releaseConnection() {
+    activeConnections.fetch_sub(1);
+}
+
+void HttpServer::run() {
+    running = true;
+    int count = threadCount();
+    for (int i = 0; i < count; i++) {
+        loops.push_back(std::unique_ptr<EventLoop>(new EventLoop()));
+    }
+
+#ifdef USE_EPOLL
+    for (auto& loop : loops) {
+        loop->epollFd = epoll_create1(EPOLL_CLOEXEC);
+        loop->wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+        // Level-triggered + exclusive: one thread wakes per incoming burst
+        epoll_event listenEvent{};
+        listenEvent.events = EPOLLIN | EPOLLEXCLUSIVE;
+        listenEvent.data.ptr = nullptr;
+        epoll_ctl(loop->epollFd, EPOLL_CTL_ADD, listenSocket, &listenEvent);
+
+        epoll_event wakeEvent{};
+        wakeEvent.events = EPOLLIN;
+        wakeEvent.data.ptr = &loop->wakeFd;
+        epoll_ctl(loop->epollFd, EPOLL_CTL_ADD, loop->wakeFd, &wakeEvent);
+
+        if (stopSignalFd >= 0) {
+            epoll_event stopEvent{};
+            stopEvent.events = EPOLLIN;
+            stopEvent.data.ptr = &stopSignalFd;
+            epoll_ctl(loop->epollFd, EPOLL_CTL_ADD, stopSignalFd, &stopEvent);
+        }
+    }
+    for (auto& loop : loops) {
+        EventLoop* raw = loop.get();
+        loop->thread = std::thread([this, raw] { runLoop(*raw); });
+    }
+#else
+    for (auto& loop : loops) {
+        EventLoop* raw = loop.get();
+        loop->thread = std::thread([this, raw] { runLoop(*raw); });
+    }
+    size_t next = 0;
+    while (running) {
+        if (stopSignalled) {
+            stop();
+            break;
+        }
+        // Look up at least once a second for stop() or a stop signal
+        fd_set readable;
+        FD_ZERO(&readable);
+        FD_SET(listenSocket, &readable);
+        timeval wait{1, 0};
+        if (select(static_cast<int>(listenSocket) + 1, &readable, nullptr, nullptr, &wait) <= 0) {
+            continue;
+        }
+        socket_t clientSocket = accept(listenSocket, nullptr, nullptr);
+        if (clientSocket == INVALID_SOCKET) {
+            continue;
+        }
+        if (!admitConnection()) {
+            closeSocket(clientSocket);
+            continue;
+        }
+        EventLoop& loop = *loops[next++ % loops.size()];
+        {
+            std::lock_guard<std::mutex> lock(loop.mutex);
+            loop.pending.push_back(clientSocket);
+        }
+        loop.ready.notify_one();
+    }
+#endif
+
+    for (auto& loop : loops) {
+        if (loop->thread.joinable()) {
+            loop->thread.join();
+        }
+    }
+}
+
+void HttpServer::stop() {
+    if (!running.exchange(false)) {
+        return;
+    }
+    for (auto& loop : loops) {
+#ifdef USE_EPOLL
+        uint64_t one = 1;
+        if (write(loop->wakeFd, &one, sizeof(one)) < 0) {
+            // Loop will still notice on its next timeout
+        }
+#else
+        loop->ready.notify_all();
+#endif
+    }
+}
+
+#ifdef USE_EPOLL
+
+void HttpServer::runLoop(EventLoop& loop) {
+    const int MAX_EVENTS = 256;
+    epoll_event events[MAX_EVENTS];
+    long long lastSweepMs = nowMs();
+
+    while (running) {
+        int n = epoll_wait(loop.epollFd, events, MAX_EVENTS, 1000);
+        bool woken = false;
+        for (int i = 0; i < n; i++) {
+            void* tag = events[i].data.ptr;
+            if (tag == nullptr) {
+                acceptAll(loop);
+                continue;
+            }
+            if (tag == &stopSignalFd) {
+                stop();     // This loop ends after the batch; stop() wakes the others
+                continue;
+            }
+            if (tag == &loop.wakeFd) {
+                uint64_t value;
+                while (read(loop.wakeFd, &value, sizeof(value)) > 0) {}
+                loop.wakePending.store(false);
+                woken = true;
+                continue;
+            }
+
+            HttpConnection* conn = static_cast<HttpConnection*>(tag);
+            if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+                readAll(loop, conn);
+            }
+            if (conn->state != HttpConnection::State::Closed && (events[i].events & EPOLLOUT)) {
+                flush(loop, conn);
+                // Reading may have paused on the output cap; resume now that it drained
+                if (!conn->hasPendingOutput() && conn->canRead()) {
+                    readAll(loop, conn);
+                }
+            }
+            if (conn->state == HttpConnection::State::Closed) {
+                closeConnection(loop, conn);
+            } else if (conn->state == HttpConnection::State::Streaming && loop.streams.insert(conn).second) {
+                // Just became a stream: events may already be waiting
+                setsockopt(conn->fd, SOL_SOCKET, SO_SNDBUF, &config.streamSocketBuffer, sizeof(config.streamSocketBuffer));
+                woken = true;
+            } else if (conn->isWaiting()) {
+                loop.waiting.insert(conn);
+            }
+        }
+
+        // Inside the batch a connection is only closed while its own event
+        // is handled, and epoll reports each fd at most once per wait, so no
+        // later entry in the array points at a deleted connection. Closes
+        // caused by anything else (streams, resumed answers, the idle sweep)
+        // happen here, after the batch
+        if (woken) {
+            resumeWaiting(loop);
+            drainStreams(loop);
+        }
+        if (nowMs() - lastSweepMs >= 1000) {
+            closeIdle(loop);
+            lastSweepMs = nowMs();
+        }
+    }
+
+    for (HttpConnection* conn : loop.connections) {
+        closeSocket(conn->fd);
+        delete conn;
+        releaseConnection();
+    }
+    loop.connections.clear();
+    close(loop.wakeFd);
+    close(loop.epollFd);
+}
+
+void HttpServer::acceptAll(EventLoop& loop) {
+    while (true) {
+        socket_t clientSocket = accept4(listenSocket, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (clientSocket == INVALID_SOCKET) {
+            return; // EAGAIN: backlog drained (or a transient error we retry on next wake)
+        }
+        if (!admitConnection()) {
+            closeSocket(clientSocket);
+            continue;
+        }
+
+        int opt = 1;
+        setsockopt(clientSocket, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+
+        HttpConnection* conn = new HttpConnection(clientSocket, config, handler);
+        EventLoop* owner = &loop;
+        conn->wake = [owner] {
+            // One eventfd write per loop until it wakes, however many streams it has
+            if (!owner->wakePending.exchange(true)) {
+                uint64_t one = 1;
+                if (write(owner->wakeFd, &one, sizeof(one)) < 0) {
+                    // Counter full: a wake is already pending
+                }
+            }
+        };
+        epoll_event event{};
+        event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        event.data.ptr = conn;
+        if (epoll_ctl(loop.epollFd, EPOLL_CTL_ADD, clientSocket, &event) != 0) {
+            closeSocket(clientSocket);
+            delete conn;
+            releaseConnection();
+            continue;
+        }
+        loop.connections.insert(conn);
+    }
+}
+
+void HttpServer::readAll(EventLoop& loop, HttpConnection* conn) {
+    bool drained = false;
+    // Edge-triggered: keep reading until the kernel buffer is empty. Reading
+    // pauses while the client has too many unread responses; EPOLLOUT resumes it.
+    while (!drained && conn->state != HttpConnection::State::Closed) {
+        while (conn->canRead()) {
+            size_t capacity;
+            char* space = conn->readSpace(capacity);
+            ssize_t bytesRead = recv(conn->fd, space, capacity, 0);
+            conn->commitRead(bytesRead > 0 ? static_cast<size_t>(bytesRead) : 0);
+            if (bytesRead > 0) {
+                continue;
+            } else if (bytesRead == 0) {
+                conn->onPeerClosed();
+            } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                drained = true;
+                break;
+            } else if (errno != EINTR) {
+                conn->state = HttpConnection::State::Closed;
+            }
+        }
+        if (conn->hasPendingOutput()) {
+            flush(loop, conn);
+        }
+        if (conn->hasPendingOutput() || !conn->canRead()) {
+            break;
+        }
+    }
+}
+
+void HttpServer::flush(EventLoop&, HttpConnection* conn) {
+    while (conn->hasPendingOutput()) {
+        ssize_t sent = send(conn->fd, conn->outBuffer.data() + conn->outOffset,
+                            conn->outBuffer.size() - conn->outOffset, MSG_NOSIGNAL);
+        if (sent > 0) {
+            conn->outOffset += static_cast<size_t>(sent);
+        } else if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return; // Socket buffer full: EPOLLOUT will fire when it drains
+        } else if (sent < 0 && errno == EINTR) {
+            continue;
+        } else {
+            conn->state = HttpConnection::State::Closed;
+            return;
+        }
+    }
+    if (conn->state != HttpConnection::State::Closed) {
+        conn->onFlushed();
+    }
+}
+
+// Hand every stream of this loop its published events and send them
+void HttpServer::drainStreams(EventLoop& loop) {
+    std::vector<HttpConnection*> closed;
+    for (HttpConnection* conn : loop.streams) {
+        conn->drainEvents();
+        if (conn->state != HttpConnection::State::Closed && conn->hasPendingOutput()) {
+            flush(loop, conn);
+        }
+        if (conn->state == HttpConnection::State::Closed) {
+            closed.push_back(conn);
+        }
+    }
+    for (HttpConnection* conn : closed) {
+        closeConnection(loop, conn);
+    }
+}
+
+// Send the answers that have come in, and pick up the input that waited
+// behind them (edge-triggered: its EPOLLIN has already been and gone)
+void HttpServer::resumeWaiting(EventLoop& loop) {
+    std::vector<HttpConnection*> ready;
+    for (HttpConnection* conn : loop.waiting) {
+        if (conn->resume()) {
+            ready.push_back(conn);
+        }
+    }
+    for (HttpConnection* conn : ready) {
+        loop.waiting.erase(conn);
+        readAll(loop, conn);
+        if (conn->state == HttpConnection::State::Closed) {
+            closeConnection(loop, conn);
+        } else if (conn->state == HttpConnection::State::Streaming && loop.streams.insert(conn).second) {
+            setsockopt(conn->fd, SOL_SOCKET, SO_SNDBUF, &config.streamSocketBuffer, sizeof(config.streamSocketBuffer));
+        } else if (conn->isWaiting()) {
+            loop.waiting.insert(conn);
+        }
+    }
+}
+
+void HttpServer::closeConnection(EventLoop& loop, HttpConnection* conn) {
+    epoll_ctl(loop.epollFd, EPOLL_CTL_DEL, conn->fd, nullptr);
+    closeSocket(conn->fd);
+    loop.connections.erase(conn);
+    loop.streams.erase(conn);
+    loop.waiting.erase(conn);
+    delete conn;
+    releaseConnection();
+}
+
+// Drop keep-alive connections idle past the timeout, and clients that stall
+// mid-request or stop reading their responses for as long. Streams may stay
+// quiet indefinitely (with a heartbeat) but not stop reading; a connection
+// waiting on its own answer is not idle
+void HttpServer::closeIdle(EventLoop& loop) {
+    long long now = nowMs();
+    long long cutoff = now - config.keepAliveTimeoutMs;
+    std::vector<HttpConnection*> expired;
+    for (HttpConnection* conn : loop.connections) {
+        if (conn->isWaiting() && !conn->hasPendingOutput()) {
+            continue;
+        }
+        if (conn->state == HttpConnection::State::Streaming && !conn->hasPendingOutput()) {
+            if (conn->lastActivityMs < now - config.streamHeartbeatMs) {
+                conn->queueHeartbeat();
+                flush(loop, conn);
+            }
+            if (conn->state != HttpConnection::State::Closed) {
+                continue;
+            }
+        }
+        if (conn->lastActivityMs < cutoff || conn->state == HttpConnection::State::Closed) {
+            expired.push_back(conn);
+        }
+    }
+    for (HttpConnection* conn : expired) {
+        closeConnection(loop, conn);
+    }
+}
+
+#else
+
+void HttpServer::runLoop(EventLoop& loop) {
+    while (true) {
+        socket_t clientSocket;
+        {
+            std::unique_lock<std::mutex> lock(loop.mutex);
+            loop.ready.wait(lock, [&] { return !loop.pending.empty() || !running; });
+            if (!running) {
+                return;
+            }
+            clientSocket = loop.pending.front();
+            loop.pending.pop_front();
+        }
+        serveBlocking(clientSocket);
+        releaseConnection();
+    }
+}
+
+void HttpServer::serveBlocking(socket_t clientSocket) {
+    // Idle keep-alive connections time out in recv()
+#ifdef _WIN32
+    DWORD timeout = static_cast<DWORD>(config.keepAliveTimeoutMs);
+    setsockopt(clientSocket, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
+#else
+    timeval timeout{config.keepAliveTimeoutMs / 1000, (config.keepAliveTimeoutMs % 1000) * 1000};
+    setsockopt(clientSocket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+#endif
+
+    // Declared before conn so they outlive its subscription
+    std::mutex streamMutex;
+    std::condition_variable streamReady;
+    bool streamWoken = false;
+    bool streamSocketSized = false;
+
+    HttpConnection conn(clientSocket, config, handler);
+    conn.wake = [&] {
+        {
+            std::lock_guard<std::mutex> lock(streamMutex);
+            streamWoken = true;
+        }
+        streamReady.notify_one();
+    };
+    // A stopping server drops its clients once their current wait ends
+    while (conn.state != HttpConnection::State::Closed && running) {
+        if (conn.isWaiting() && !conn.hasPendingOutput()) {
+            // The answer comes from another thread; complete() wakes this one
+            std::unique_lock<std::mutex> lock(streamMutex);
+            streamReady.wait(lock, [&] { return streamWoken; });
+            streamWoken = false;
+            lock.unlock();
+            conn.resume();
+        } else if (conn.state == HttpConnection::State::Reading && !conn.isWaiting()) {
+            size_t capacity;
+            char* space = conn.readSpace(capacity);
+            int bytesRead = recv(clientSocket, space, static_cast<int>(capacity), 0);
+            conn.commitRead(bytesRead > 0 ? static_cast<size_t>(bytesRead) : 0);
+            if (bytesRead <= 0) {
+                conn.state = HttpConnection::State::Closed;
+            }
+        } else if (conn.state == HttpConnection::State::Streaming && !conn.hasPendingOutput()) {
+            if (!streamSocketSized) {
+#ifdef _WIN32
+                setsockopt(clientSocket, SOL_SOCKET, SO_SNDBUF, (const char*)&config.streamSocketBuffer,
+                           sizeof(config.streamSocketBuffer));
+#else
+                setsockopt(clientSocket, SOL_SOCKET, SO_SNDBUF, &config.streamSocketBuffer,
+                           sizeof(config.streamSocketBuffer));
+#endif
+                streamSocketSized = true;
+            }
+            // This worker now belongs to the stream: wait for events or the
+            // heartbeat; a client that left is noticed when a send fails
+            std::unique_lock<std::mutex> lock(streamMutex);
+            bool woken = streamReady.wait_for(lock, std::chrono::milliseconds(config.streamHeartbeatMs),
+                                              [&] { return streamWoken; });
+            streamWoken = false;
+            lock.unlock();
+            if (woken) {
+                conn.drainEvents();
+            } else {
+                conn.queueHeartbeat();
+            }
+        }
+        while (conn.hasPendingOutput()) {
+            int sent = send(clientSocket, conn.outBuffer.data() + conn.outOffset,
+                            static_cast<int>(conn.outBuffer.size() - conn.outOffset), 0);
+            if (sent <= 0) {
+                conn.state = HttpConnection::State::Closed;
+                break;
+            }
+            conn.outOffset += static_cast<size_t>(sent);
+        }
+        if (conn.state != HttpConnection::State::Closed) {
+            conn.onFlushed();
+        }
+    }
+    closeSocket(clientSocket);
+}
+
+#endif
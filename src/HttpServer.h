@@ -0,0 +1,278 @@
+#ifndef HTTP_SERVER_H
+#define HTTP_SERVER_H
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+using socket_t = SOCKET;
+#else
+using socket_t = int;
+#define INVALID_SOCKET (-1)
+#define SOCKET_ERROR   (-1)
+#endif
+
+#include "HttpParser.h"
+#include "EventHub.h"
+#include <string>
+#include <string_view>
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <mutex>
+
+void closeSocket(socket_t sock);
+bool startupSockets();
+void cleanupSockets();
+// SIGINT/SIGTERM stop every HttpServer (its run() returns) instead of killing
+// the process, so the caller can close its logs cleanly. The handler only
+// sets a flag and writes an eventfd; the event loops do the stopping
+void stopOnSignals();
+
+class PendingResponse;
+
+// Response produced by a handler. The connection adds Content-Length and the
+// Connection/Keep-Alive headers when it serializes it.
+// With stream set the connection instead becomes an event stream: the headers
+// and body go out without a length and everything later published on the hub
+// follows, until the client leaves or falls too far behind.
+// With pending set the answer is not ready yet (see PendingResponse).
+struct HttpResponse {
+    std::string status = "200 OK";
+    std::string contentType = "text/html";
+    std::string headers;    // Extra header lines, each terminated by \r\n
+    std::string body;
+    std::shared_ptr<const std::string> sharedBody;  // Sent instead of body when set (cached files)
+    std::shared_ptr<EventHub> stream;
+    std::shared_ptr<PendingResponse> pending;
+};
+
+// The answer to a request that cannot be given before the handler returns
+// (a change still waiting for the disk) and must not be waited for on an I/O
+// thread. The handler returns a response with only pending set and hands
+// this object to whoever finishes the work. The connection answers nothing
+// more and reads nothing more meanwhile, so pipelined requests keep their
+// order; complete() wakes its thread, which sends the real response.
+class PendingResponse {
+public:
+    // Supply the response; once, from any thread. Dropped if the client has
+    // gone by then
+    void complete(HttpResponse response);
+
+private:
+    friend class HttpConnection;
+    std::mutex mutex;
+    bool done = false;
+    HttpResponse response;
+    std::function<void()> wake;     // The waiting connection's; cleared when it stops waiting
+};
+
+// Turns one complete parsed request into a response
+using RequestHandler = std::function<HttpResponse(const HttpRequest& request)>;
+
+struct ServerConfig {
+    int port = 5000;
+    int ioThreads = 0;                  // 0 = one per core (capped at 8)
+    int maxConnections = 4096;          // Extra clients are accepted and closed at once
+    size_t maxRequestBytes = 1 << 20;   // Larger bodies (or header blocks) get 413 and are closed
+    std::vector<std::string> uploadPaths; // Paths whose bodies may be up to maxUploadBytes
+    size_t maxUploadBytes = 16 << 20;   // Buffered whole before the handler runs
+    int keepAliveTimeoutMs = 5000;      // Idle keep-alive connections are closed after this
+    int maxRequestsPerConnection = 100; // The response to the last one carries Connection: close
+    size_t maxPendingOutput = 4 << 20;  // Stop reading pipelined requests until the client catches up
+    int streamHeartbeatMs = 15000;      // Idle event streams get a comment line this often
+    int streamSocketBuffer = 64 << 10;  // SO_SNDBUF of event streams: a stalled client backs up
+                                        // into the hub's limit instead of the kernel's buffers
+};
+
+/// per-connection read buffer
+
+// A connection's unparsed input. recv() writes straight into the spare
+// capacity past size(), which (unlike std::string::resize) is never
+// zero-filled first, so an empty read costs nothing but the syscall.
+class ReadBuffer {
+public:
+    ReadBuffer() : used(0), allocated(0) {}
+
+    const char* data() const { return bytes.get(); }
+    size_t size() const { return used; }
+    operator std::string_view() const { return std::string_view(bytes.get(), used); }
+
+    // At least count writable bytes past size(); reallocating moves only what is held
+    char* space(size_t count) {
+        if (allocated - used < count) {
+            grow(std::max(used + count, allocated * 2));
+        }
+        return bytes.get() + used;
+    }
+    // Room for total bytes in all, so a large body is allocated once
+    void reserve(size_t total) {
+        if (total > allocated) grow(total);
+    }
+    // The last count bytes written into space() are now held
+    void commit(size_t count) { used += count; }
+
+    void clear() { used = 0; }
+    // Drop the first count bytes, moving the rest to the front
+    void consume(size_t count) {
+        std::memmove(bytes.get(), bytes.get() + count, used - count);
+        used -= count;
+    }
+    // Give the storage back once empty, if it grew past limit (a large body)
+    void trim(size_t limit) {
+        if (used == 0 && allocated > limit) {
+            bytes.reset();
+            allocated = 0;
+        }
+    }
+
+private:
+    std::unique_ptr<char[]> bytes;
+    size_t used;
+    size_t allocated;
+
+    void grow(size_t total) {
+        std::unique_ptr<char[]> larger(new char[total]);  // Default-initialized: no fill
+        if (used > 0) std::memcpy(larger.get(), bytes.get(), used);
+        bytes = std::move(larger);
+        allocated = total;
+    }
+};
+
+/// per-connection state machine
+
+// Owns the buffers of one client socket. The event loop feeds it bytes as they
+// arrive and drains outBuffer; it never touches the socket itself.
+// Reading: accepting (possibly pipelined) requests on a persistent connection.
+// Reading also covers waiting on a PendingResponse (isWaiting()), with input
+// paused until resume() has the answer.
+// Writing: the final response is queued; close once it has been sent.
+// Streaming: answered with an event stream; input is discarded and hub
+// events are appended to outBuffer by drainEvents() until either side leaves.
+class HttpConnection {
+public:
+    enum class State { Reading, Writing, Streaming, Closed };
+
+    HttpConnection(socket_t fd, const ServerConfig& config, const RequestHandler& handler);
+    ~HttpConnection();
+
+    HttpConnection(const HttpConnection&) = delete;
+    HttpConnection& operator=(const HttpConnection&) = delete;
+
+    // Writable space at the end of inBuffer for the next recv(); sized to the
+    // rest of the current request when its Content-Length is already known
+    char* readSpace(size_t& capacity);
+
+    // The last recv() stored length bytes in readSpace(): parse them and
+    // queue a response for every request they complete
+    void commitRead(size_t length);
+
+    // Peer closed its side: nothing more will arrive
+    void onPeerClosed();
+
+    // A request's answer is still pending
+    bool isWaiting() const { return pending != nullptr; }
+
+    // Waiting and woken: if the answer has come, queue it and go on with the
+    // requests pipelined behind it. False while it is still pending
+    bool resume();
+
+    // Called once outBuffer has been fully sent
+    void onFlushed();
+
+    bool hasPendingOutput() const { return outOffset < outBuffer.size(); }
+
+    // True while more input may be consumed without overrunning the output cap
+    bool canRead() const {
+        return state == State::Streaming ||
+               (state == State::Reading && !pending && outBuffer.size() - outOffset < config.maxPendingOutput);
+    }
+
+    // Streaming: move published events into outBuffer. A client whose unsent
+    // output would pass the hub's buffer limit is closed instead
+    void drainEvents();
+
+    // Streaming: a comment line, so idle streams stay open through proxies
+    // and a vanished client is noticed
+    void queueHeartbeat();
+
+    socket_t fd;
+    State state;
+    ReadBuffer inBuffer;
+    std::string outBuffer;
+    size_t outOffset;
+    int requestsServed;
+    long long lastActivityMs;
+    std::function<void()> wake;     // Set by the server: runs drainEvents and resume on the owning thread soon
+
+private:
+    const ServerConfig& config;
+    const RequestHandler& handler;
+    HttpParser parser;
+    HttpRequest request;    // Reused so header storage is allocated once per connection
+    std::shared_ptr<EventHub> streamHub;
+    std::shared_ptr<EventHub::Subscriber> subscriber;
+    std::shared_ptr<PendingResponse> pending;
+    bool pendingKeepAlive;
+
+    // Answer every complete request in inBuffer, in order, until one has to wait
+    void answerRequests();
+    // Queue response, or start waiting on it when pending is set
+    void answer(HttpResponse& response, bool keepAlive);
+    // Queue the pending answer if it has come
+    bool takePending();
+    void queueResponse(const HttpResponse& response, bool keepAlive);
+    void startStream(const HttpResponse& response);
+    void queueError(const std::string& status);
+};
+
+/// event loop server
+
+// Linux: edge-triggered epoll reactor, one epoll instance per I/O thread, all
+// sharing one non-blocking listening socket. Elsewhere: a fixed pool of
+// blocking workers fed by a single accept loop. Thread count is fixed at
+// start-up either way, so load never creates threads.
+class HttpServer {
+public:
+    HttpServer(const ServerConfig& config, RequestHandler handler);
+    ~HttpServer();
+
+    // Create, bind and listen on the server socket
+    bool start();
+
+    // Run the I/O threads; blocks until stop() is called or a stop signal
+    // arrives (stopOnSignals)
+    void run();
+
+    void stop();
+
+    int getActiveConnections() const { return activeConnections.load(); }
+
+private:
+    struct EventLoop;
+
+    ServerConfig config;
+    RequestHandler handler;
+    socket_t listenSocket;
+    std::atomic<bool> running;
+    std::atomic<int> activeConnections;
+    std::vector<std::unique_ptr<EventLoop>> loops;
+
+    int threadCount() const;
+    bool admitConnection();
+    void releaseConnection();
+    void runLoop(EventLoop& loop);
+    void acceptAll(EventLoop& loop);
+    void readAll(EventLoop& loop, HttpConnection* conn);
+    void flush(EventLoop& loop, HttpConnection* conn);
+    void drainStreams(EventLoop& loop);
+    void resumeWaiting(EventLoop& loop);
+    void closeConnection(EventLoop& loop, HttpConnection* conn);
+    void closeIdle(EventLoop& loop);
+    void serveBlocking(socket_t clientSocket);
+};
+
+#endif // HTTP_SERVER_H
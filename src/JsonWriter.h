@@ -0,0 +1,140 @@
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <charconv>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/// streaming JSON
+
+// Appends JSON text straight onto a caller-owned buffer. Nothing is built up
+// as a tree and no temporary strings are made per field: keys and string
+// values are escaped in runs directly into the buffer, integers go through
+// std::to_chars on the stack. Callers keep the buffer across requests
+// (clear() keeps its capacity), so a warmed-up thread renders without
+// allocating.
+//
+// Commas are placed automatically: one bit per nesting level records whether
+// the current container already has an element (up to 64 levels). The writer
+// does not validate structure; begin/end and key/value calls must pair up.
+class JsonWriter {
+public:
+    explicit JsonWriter(std::string& out) : out(out), hasElements(0), depth(0), afterKey(false) {}
+
+    JsonWriter& beginObject() { return open('{'); }
+    JsonWriter& endObject() { return close('}'); }
+    JsonWriter& beginArray() { return open('['); }
+    JsonWriter& endArray() { return close(']'); }
+
+    JsonWriter& key(std::string_view name) {
+        separate();
+        appendString(name);
+        out += ':';
+        afterKey = true;
+        return *this;
+    }
+
+    JsonWriter& value(std::string_view text) {
+        separate();
+        appendString(text);
+        return *this;
+    }
+    JsonWriter& value(const std::string& text) { return value(std::string_view(text)); }
+    JsonWriter& value(const char* text) { return value(std::string_view(text)); }
+
+    JsonWriter& value(bool flag) {
+        separate();
+        out += flag ? "true" : "false";
+        return *this;
+    }
+
+    JsonWriter& value(int number) { return integer(static_cast<long long>(number)); }
+    JsonWriter& value(long number) { return integer(static_cast<long long>(number)); }
+    JsonWriter& value(long long number) { return integer(number); }
+    JsonWriter& value(unsigned number) { return integer(static_cast<unsigned long long>(number)); }
+    JsonWriter& value(unsigned long number) { return integer(static_cast<unsigned long long>(number)); }
+    JsonWriter& value(unsigned long long number) { return integer(number); }
+
+    JsonWriter& null() {
+        separate();
+        out += "null";
+        return *this;
+    }
+
+    // key(name).value(v) in one call
+    template <typename T>
+    JsonWriter& field(std::string_view name, const T& v) {
+        key(name);
+        return value(v);
+    }
+
+private:
+    std::string& out;
+    uint64_t hasElements;   // Bit d: container at depth d has an element
+    int depth;
+    bool afterKey;          // Next value belongs to a key: no comma
+
+    void separate() {
+        if (afterKey) {
+            afterKey = false;
+            return;
+        }
+        if (depth > 0) {
+            uint64_t bit = uint64_t(1) << ((depth - 1) & 63);
+            if (hasElements & bit) out += ',';
+            hasElements |= bit;
+        }
+    }
+
+    JsonWriter& open(char bracket) {
+        separate();
+        out += bracket;
+        depth++;
+        hasElements &= ~(uint64_t(1) << ((depth - 1) & 63));
+        return *this;
+    }
+
+    JsonWriter& close(char bracket) {
+        out += bracket;
+        depth--;
+        return *this;
+    }
+
+    template <typename Integer>
+    JsonWriter& integer(Integer number) {
+        separate();
+        char digits[24];
+        auto result = std::to_chars(digits, digits + sizeof(digits), number);
+        out.append(digits, result.ptr);
+        return *this;
+    }
+
+    // Quote and escape: unescaped runs are copied in one append each
+    void appendString(std::string_view text) {
+        static const char HEX[] = "0123456789abcdef";
+        out += '"';
+        size_t runStart = 0;
+        for (size_t i = 0; i < text.size(); i++) {
+            unsigned char c = static_cast<unsigned char>(text[i]);
+            if (c >= 0x20 && c != '"' && c != '\\') continue;
+            out.append(text.data() + runStart, i - runStart);
+            runStart = i + 1;
+            switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default: {
+                char escape[6] = {'\\', 'u', '0', '0', HEX[c >> 4], HEX[c & 0xF]};
+                out.append(escape, sizeof(escape));
+            }
+            }
+        }
+        out.append(text.data() + runStart, text.size() - runStart);
+        out += '"';
+    }
+};
+
+#endif // JSON_WRITER_H
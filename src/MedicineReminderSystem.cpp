@@ -2,6 +2,8 @@
 #include <sstream>
 #include <iostream>
 #include <ctime>
+#include <algorithm>
+#include <chrono>
 
 //// array
 
@@ -86,771 +88,2093 @@ std::string CategoryManager::getAllCategories() const
     return ss.str();
 }
 
-/// Linked list 
-
-MedicineManager::MedicineManager() : head(nullptr), medicineCount(0) {}
-
-MedicineManager::~MedicineManager()
+void CategoryManager::copyTo(std::vector<std::string> &out) const
 {
-    // Traverse and delete all nodes to prevent memory leaks
-    Medicine *current = head;
-    while (current != nullptr)
-    {
-        Medicine *temp = current;
-        current = current->next;
-        delete temp;
-    }
+    out.insert(out.end(), categories, categories + categoryCount);
 }
 
-bool MedicineManager::addMedicine(const std::string &name, const std::string &dose,
-                                  const std::string &timings, const std::string &category)
-{
-    // Existing code to create and insert node
-    Medicine *newMedicine = new Medicine(name, dose, timings, category);
-    newMedicine->next = head;
-    head = newMedicine;
-    medicineCount++;
-    return true; // Indicate success
-}
+/// Hash index
 
-void MedicineManager::addMedicineWithStock(const std::string &name, const std::string &dose,
-                                           const std::string &timings, const std::string &category,
-                                           int stock, int threshold)
-{
-    // Create new medicine node with stock information
-    Medicine *newMedicine = new Medicine(name, dose, timings, category, stock, threshold);
+MedicineIndex::MedicineIndex() : slots(16, Slot{0, nullptr}), liveCount(0), tombstoneCount(0) {}
 
-    // Insert at head for  insertion
-    newMedicine->next = head;
-    head = newMedicine;
-    medicineCount++;
+size_t MedicineIndex::hashName(const std::string &name)
+{
+    // 0 and 1 are reserved slot markers
+    size_t hash = std::hash<std::string>()(name);
+    return hash < 2 ? hash + 2 : hash;
 }
 
-bool MedicineManager::deleteMedicine(const std::string &name)
+size_t MedicineIndex::findSlot(const std::string &name, size_t hash) const
 {
-    // Empty list check
-    if (head == nullptr)
-    {
-        return false;
-    }
-
-    // Check if head node matches
-    if (head->name == name)
-    {
-        Medicine *temp = head;
-        head = head->next;
-        delete temp;
-        medicineCount--;
-        return true;
-    }
-
-    // Traverse to find the medicine
-    Medicine *current = head;
-    while (current->next != nullptr)
+    size_t mask = slots.size() - 1;
+    size_t firstFree = SIZE_MAX;
+    for (size_t i = hash & mask;; i = (i + 1) & mask)
     {
-        if (current->next->name == name)
+        const Slot &slot = slots[i];
+        if (slot.medicine == nullptr)
         {
-            Medicine *temp = current->next;
-            current->next = current->next->next;
-            delete temp;
-            medicineCount--;
-            return true;
+            if (slot.hash == 0)
+            {
+                // Never-used slot ends the probe; reuse an earlier tombstone if seen
+                return firstFree != SIZE_MAX ? firstFree : i;
+            }
+            if (firstFree == SIZE_MAX)
+            {
+                firstFree = i;
+            }
+        }
+        else if (slot.hash == hash && slot.medicine->name == name)
+        {
+            return i;
         }
-        current = current->next;
     }
-
-    return false;
 }
 
-Medicine *MedicineManager::searchMedicine(const std::string &name) const
+void MedicineIndex::rehash(size_t capacity)
 {
-    // Linear search through linked list
-    Medicine *current = head;
-    while (current != nullptr)
+    std::vector<Slot> old(capacity, Slot{0, nullptr});
+    old.swap(slots);
+    tombstoneCount = 0;
+    size_t mask = capacity - 1;
+    for (const Slot &slot : old)
     {
-        if (current->name == name)
+        if (slot.medicine != nullptr)
         {
-            return current;
+            size_t i = slot.hash & mask;
+            while (slots[i].medicine != nullptr)
+            {
+                i = (i + 1) & mask;
+            }
+            slots[i] = slot;
         }
-        current = current->next;
     }
-    return nullptr;
 }
 
-bool MedicineManager::updateStock(const std::string &name, int quantity)
+void MedicineIndex::reserve(size_t count)
 {
-    // Search for medicine and update stock quantity
-    Medicine *med = searchMedicine(name);
-    if (med != nullptr)
+    size_t capacity = slots.size();
+    while ((count + 1) * 10 > capacity * 7)
     {
-        med->stockQuantity = quantity;
-        return true;
+        capacity *= 2;
     }
-    return false;
-}
-
-bool MedicineManager::decreaseStock(const std::string &name, int quantity)
-{
-    // Search for medicine and decrease stock
-    Medicine *med = searchMedicine(name);
-    if (med != nullptr)
+    if (capacity != slots.size())
     {
-        if (med->stockQuantity >= quantity)
-        {
-            med->stockQuantity -= quantity;
-            return true;
-        }
+        rehash(capacity);
     }
-    return false;
 }
 
-bool MedicineManager::isLowStock(const std::string &name) const
+Medicine *MedicineIndex::find(const std::string &name) const
 {
-    // Check if medicine stock is below threshold
-    Medicine *med = searchMedicine(name);
-    if (med != nullptr)
-    {
-        return med->stockQuantity <= med->lowStockThreshold;
-    }
-    return false;
+    return slots[findSlot(name, hashName(name))].medicine;
 }
 
-std::string MedicineManager::getLowStockMedicines() const
+bool MedicineIndex::insert(Medicine *medicine)
 {
-    std::stringstream ss;
-    ss << "Low Stock Alerts:\n";
-
-    Medicine *current = head;
-    int count = 1;
-    bool found = false;
-
-    while (current != nullptr)
+    // Keep live + tombstone slots under 70% so probes stay short
+    if ((liveCount + tombstoneCount + 1) * 10 > slots.size() * 7)
     {
-        if (current->stockQuantity <= current->lowStockThreshold)
+        size_t capacity = slots.size();
+        while ((liveCount + 1) * 10 > capacity * 4)
         {
-            ss << count++ << ". " << current->name
-               << " - Stock: " << current->stockQuantity
-               << " (Threshold: " << current->lowStockThreshold << ")\n";
-            found = true;
+            capacity *= 2;
         }
-        current = current->next;
+        rehash(capacity);
     }
 
-    if (!found)
+    size_t hash = hashName(medicine->name);
+    Slot &slot = slots[findSlot(medicine->name, hash)];
+    if (slot.medicine != nullptr)
     {
-        ss << "All medicines have adequate stock.\n";
+        return false;
     }
-
-    return ss.str();
+    if (slot.hash == 1)
+    {
+        tombstoneCount--;
+    }
+    slot = Slot{hash, medicine};
+    liveCount++;
+    return true;
 }
 
-std::string MedicineManager::getStockLevels() const
+Medicine *MedicineIndex::erase(const std::string &name)
 {
-    std::stringstream ss;
-    ss << "Stock Levels (" << medicineCount << " medicines):\n";
-
-    Medicine *current = head;
-    int count = 1;
-
-    while (current != nullptr)
+    Slot &slot = slots[findSlot(name, hashName(name))];
+    Medicine *medicine = slot.medicine;
+    if (medicine != nullptr)
     {
-        ss << count++ << ". " << current->name
-           << " - Stock: " << current->stockQuantity
-           << " | Threshold: " << current->lowStockThreshold;
+        slot = Slot{1, nullptr};
+        liveCount--;
+        tombstoneCount++;
+    }
+    return medicine;
+}
 
-        if (current->stockQuantity == 0)
-        {
-            ss << " [OUT OF STOCK]";
-        }
-        else if (current->stockQuantity <= current->lowStockThreshold)
-        {
-            ss << " [LOW STOCK]";
-        }
+void MedicineIndex::clear()
+{
+    slots.assign(slots.size(), Slot{0, nullptr});
+    liveCount = 0;
+    tombstoneCount = 0;
+}
 
-        ss << "\n";
-        current = current->next;
-    }
+/// Category index
 
-    if (medicineCount == 0)
+void CategoryIndex::insert(Medicine *medicine)
+{
+    // Push onto the front of the group, creating it on first use
+    Group &group = groups.try_emplace(medicine->category, Group{nullptr, 0}).first->second;
+    medicine->categoryPrev = nullptr;
+    medicine->categoryNext = group.head;
+    if (group.head != nullptr)
     {
-        ss << "No medicines in inventory.\n";
+        group.head->categoryPrev = medicine;
     }
-
-    return ss.str();
+    group.head = medicine;
+    group.count++;
 }
 
-std::string MedicineManager::getAllMedicines() const
+void CategoryIndex::erase(Medicine *medicine)
 {
-    std::stringstream ss;
-    ss << "All Medicines (" << medicineCount << "):\n";
+    auto it = groups.find(medicine->category);
+    if (it == groups.end())
+    {
+        return;
+    }
 
-    Medicine *current = head;
-    int count = 1;
-    while (current != nullptr)
+    Group &group = it->second;
+    if (medicine->categoryPrev != nullptr)
     {
-        ss << count++ << ". " << current->name
-           << " | Dose: " << current->dose
-           << " | Timings: " << current->timings
-           << " | Category: " << current->category << "\n";
-        current = current->next;
+        medicine->categoryPrev->categoryNext = medicine->categoryNext;
     }
+    else
+    {
+        group.head = medicine->categoryNext;
+    }
+    if (medicine->categoryNext != nullptr)
+    {
+        medicine->categoryNext->categoryPrev = medicine->categoryPrev;
+    }
+    medicine->categoryNext = medicine->categoryPrev = nullptr;
 
-    if (medicineCount == 0)
+    if (--group.count == 0)
     {
-        ss << "No medicines added yet.\n";
+        groups.erase(it);
     }
+}
 
-    return ss.str();
+Medicine *CategoryIndex::first(const std::string &category) const
+{
+    auto it = groups.find(category);
+    return it != groups.end() ? it->second.head : nullptr;
 }
 
-std::string MedicineManager::getMedicinesByCategory(const std::string &category) const
+int CategoryIndex::count(const std::string &category) const
 {
-    std::stringstream ss;
-    ss << "Medicines in " << category << ":\n";
+    auto it = groups.find(category);
+    return it != groups.end() ? it->second.count : 0;
+}
 
-    Medicine *current = head;
-    int count = 1;
-    bool found = false;
+/// Low-stock index
 
-    while (current != nullptr)
+void LowStockIndex::insert(const Medicine *medicine)
+{
+    if (medicine->stockQuantity <= medicine->lowStockThreshold)
     {
-        if (current->category == category)
-        {
-            ss << count++ << ". " << current->name
-               << " | Dose: " << current->dose
-               << " | Timings: " << current->timings << "\n";
-            found = true;
-        }
-        current = current->next;
+        entries.insert(Entry{medicine->lowStockThreshold - medicine->stockQuantity, medicine});
     }
+}
 
-    if (!found)
+void LowStockIndex::erase(const Medicine *medicine, int stock)
+{
+    if (stock <= medicine->lowStockThreshold)
     {
-        ss << "No medicines in this category.\n";
+        entries.erase(Entry{medicine->lowStockThreshold - stock, medicine});
     }
-
-    return ss.str();
 }
 
-// Reminder node
+/// Prefix index
 
-ReminderNode::ReminderNode(const std::string &med, const std::string &t)
-    : medicineName(med), time(t), left(nullptr), right(nullptr)
+static unsigned char foldCase(char c)
 {
-    timeValue = timeToValue(t);
+    unsigned char u = static_cast<unsigned char>(c);
+    return (u >= 'A' && u <= 'Z') ? static_cast<unsigned char>(u + ('a' - 'A')) : u;
 }
 
-int ReminderNode::timeToValue(const std::string &time)
+// First 8 bytes, case folded, big-endian so integer order is string order
+static uint64_t packHead(const std::string &text)
 {
-    // Convert HH:MM to HHMM integer for easy comparison
-    if (time.length() >= 5)
+    uint64_t head = 0;
+    for (size_t i = 0; i < 8; i++)
     {
-        int hours = std::stoi(time.substr(0, 2));
-        int minutes = std::stoi(time.substr(3, 2));
-        return hours * 100 + minutes;
+        head = (head << 8) | (i < text.size() ? foldCase(text[i]) : 0);
     }
-    return 0;
+    return head;
 }
 
-// Reminder bst
-
-ReminderScheduler::ReminderScheduler() : root(nullptr), reminderCount(0) {}
+// Case-folded comparison of a and b from byte `from` on (the bytes before it are equal)
+static int compareFolded(const std::string &a, const std::string &b, size_t from)
+{
+    size_t common = std::min(a.size(), b.size());
+    for (size_t i = from; i < common; i++)
+    {
+        unsigned char x = foldCase(a[i]);
+        unsigned char y = foldCase(b[i]);
+        if (x != y)
+        {
+            return x < y ? -1 : 1;
+        }
+    }
+    return a.size() < b.size() ? -1 : (a.size() > b.size() ? 1 : 0);
+}
 
-ReminderScheduler::~ReminderScheduler()
+PrefixIndex::Entry PrefixIndex::makeEntry(const Medicine *medicine)
 {
-    deleteTree(root);
+    return Entry{packHead(medicine->name), medicine};
 }
 
-void ReminderScheduler::deleteTree(ReminderNode *node)
+bool PrefixIndex::less(const Entry &a, const Entry &b)
 {
-    // Post-order deletion: Left-Right-Root
-    if (node != nullptr)
+    if (a.head != b.head)
     {
-        deleteTree(node->left);
-        deleteTree(node->right);
-        delete node;
+        return a.head < b.head;
     }
+    int order = compareFolded(a.medicine->name, b.medicine->name, 8);
+    // Names differing only in case still need a fixed order to be found again
+    return order != 0 ? order < 0 : a.medicine->name < b.medicine->name;
 }
 
-ReminderNode *ReminderScheduler::insertNode(ReminderNode *node, const std::string &medicine, const std::string &time)
+void PrefixIndex::insert(const Medicine *medicine)
 {
-    // Base case: found the insertion point
-    if (node == nullptr)
-    {
-        return new ReminderNode(medicine, time);
-    }
+    Entry entry = makeEntry(medicine);
+    entries.insert(std::upper_bound(entries.begin(), entries.end(), entry, less), entry);
+}
 
-    int newTimeValue = ReminderNode::timeToValue(time);
+void PrefixIndex::stage(const Medicine *medicine)
+{
+    staged.push_back(makeEntry(medicine));
+}
 
-    // BST insertion logic: smaller times go left, larger times go right
-    if (newTimeValue < node->timeValue)
+void PrefixIndex::commit()
+{
+    if (staged.empty())
     {
-        node->left = insertNode(node->left, medicine, time);
+        return;
     }
-    else
+    std::sort(staged.begin(), staged.end(), less);
+    // Merge from the back into the grown array: no scratch buffer, each entry moves once
+    size_t i = entries.size();
+    size_t j = staged.size();
+    entries.resize(i + j);
+    for (size_t k = entries.size(); j > 0;)
     {
-        node->right = insertNode(node->right, medicine, time);
+        if (i > 0 && less(staged[j - 1], entries[i - 1]))
+        {
+            entries[--k] = entries[--i];
+        }
+        else
+        {
+            entries[--k] = staged[--j];
+        }
     }
-
-    return node;
+    std::vector<Entry>().swap(staged);
 }
 
-void ReminderScheduler::addReminder(const std::string &medicine, const std::string &time)
+void PrefixIndex::erase(const Medicine *medicine)
 {
-    root = insertNode(root, medicine, time);
-    reminderCount++;
+    auto it = std::lower_bound(entries.begin(), entries.end(), makeEntry(medicine), less);
+    if (it != entries.end() && it->medicine == medicine)
+    {
+        entries.erase(it);
+    }
 }
 
-void ReminderScheduler::inOrderTraversal(ReminderNode *node, std::stringstream &ss) const
+void PrefixIndex::find(const std::string &prefix, size_t limit, std::vector<const Medicine *> &out) const
 {
-    // In-order traversal: Left-Root-Right (gives sorted order)
-    if (node != nullptr)
+    uint64_t head = packHead(prefix);
+    size_t headBytes = std::min<size_t>(prefix.size(), 8);
+    uint64_t mask = headBytes == 0 ? 0 : ~uint64_t(0) << (8 * (8 - headBytes));
+
+    // First name not below the prefix; every match follows it contiguously
+    auto it = std::lower_bound(entries.begin(), entries.end(), prefix,
+                               [head](const Entry &entry, const std::string &key)
+                               {
+                                   if (entry.head != head)
+                                   {
+                                       return entry.head < head;
+                                   }
+                                   return compareFolded(entry.medicine->name, key, 8) < 0;
+                               });
+    for (; it != entries.end() && limit > 0; ++it, --limit)
     {
-        inOrderTraversal(node->left, ss);
-        ss << "- " << node->time << " - " << node->medicineName << "\n";
-        inOrderTraversal(node->right, ss);
+        if ((it->head & mask) != head)
+        {
+            break;
+        }
+        // Past 8 bytes the head cannot tell; check the rest of the prefix in the name
+        const std::string &name = it->medicine->name;
+        if (name.size() < prefix.size())
+        {
+            break;
+        }
+        size_t i = headBytes;
+        while (i < prefix.size() && foldCase(name[i]) == foldCase(prefix[i]))
+        {
+            i++;
+        }
+        if (i < prefix.size())
+        {
+            break;
+        }
+        out.push_back(it->medicine);
     }
 }
 
-std::string ReminderScheduler::getRemindersInOrder() const
+/// Linked list 
+
+static MedicineRecord toRecord(const Medicine &med)
 {
-    std::stringstream ss;
-    ss << "Scheduled Reminders (" << reminderCount << "):\n";
+    return MedicineRecord{med.name, med.dose, med.timings, med.category, med.stockQuantity, med.lowStockThreshold};
+}
 
-    if (root == nullptr)
-    {
-        ss << "No reminders scheduled.\n";
-    }
-    else
-    {
-        inOrderTraversal(root, ss);
-    }
+MedicineManager::MedicineManager() : head(nullptr), medicineCount(0), nextSequence(1), nodePool("Medicine") {}
 
-    return ss.str();
+MedicineManager::~MedicineManager()
+{
+    // Nodes are destroyed with their pool
 }
 
-ReminderNode *ReminderScheduler::findMin(ReminderNode *node)
+void MedicineManager::clear()
 {
-    while (node->left != nullptr)
-    {
-        node = node->left;
-    }
-    return node;
+    nameIndex.clear();
+    categoryIndex.clear();
+    lowStockIndex.clear();
+    prefixIndex.clear();
+    nodePool.reset();
+    head = nullptr;
+    medicineCount = 0;
+    listing.reset();
 }
 
-std::string ReminderScheduler::getNextReminder() const
+void MedicineManager::bulkLoad(std::vector<MedicineRecord> &&records)
 {
-    if (root == nullptr)
+    clear();
+    reserve(records.size());
+    // Records link at the head, so feed the list in back to front
+    for (size_t i = records.size(); i-- > 0;)
     {
-        return "No upcoming reminders";
+        addRecord(std::move(records[i]));
     }
+    commitRecords();
+}
 
-    // Find leftmost node (earliest time)
-    ReminderNode *current = root;
-    while (current->left != nullptr)
-    {
-        current = current->left;
-    }
+void MedicineManager::reserve(size_t count)
+{
+    nameIndex.reserve(static_cast<size_t>(medicineCount) + count);
+    prefixIndex.reserve(static_cast<size_t>(medicineCount) + count);
+    nodePool.reserve(count);
+}
 
-    return current->time + " - " + current->medicineName;
+bool MedicineManager::addRecord(MedicineRecord &&r)
+{
+    return insertNode(nodePool.create(std::move(r.name), std::move(r.dose), std::move(r.timings), std::move(r.category),
+                                      r.stockQuantity, r.lowStockThreshold),
+                      true);
 }
 
-ReminderNode *ReminderScheduler::searchNode(ReminderNode *node, const std::string &medicine, const std::string &time)
+bool MedicineManager::insertNode(Medicine *medicine, bool staged)
 {
-    if (node == nullptr)
+    // Names are unique: the index refuses a second node with the same name
+    if (!nameIndex.insert(medicine))
     {
-        return nullptr;
+        nodePool.destroy(medicine);
+        return false;
     }
 
-    int searchTimeValue = ReminderNode::timeToValue(time);
-
-    if (searchTimeValue == node->timeValue && node->medicineName == medicine)
+    categoryIndex.insert(medicine);
+    lowStockIndex.insert(medicine);
+    if (staged)
     {
-        return node;
+        prefixIndex.stage(medicine);
     }
-    else if (searchTimeValue < node->timeValue)
+    else
     {
-        return searchNode(node->left, medicine, time);
+        prefixIndex.insert(medicine);
     }
-    else
+
+    // Insert at head for O(1) insertion
+    medicine->sequence = nextSequence++;
+    medicine->next = head;
+    if (head != nullptr)
     {
-        return searchNode(node->right, medicine, time);
+        head->prev = medicine;
     }
+    head = medicine;
+    medicineCount++;
+    // Newest first, so sequences fall along the list: complement them
+    listing.put(~medicine->sequence, toRecord(*medicine));
+    return true;
 }
 
-ReminderNode *ReminderScheduler::deleteNode(ReminderNode *node, const std::string &medicine, const std::string &time)
+bool MedicineManager::addMedicine(const std::string &name, const std::string &dose,
+                                  const std::string &timings, const std::string &category)
 {
-    if (node == nullptr)
-    {
-        return nullptr;
-    }
+    return insertNode(nodePool.create(name, dose, timings, category));
+}
 
-    int deleteTimeValue = ReminderNode::timeToValue(time);
+bool MedicineManager::addMedicineWithStock(const std::string &name, const std::string &dose,
+                                           const std::string &timings, const std::string &category,
+                                           int stock, int threshold)
+{
+    // Create new medicine node with stock information
+    return insertNode(nodePool.create(name, dose, timings, category, stock, threshold));
+}
 
-    if (deleteTimeValue < node->timeValue)
+bool MedicineManager::deleteMedicine(const std::string &name)
+{
+    // Find the node through the index, then unlink it from both neighbours
+    Medicine *medicine = nameIndex.erase(name);
+    if (medicine == nullptr)
     {
-        node->left = deleteNode(node->left, medicine, time);
+        return false;
     }
-    else if (deleteTimeValue > node->timeValue)
+
+    if (medicine->prev != nullptr)
     {
-        node->right = deleteNode(node->right, medicine, time);
+        medicine->prev->next = medicine->next;
     }
-    else if (node->medicineName == medicine)
+    else
     {
-        // Node found, delete it
-        if (node->left == nullptr)
-        {
-            ReminderNode *temp = node->right;
-            delete node;
-            return temp;
-        }
-        else if (node->right == nullptr)
-        {
-            ReminderNode *temp = node->left;
-            delete node;
-            return temp;
-        }
-
-        // Node has two children
-        ReminderNode *temp = findMin(node->right);
-        node->medicineName = temp->medicineName;
-        node->time = temp->time;
-        node->timeValue = temp->timeValue;
-        node->right = deleteNode(node->right, temp->medicineName, temp->time);
+        head = medicine->next;
     }
-
-    return node;
-}
-
-bool ReminderScheduler::deleteReminder(const std::string &medicine, const std::string &time)
-{
-    ReminderNode *found = searchNode(root, medicine, time);
-    if (found == nullptr)
+    if (medicine->next != nullptr)
     {
-        return false;
+        medicine->next->prev = medicine->prev;
     }
+    categoryIndex.erase(medicine);
+    lowStockIndex.erase(medicine, medicine->stockQuantity);
+    prefixIndex.erase(medicine);
+    listing.erase(~medicine->sequence);
 
-    root = deleteNode(root, medicine, time);
-    reminderCount--;
+    nodePool.destroy(medicine);
+    medicineCount--;
     return true;
 }
 
-//// queue
+Medicine *MedicineManager::searchMedicine(const std::string &name) const
+{
+    return nameIndex.find(name);
+}
 
-ReminderQueue::ReminderQueue() : front(nullptr), rear(nullptr), queueSize(0) {}
+void MedicineManager::setStock(Medicine *medicine, int quantity)
+{
+    lowStockIndex.erase(medicine, medicine->stockQuantity);
+    medicine->stockQuantity = quantity;
+    lowStockIndex.insert(medicine);
+    listing.put(~medicine->sequence, toRecord(*medicine));
+}
 
-ReminderQueue::~ReminderQueue()
+bool MedicineManager::updateStock(const std::string &name, int quantity)
 {
-    while (!isEmpty())
+    // Search for medicine and update stock quantity
+    Medicine *med = searchMedicine(name);
+    if (med != nullptr)
     {
-        dequeue();
+        setStock(med, quantity);
+        return true;
     }
+    return false;
 }
 
-void ReminderQueue::enqueue(const std::string &medicine, const std::string &time)
+bool MedicineManager::decreaseStock(const std::string &name, int quantity)
 {
-    // Create new queue node
-    QueueNode *newNode = new QueueNode(medicine, time);
-
-    // If queue is empty
-    if (rear == nullptr)
-    {
-        front = rear = newNode;
-    }
-    else
+    // Search for medicine and decrease stock
+    Medicine *med = searchMedicine(name);
+    if (med != nullptr)
     {
-        // Add at rear and update rear pointer
-        rear->next = newNode;
-        rear = newNode;
+        if (med->stockQuantity >= quantity)
+        {
+            setStock(med, med->stockQuantity - quantity);
+            return true;
+        }
     }
-
-    queueSize++;
+    return false;
 }
 
-std::string ReminderQueue::dequeue()
+bool MedicineManager::isLowStock(const std::string &name) const
 {
-    // Check if queue is empty
-    if (isEmpty())
+    // Check if medicine stock is below threshold
+    Medicine *med = searchMedicine(name);
+    if (med != nullptr)
     {
-        return "Queue is empty";
+        return med->stockQuantity <= med->lowStockThreshold;
     }
+    return false;
+}
 
-    // Store front node data
-    QueueNode *temp = front;
-    std::string result = temp->time + " - " + temp->medicineName;
+std::string MedicineManager::getLowStockMedicines() const
+{
+    std::stringstream ss;
+    ss << "Low Stock Alerts:\n";
 
-    // Move front pointer
-    front = front->next;
+    int count = 1;
+    lowStockIndex.forEach([&](const Medicine &current)
+                          { ss << count++ << ". " << current.name
+                               << " - Stock: " << current.stockQuantity
+                               << " (Threshold: " << current.lowStockThreshold << ")\n"; });
 
-    // If queue becomes empty, update rear
-    if (front == nullptr)
+    if (lowStockIndex.size() == 0)
     {
-        rear = nullptr;
+        ss << "All medicines have adequate stock.\n";
     }
 
-    delete temp;
-    queueSize--;
+    return ss.str();
+}
+
+std::string MedicineManager::getStockLevels(const std::vector<MedicineRecord> &records)
+{
+    std::stringstream ss;
+    ss << "Stock Levels (" << records.size() << " medicines):\n";
+
+    int count = 1;
+    for (const MedicineRecord &current : records)
+    {
+        ss << count++ << ". " << current.name
+           << " - Stock: " << current.stockQuantity
+           << " | Threshold: " << current.lowStockThreshold;
+
+        if (current.stockQuantity == 0)
+        {
+            ss << " [OUT OF STOCK]";
+        }
+        else if (current.stockQuantity <= current.lowStockThreshold)
+        {
+            ss << " [LOW STOCK]";
+        }
+
+        ss << "\n";
+    }
+
+    if (records.empty())
+    {
+        ss << "No medicines in inventory.\n";
+    }
+
+    return ss.str();
+}
+
+std::string MedicineManager::getAllMedicines(const std::vector<MedicineRecord> &records)
+{
+    std::stringstream ss;
+    ss << "All Medicines (" << records.size() << "):\n";
+
+    int count = 1;
+    for (const MedicineRecord &current : records)
+    {
+        ss << count++ << ". " << current.name
+           << " | Dose: " << current.dose
+           << " | Timings: " << current.timings
+           << " | Category: " << current.category << "\n";
+    }
+
+    if (records.empty())
+    {
+        ss << "No medicines added yet.\n";
+    }
+
+    return ss.str();
+}
+
+void MedicineManager::copyCategory(const std::string &category, std::vector<MedicineRecord> &out) const
+{
+    out.reserve(categoryIndex.count(category));
+    for (Medicine *current = categoryIndex.first(category); current != nullptr; current = current->categoryNext)
+    {
+        out.push_back(toRecord(*current));
+    }
+}
+
+void MedicineManager::copyLowStock(std::vector<MedicineRecord> &out) const
+{
+    out.reserve(lowStockIndex.size());
+    lowStockIndex.forEach([&](const Medicine &current)
+                          { out.push_back(toRecord(current)); });
+}
+
+std::string MedicineManager::getMedicinesByCategory(const std::string &category) const
+{
+    std::stringstream ss;
+    ss << "Medicines in " << category << " (" << categoryIndex.count(category) << "):\n";
+
+    Medicine *current = categoryIndex.first(category);
+    if (current == nullptr)
+    {
+        ss << "No medicines in this category.\n";
+    }
+
+    int count = 1;
+    for (; current != nullptr; current = current->categoryNext)
+    {
+        ss << count++ << ". " << current->name
+           << " | Dose: " << current->dose
+           << " | Timings: " << current->timings << "\n";
+    }
+
+    return ss.str();
+}
+
+// Reminder node
+
+bool ReminderNode::parseTime(const std::string &time, int &minute)
+{
+    // Exactly HH:MM, 00:00 to 23:59
+    if (time.length() != 5 || time[2] != ':')
+    {
+        return false;
+    }
+    for (int i : {0, 1, 3, 4})
+    {
+        if (time[i] < '0' || time[i] > '9')
+        {
+            return false;
+        }
+    }
+    int hours = (time[0] - '0') * 10 + (time[1] - '0');
+    int minutes = (time[3] - '0') * 10 + (time[4] - '0');
+    if (hours > 23 || minutes > 59)
+    {
+        return false;
+    }
+    minute = hours * 60 + minutes;
+    return true;
+}
+
+// Reminder timing wheel
+
+ReminderScheduler::ReminderScheduler() : slots(), occupied(), reminderCount(0), nextSequence(1), nodePool("ReminderNode") {}
+
+// Minute in the high bits, link order below: ascends along the listing
+static uint64_t listingKey(const ReminderNode &node)
+{
+    return static_cast<uint64_t>(node.minute) << 48 | node.sequence;
+}
+
+ReminderScheduler::~ReminderScheduler()
+{
+    // Nodes are destroyed with their pool
+}
+
+void ReminderScheduler::clear()
+{
+    nodePool.reset();
+    slots.reset();
+    for (uint64_t &word : occupied)
+    {
+        word = 0;
+    }
+    reminderCount = 0;
+    listing.reset();
+}
+
+int ReminderScheduler::currentMinute()
+{
+    std::time_t now = std::time(nullptr);
+    std::tm local{};
+#ifdef _WIN32
+    localtime_s(&local, &now);
+#else
+    localtime_r(&now, &local);
+#endif
+    return local.tm_hour * 60 + local.tm_min;
+}
+
+void ReminderScheduler::link(ReminderNode *node)
+{
+    // Append so reminders sharing a minute keep insertion order
+    if (!slots)
+    {
+        slots.reset(new Slot[MINUTES_PER_DAY]());
+    }
+    Slot &slot = slots[node->minute];
+    node->sequence = nextSequence++;
+    node->next = nullptr;
+    node->prev = slot.tail;
+    if (slot.tail != nullptr)
+    {
+        slot.tail->next = node;
+    }
+    else
+    {
+        slot.head = node;
+        occupied[node->minute / 64] |= uint64_t(1) << (node->minute % 64);
+    }
+    slot.tail = node;
+    listing.put(listingKey(*node), ReminderRecord{node->medicineName, node->time});
+}
+
+void ReminderScheduler::unlink(ReminderNode *node)
+{
+    Slot &slot = slots[node->minute];
+    if (node->prev != nullptr)
+    {
+        node->prev->next = node->next;
+    }
+    else
+    {
+        slot.head = node->next;
+    }
+    if (node->next != nullptr)
+    {
+        node->next->prev = node->prev;
+    }
+    else
+    {
+        slot.tail = node->prev;
+    }
+    if (slot.head == nullptr)
+    {
+        occupied[node->minute / 64] &= ~(uint64_t(1) << (node->minute % 64));
+    }
+}
+
+int ReminderScheduler::nextOccupied(int minute) const
+{
+    // Mask off the bits before minute in its word, then take the lowest set
+    // bit of the first non-zero word
+    const int words = (MINUTES_PER_DAY + 63) / 64;
+    int word = minute / 64;
+    if (word >= words)
+    {
+        return -1;
+    }
+    uint64_t bits = occupied[word] & (~uint64_t(0) << (minute % 64));
+    while (bits == 0)
+    {
+        if (++word == words)
+        {
+            return -1;
+        }
+        bits = occupied[word];
+    }
+    int lowest = 0;
+    while ((bits & 1) == 0)
+    {
+        bits >>= 1;
+        lowest++;
+    }
+    return word * 64 + lowest;
+}
+
+bool ReminderScheduler::addReminder(const std::string &medicine, const std::string &time)
+{
+    int minute;
+    if (!ReminderNode::parseTime(time, minute))
+    {
+        return false;
+    }
+    link(nodePool.create(medicine, time, minute));
+    reminderCount++;
+    return true;
+}
+
+void ReminderScheduler::reserve(size_t count)
+{
+    nodePool.reserve(count);
+}
+
+bool ReminderScheduler::addRecord(ReminderRecord &&record)
+{
+    int minute;
+    if (!ReminderNode::parseTime(record.time, minute))
+    {
+        return false;
+    }
+    link(nodePool.create(std::move(record.medicineName), std::move(record.time), minute));
+    reminderCount++;
+    return true;
+}
+
+void ReminderScheduler::bulkLoad(std::vector<ReminderRecord> &&sorted)
+{
+    clear();
+    nodePool.reserve(sorted.size());
+    for (ReminderRecord &record : sorted)
+    {
+        int minute;
+        if (ReminderNode::parseTime(record.time, minute))
+        {
+            link(nodePool.create(std::move(record.medicineName), std::move(record.time), minute));
+            reminderCount++;
+        }
+    }
+}
+
+void ReminderScheduler::copyRange(int fromMinute, int toMinute, std::vector<ReminderRecord> &out) const
+{
+    if (fromMinute > toMinute)
+    {
+        // Overnight window: evening part, then the morning part
+        copyRange(fromMinute, MINUTES_PER_DAY - 1, out);
+        copyRange(0, toMinute, out);
+        return;
+    }
+    for (int minute = nextOccupied(fromMinute); minute != -1 && minute <= toMinute; minute = nextOccupied(minute + 1))
+    {
+        for (const ReminderNode *node = slots[minute].head; node != nullptr; node = node->next)
+        {
+            out.push_back(ReminderRecord{node->medicineName, node->time});
+        }
+    }
+}
+
+std::string ReminderScheduler::getRemindersInOrder(const std::vector<ReminderRecord> &records)
+{
+    std::stringstream ss;
+    ss << "Scheduled Reminders (" << records.size() << "):\n";
+
+    if (records.empty())
+    {
+        ss << "No reminders scheduled.\n";
+    }
+
+    for (const ReminderRecord &record : records)
+    {
+        ss << "- " << record.time << " - " << record.medicineName << "\n";
+    }
+
+    return ss.str();
+}
+
+const ReminderNode *ReminderScheduler::nextAtOrAfter(int minute, bool &wrapped) const
+{
+    int found = nextOccupied(minute);
+    wrapped = found == -1;
+    if (wrapped)
+    {
+        // Nothing left today: earliest reminder tomorrow
+        found = nextOccupied(0);
+    }
+    return found == -1 ? nullptr : slots[found].head;
+}
+
+std::string ReminderScheduler::getNextReminder() const
+{
+    bool wrapped;
+    const ReminderNode *next = nextAtOrAfter(currentMinute(), wrapped);
+    if (next == nullptr)
+    {
+        return "No upcoming reminders";
+    }
+    return next->time + " - " + next->medicineName + (wrapped ? " (tomorrow)" : "");
+}
+
+bool ReminderScheduler::deleteReminder(const std::string &medicine, const std::string &time)
+{
+    int minute;
+    if (!ReminderNode::parseTime(time, minute) || !slots)
+    {
+        return false;
+    }
+    for (ReminderNode *node = slots[minute].head; node != nullptr; node = node->next)
+    {
+        if (node->medicineName == medicine)
+        {
+            unlink(node);
+            listing.erase(listingKey(*node));
+            nodePool.destroy(node);
+            reminderCount--;
+            return true;
+        }
+    }
+    return false;
+}
+
+//// queue
+
+ReminderQueue::ReminderQueue(size_t capacity) : ring(capacity), dropped(0), taken(0) {}
+
+void ReminderQueue::clear()
+{
+    taken += returned.size();
+    returned.clear();
+    ReminderRecord discarded;
+    while (ring.tryPop(discarded))
+    {
+        taken++;
+    }
+    listing.reset();
+}
+
+bool ReminderQueue::enqueue(const std::string &medicine, const std::string &time)
+{
+    ReminderRecord record{medicine, time};
+    size_t position;
+    if (!ring.tryPush(record, position))
+    {
+        dropped++;
+        return false;
+    }
+    // Entries are keyed by position from the first ever queued. Each take
+    // from the front counts in taken and each put back uncounts, so an entry
+    // in the ring keeps the position the ring gave it
+    listing.put(position, std::move(record));
+    return true;
+}
+
+bool ReminderQueue::tryDequeue(ReminderRecord &out)
+{
+    if (!returned.empty())
+    {
+        out = std::move(returned.front());
+        returned.pop_front();
+    }
+    else if (!ring.tryPop(out))
+    {
+        return false;
+    }
+    listing.erase(taken);
+    taken++;
+    return true;
+}
+
+void ReminderQueue::requeueFront(const ReminderRecord &reminder)
+{
+    returned.push_front(reminder);
+    taken--;
+    listing.put(taken, reminder);
+}
 
-    return result;
+std::string ReminderQueue::dequeue()
+{
+    ReminderRecord front;
+    if (!tryDequeue(front))
+    {
+        return "Queue is empty";
+    }
+    return front.time + " - " + front.medicineName;
 }
 
 std::string ReminderQueue::peek() const
 {
-    if (isEmpty())
+    ReminderRecord front;
+    if (!returned.empty())
+    {
+        front = returned.front();
+    }
+    else if (!ring.peek(front))
     {
         return "Queue is empty";
     }
-    return front->time + " - " + front->medicineName;
+    return front.time + " - " + front.medicineName;
+}
+
+PoolStats ReminderQueue::getPoolStats() const
+{
+    size_t cells = ring.allocated() ? ring.capacity() : 0;
+    return PoolStats{"QueueCell", cells != 0 ? 1u : 0u, cells, ring.size(), cells * sizeof(ReminderRecord)};
 }
 
-std::string ReminderQueue::getAllReminders() const
+std::string ReminderQueue::getAllReminders(const std::vector<ReminderRecord> &records)
 {
     std::stringstream ss;
-    ss << "Reminder Queue (" << queueSize << "):\n";
+    ss << "Reminder Queue (" << records.size() << "):\n";
+
+    if (records.empty())
+    {
+        ss << "No reminders in queue.\n";
+    }
+    else
+    {
+        int count = 1;
+        for (const ReminderRecord &record : records)
+        {
+            ss << count++ << ". " << record.time << " - " << record.medicineName << "\n";
+        }
+    }
 
-    if (isEmpty())
+    return ss.str();
+}
+
+////// undo
+
+HistoryRecord describeAction(const Action &action)
+{
+    if (auto *a = std::get_if<AddCategoryAction>(&action))
+    {
+        return HistoryRecord{"ADD_CATEGORY", "Added category: " + a->category};
+    }
+    if (auto *a = std::get_if<RemoveCategoryAction>(&action))
+    {
+        return HistoryRecord{"REMOVE_CATEGORY", "Removed category: " + a->category};
+    }
+    if (auto *a = std::get_if<AddMedicineAction>(&action))
+    {
+        const MedicineRecord &med = *a->medicine;
+        if (a->withStock)
+        {
+            return HistoryRecord{"ADD_MEDICINE_WITH_STOCK",
+                                 "Added medicine with stock: " + med.name + " (Stock: " + std::to_string(med.stockQuantity) + ")"};
+        }
+        return HistoryRecord{"ADD_MEDICINE", "Added medicine: " + med.name + " (" + med.category + ")"};
+    }
+    if (auto *a = std::get_if<DeleteMedicineAction>(&action))
+    {
+        return HistoryRecord{"DELETE_MEDICINE", "Deleted medicine: " + a->medicine->name};
+    }
+    if (auto *a = std::get_if<UpdateStockAction>(&action))
+    {
+        return HistoryRecord{"UPDATE_STOCK", "Updated stock of " + a->name + " from " + std::to_string(a->before) +
+                                                 " to " + std::to_string(a->after)};
+    }
+    if (auto *a = std::get_if<DecreaseStockAction>(&action))
+    {
+        return HistoryRecord{"DECREASE_STOCK", "Decreased stock for " + a->name + " by " + std::to_string(a->quantity)};
+    }
+    if (auto *a = std::get_if<ScheduleReminderAction>(&action))
+    {
+        return HistoryRecord{"SCHEDULE_REMINDER",
+                             "Scheduled reminder: " + a->reminder.medicineName + " at " + a->reminder.time};
+    }
+    if (auto *a = std::get_if<DeleteReminderAction>(&action))
+    {
+        return HistoryRecord{"DELETE_REMINDER",
+                             "Deleted reminder: " + a->reminder.medicineName + " at " + a->reminder.time};
+    }
+    if (auto *a = std::get_if<BatchAction>(&action))
+    {
+        return HistoryRecord{"BATCH", "Applied batch of " + std::to_string(a->actions.size()) + " operations"};
+    }
+    const MarkTakenAction &taken = std::get<MarkTakenAction>(action);
+    return HistoryRecord{"MARK_TAKEN", "Marked as taken: " + taken.reminder.time + " - " + taken.reminder.medicineName};
+}
+
+// Op codes of WAL records. They are stored on disk: only ever add new ones
+enum WalOp : uint8_t
+{
+    WAL_ADD_CATEGORY = 1,
+    WAL_REMOVE_CATEGORY = 2,
+    WAL_ADD_MEDICINE = 3,
+    WAL_ADD_MEDICINE_WITH_STOCK = 4,
+    WAL_DELETE_MEDICINE = 5,
+    WAL_UPDATE_STOCK = 6,
+    WAL_DECREASE_STOCK = 7,
+    WAL_SCHEDULE_REMINDER = 8,
+    WAL_DELETE_REMINDER = 9,
+    WAL_DISPATCH = 10,
+    WAL_MARK_TAKEN = 11,
+    WAL_UNDO = 12,
+    WAL_REDO = 13,
+    WAL_BATCH = 14,
+    WAL_IMPORT_MEDICINES = 15,
+    WAL_IMPORT_REMINDERS = 16
+};
+
+bool MedicineReminderSystem::applyLocked(Action &action, bool reverse)
+{
+    if (auto *a = std::get_if<AddCategoryAction>(&action))
+    {
+        return reverse ? categoryManager.removeCategory(a->category) : categoryManager.addCategory(a->category);
+    }
+    if (auto *a = std::get_if<RemoveCategoryAction>(&action))
+    {
+        return reverse ? categoryManager.addCategory(a->category) : categoryManager.removeCategory(a->category);
+    }
+
+    // Adding and deleting a medicine are each other's inverse
+    auto addRecord = [this](const MedicineRecord &med)
+    {
+        return medicineManager.addMedicineWithStock(med.name, med.dose, med.timings, med.category,
+                                                    med.stockQuantity, med.lowStockThreshold);
+    };
+    if (auto *a = std::get_if<AddMedicineAction>(&action))
+    {
+        MedicineRecord &med = *a->medicine;
+        if (reverse)
+        {
+            return medicineManager.deleteMedicine(med.name);
+        }
+        if (a->withStock)
+        {
+            return addRecord(med);
+        }
+        // Plain add: the stock defaults it got are what a later undo/redo restores
+        if (!medicineManager.addMedicine(med.name, med.dose, med.timings, med.category))
+        {
+            return false;
+        }
+        const Medicine *node = medicineManager.searchMedicine(med.name);
+        med.stockQuantity = node->stockQuantity;
+        med.lowStockThreshold = node->lowStockThreshold;
+        return true;
+    }
+    if (auto *a = std::get_if<DeleteMedicineAction>(&action))
+    {
+        return reverse ? addRecord(*a->medicine) : medicineManager.deleteMedicine(a->medicine->name);
+    }
+
+    if (auto *a = std::get_if<UpdateStockAction>(&action))
+    {
+        Medicine *med = medicineManager.searchMedicine(a->name);
+        if (med == nullptr)
+        {
+            return false;
+        }
+        int before = med->stockQuantity;
+        if (!reverse)
+        {
+            // Filled in for batched updates; on redo it is the same value again
+            a->before = before;
+        }
+        if (!medicineManager.updateStock(a->name, reverse ? a->before : a->after))
+        {
+            return false;
+        }
+        noteStockLocked(*med, before);
+        return true;
+    }
+    if (auto *a = std::get_if<DecreaseStockAction>(&action))
+    {
+        Medicine *med = medicineManager.searchMedicine(a->name);
+        if (med == nullptr)
+        {
+            return false;
+        }
+        int before = med->stockQuantity;
+        bool changed = reverse ? medicineManager.updateStock(a->name, before + a->quantity)
+                               : medicineManager.decreaseStock(a->name, a->quantity);
+        if (changed)
+        {
+            noteStockLocked(*med, before);
+        }
+        return changed;
+    }
+
+    if (auto *a = std::get_if<ScheduleReminderAction>(&action))
+    {
+        const ReminderRecord &r = a->reminder;
+        return reverse ? reminderScheduler.deleteReminder(r.medicineName, r.time)
+                       : reminderScheduler.addReminder(r.medicineName, r.time);
+    }
+    if (auto *a = std::get_if<DeleteReminderAction>(&action))
+    {
+        const ReminderRecord &r = a->reminder;
+        return reverse ? reminderScheduler.addReminder(r.medicineName, r.time)
+                       : reminderScheduler.deleteReminder(r.medicineName, r.time);
+    }
+
+    // A batch goes forward in order and back in reverse. If a step is refused
+    // part way, the steps already taken are walked back, so it is all or nothing
+    if (auto *a = std::get_if<BatchAction>(&action))
+    {
+        std::vector<Action> &steps = a->actions;
+        size_t noted = pendingEvents.size();
+        for (size_t done = 0; done < steps.size(); done++)
+        {
+            Action &step = steps[reverse ? steps.size() - 1 - done : done];
+            if (!applyLocked(step, reverse))
+            {
+                while (done-- > 0)
+                {
+                    applyLocked(steps[reverse ? steps.size() - 1 - done : done], !reverse);
+                }
+                pendingEvents.resize(noted);    // Nothing happened
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Taking a dose: the reminder leaves the front of the due queue and, if
+    // there was stock, one unit goes with it. Undo puts both back exactly.
+    MarkTakenAction &taken = std::get<MarkTakenAction>(action);
+    if (reverse)
+    {
+        reminderQueue.requeueFront(taken.reminder);
+        Medicine *med = medicineManager.searchMedicine(taken.reminder.medicineName);
+        if (taken.stockTaken && med != nullptr)
+        {
+            medicineManager.updateStock(med->name, med->stockQuantity + 1);
+            noteStockLocked(*med, med->stockQuantity - 1);
+        }
+        return true;
+    }
+    ReminderRecord front;
+    if (!reminderQueue.tryDequeue(front))
+    {
+        return false;
+    }
+    taken.reminder = std::move(front);
+    noteLocked(ChangeEvent{ChangeKind::ReminderTaken, taken.reminder.medicineName, taken.reminder.time, 0, 0, {}});
+    Medicine *med = medicineManager.searchMedicine(taken.reminder.medicineName);
+    int before = med != nullptr ? med->stockQuantity : 0;
+    taken.stockTaken = medicineManager.decreaseStock(taken.reminder.medicineName, 1);
+    if (taken.stockTaken)
+    {
+        noteStockLocked(*med, before);
+    }
+    return true;
+}
+
+bool MedicineReminderSystem::undo()
+{
+    std::unique_lock<std::shared_mutex> lock(stateMutex);
+    Action action;
+    if (readOnly || !undoManager.popUndo(action))
+    {
+        return false;
+    }
+    // Logged even when the action is dropped: popping it changed the history
+    bool applied = applyLocked(action, true);
+    if (applied)
+    {
+        noteLocked(ChangeEvent{ChangeKind::Undo, "", "", 0, 0, describeAction(action)});
+        undoManager.pushRedo(std::move(action));
+    }
+    return logLocked(lock, WalRecord(WAL_UNDO)) && applied;
+}
+
+bool MedicineReminderSystem::redo()
+{
+    std::unique_lock<std::shared_mutex> lock(stateMutex);
+    Action action;
+    if (readOnly || !undoManager.popRedo(action))
+    {
+        return false;
+    }
+    bool applied = applyLocked(action, false);
+    if (applied)
+    {
+        noteLocked(ChangeEvent{ChangeKind::Redo, "", "", 0, 0, describeAction(action)});
+        undoManager.pushRedone(std::move(action));
+    }
+    return logLocked(lock, WalRecord(WAL_REDO)) && applied;
+}
+
+UndoManager::UndoManager(size_t depth) : depth(depth > 0 ? depth : 1), oldest(0), count(0), height(0) {}
+
+void UndoManager::clear()
+{
+    ring.clear();
+    redoStack.clear();
+    oldest = 0;
+    count = 0;
+    listing.reset();
+}
+
+void UndoManager::pushUndo(Action &&action)
+{
+    // Listed by stack position, complemented so it ascends newest to oldest.
+    // An entry's position only changes by being undone, so a cursor stays
+    // put while newer entries come and go
+    Action *stored;
+    if (ring.size() < depth)
+    {
+        // Still growing towards depth: entries are in push order
+        ring.push_back(std::move(action));
+        stored = &ring.back();
+        count++;
+    }
+    else if (count < depth)
+    {
+        // Ring allocated, with free slots after undos
+        stored = &ring[(oldest + count) % depth];
+        *stored = std::move(action);
+        count++;
+    }
+    else
+    {
+        // Full: overwrite the oldest entry in place, O(1)
+        listing.erase(~(height - count));
+        stored = &ring[oldest];
+        *stored = std::move(action);
+        oldest = (oldest + 1) % depth;
+    }
+    listing.put(~height, describeAction(*stored));
+    height++;
+}
+
+void UndoManager::record(Action &&action)
+{
+    redoStack.clear();
+    pushUndo(std::move(action));
+}
+
+bool UndoManager::popUndo(Action &out)
+{
+    if (count == 0)
+    {
+        return false;
+    }
+    size_t newest = (oldest + count - 1) % ring.size();
+    out = std::move(ring[newest]);
+    listing.erase(~(height - 1));
+    count--;
+    height--;
+    if (ring.size() < depth)
+    {
+        // Not wrapped yet: keep the vector's length equal to the entry count
+        ring.pop_back();
+    }
+    return true;
+}
+
+void UndoManager::pushRedo(Action &&action)
+{
+    redoStack.push_back(std::move(action));
+}
+
+bool UndoManager::popRedo(Action &out)
+{
+    if (redoStack.empty())
+    {
+        return false;
+    }
+    out = std::move(redoStack.back());
+    redoStack.pop_back();
+    return true;
+}
+
+PoolStats UndoManager::getPoolStats() const
+{
+    return PoolStats{"UndoEntry", 1, ring.capacity(), count, ring.capacity() * sizeof(Action)};
+}
+
+std::string UndoManager::getHistory(const std::vector<HistoryRecord> &records)
+{
+    std::stringstream ss;
+    ss << "Action History (" << records.size() << " recent actions):\n";
+
+    if (records.empty())
+    {
+        ss << "No actions recorded yet.\n";
+    }
+    else
+    {
+        int count = 1;
+        for (const HistoryRecord &record : records)
+        {
+            ss << count++ << ". " << record.type << " - " << record.details << "\n";
+        }
+    }
+
+    return ss.str();
+}
+
+/////////////////////////////////////////////////
+
+MedicineReminderSystem::MedicineReminderSystem(size_t historyDepth)
+    : undoManager(historyDepth), readOnly(false), snapshotLsn(0), snapshotBusy(false) {}
+
+MedicineReminderSystem::~MedicineReminderSystem()
+{
+    closeLog();
+}
+
+/// persistence
+
+bool MedicineReminderSystem::enableLog(const WalConfig &config)
+{
+    // Snapshot first, then only the log records written after it
+    uint64_t afterLsn = 0;
+    {
+        SnapshotFile snapshot;
+        if (snapshot.open(config.snapshotPath))
+        {
+            std::unique_lock<std::shared_mutex> lock(stateMutex);
+            if (!loadSnapshot(snapshot.payload(), snapshot.payloadSize()))
+            {
+                std::cerr << "Snapshot " << config.snapshotPath << " does not decode\n";
+                return false;
+            }
+            afterLsn = snapshot.getLsn();
+        }
+        else if (!snapshot.getError().empty())
+        {
+            // Not falling back to the log alone: it has been cut back to the snapshot
+            std::cerr << "Snapshot: " << snapshot.getError() << "\n";
+            return false;
+        }
+    }
+
+    // Replay goes through the ordinary operations; wal is still null, so
+    // nothing is logged twice. Undo and redo replay exactly because the
+    // history they act on is rebuilt by the same sequence of records
+    // (as long as historyDepth is unchanged between runs).
+    auto log = std::make_unique<WriteAheadLog>(config);
+    bool opened = log->open([this](uint64_t, const char *payload, size_t size)
+                            { replayRecord(payload, size); },
+                            afterLsn);
+    if (!opened)
+    {
+        return false;
+    }
+    std::unique_lock<std::shared_mutex> lock(stateMutex);
+    wal = std::move(log);
+    snapshotLsn = afterLsn;
+    return true;
+}
+
+void MedicineReminderSystem::closeLog()
+{
+    if (!wal || !wal->isOpen())
+    {
+        return;
+    }
+    {
+        // A final snapshot, so the next start-up has no log to replay. Not
+        // after a log failure: memory then holds changes reported as failed
+        std::unique_lock<std::shared_mutex> lock(stateMutex);
+        // A periodic snapshot still encoding needs stateMutex shared, so wait
+        // for it with the lock released; none can start while we hold it
+        while (snapshotBusy)
+        {
+            lock.unlock();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            lock.lock();
+        }
+        uint64_t lsn = wal->getLastLsn();
+        if (lsn > snapshotLsn && !readOnly)
+        {
+            startSnapshotLocked(lsn);
+        }
+    }
+    if (snapshotWriter.joinable())
+    {
+        snapshotWriter.join();
+    }
+    wal->close();
+}
+
+void MedicineReminderSystem::startSnapshotLocked(uint64_t lsn)
+{
+    if (snapshotWriter.joinable())
+    {
+        snapshotWriter.join();  // Already finished: snapshotBusy was clear
+    }
+    snapshotBusy = true;
+    snapshotLsn = lsn;
+
+    // Encoding and file I/O both happen off the request path, once the
+    // caller's lock is gone; the log is cut back only once the snapshot is
+    // safely on disk
+    WriteAheadLog *log = wal.get();
+    snapshotWriter = std::thread([this, log]()
+                                 {
+        std::string payload;
+        uint64_t covered = 0;
+        if (!encodeSnapshot(payload, covered))
+        {
+            // Read-only: memory holds changes that were reported as failed
+        }
+        else if (writeSnapshotFile(log->getConfig().snapshotPath, covered, payload))
+        {
+            log->discardThrough(covered);
+        }
+        else
+        {
+            std::cerr << "Snapshot: writing " << log->getConfig().snapshotPath << " failed\n";
+        }
+        snapshotBusy = false; });
+}
+
+// Shared by the medicine section and medicine-carrying actions; works on
+// both the live nodes and MedicineRecord
+template <typename MedicineLike>
+static void encodeMedicine(WalRecord &out, const MedicineLike &med)
+{
+    out.str(med.name).str(med.dose).str(med.timings).str(med.category).i32(med.stockQuantity).i32(med.lowStockThreshold);
+}
+
+static MedicineRecord decodeMedicine(WalReader &in)
+{
+    MedicineRecord med;
+    med.name = in.str();
+    med.dose = in.str();
+    med.timings = in.str();
+    med.category = in.str();
+    med.stockQuantity = in.i32();
+    med.lowStockThreshold = in.i32();
+    return med;
+}
+
+// Action tag = variant index; the order of Action's alternatives is part of
+// the snapshot format
+static void encodeAction(WalRecord &out, const Action &action)
+{
+    out.u8(static_cast<uint8_t>(action.index()));
+    if (auto *a = std::get_if<AddCategoryAction>(&action))
+    {
+        out.str(a->category);
+    }
+    else if (auto *a = std::get_if<RemoveCategoryAction>(&action))
+    {
+        out.str(a->category);
+    }
+    else if (auto *a = std::get_if<AddMedicineAction>(&action))
+    {
+        encodeMedicine(out, *a->medicine);
+        out.u8(a->withStock ? 1 : 0);
+    }
+    else if (auto *a = std::get_if<DeleteMedicineAction>(&action))
+    {
+        encodeMedicine(out, *a->medicine);
+    }
+    else if (auto *a = std::get_if<UpdateStockAction>(&action))
+    {
+        out.str(a->name).i32(a->before).i32(a->after);
+    }
+    else if (auto *a = std::get_if<DecreaseStockAction>(&action))
+    {
+        out.str(a->name).i32(a->quantity);
+    }
+    else if (auto *a = std::get_if<ScheduleReminderAction>(&action))
+    {
+        out.str(a->reminder.medicineName).str(a->reminder.time);
+    }
+    else if (auto *a = std::get_if<DeleteReminderAction>(&action))
+    {
+        out.str(a->reminder.medicineName).str(a->reminder.time);
+    }
+    else if (auto *a = std::get_if<BatchAction>(&action))
+    {
+        out.u32(static_cast<uint32_t>(a->actions.size()));
+        for (const Action &step : a->actions)
+        {
+            encodeAction(out, step);
+        }
+    }
+    else
+    {
+        const MarkTakenAction &taken = std::get<MarkTakenAction>(action);
+        out.str(taken.reminder.medicineName).str(taken.reminder.time).u8(taken.stockTaken ? 1 : 0);
+    }
+}
+
+static bool decodeAction(WalReader &in, Action &out)
+{
+    uint8_t tag = in.op();
+    switch (tag)
+    {
+    case 0:
+        out = AddCategoryAction{in.str()};
+        return true;
+    case 1:
+        out = RemoveCategoryAction{in.str()};
+        return true;
+    case 2:
+    {
+        auto med = std::make_unique<MedicineRecord>(decodeMedicine(in));
+        out = AddMedicineAction{std::move(med), in.op() != 0};
+        return true;
+    }
+    case 3:
+        out = DeleteMedicineAction{std::make_unique<MedicineRecord>(decodeMedicine(in))};
+        return true;
+    case 4:
+    {
+        std::string name = in.str();
+        int before = in.i32();
+        out = UpdateStockAction{std::move(name), before, in.i32()};
+        return true;
+    }
+    case 5:
+    {
+        std::string name = in.str();
+        out = DecreaseStockAction{std::move(name), in.i32()};
+        return true;
+    }
+    case 6:
+    case 7:
+    case 8:
+    {
+        ReminderRecord reminder;
+        reminder.medicineName = in.str();
+        reminder.time = in.str();
+        if (tag == 6)
+        {
+            out = ScheduleReminderAction{std::move(reminder)};
+        }
+        else if (tag == 7)
+        {
+            out = DeleteReminderAction{std::move(reminder)};
+        }
+        else
+        {
+            out = MarkTakenAction{std::move(reminder), in.op() != 0};
+        }
+        return true;
+    }
+    case 9:
+    {
+        // u32 count, then the actions; each takes at least its tag byte
+        uint32_t count = in.u32();
+        if (count > in.remaining())
+        {
+            return false;
+        }
+        BatchAction batch;
+        batch.actions.resize(count);
+        for (Action &step : batch.actions)
+        {
+            if (!decodeAction(in, step))
+            {
+                return false;
+            }
+        }
+        out = std::move(batch);
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+// Payload layout (SnapshotFile::FORMAT_VERSION 1), sections in order:
+//   categories:  u32 n, n x str
+//   medicines:   u32 n, n x medicine, list order
+//   reminders:   u32 n, n x (medicine, time), time order
+//   due queue:   u32 n, n x (medicine, time), front first
+//   history:     u32 n, n x action, oldest first
+//   redo stack:  u32 n, n x action, bottom first
+bool MedicineReminderSystem::encodeSnapshot(std::string &payload, uint64_t &lsn) const
+{
+    // The bulky sections come from the published listings, which readers
+    // keep current anyway. Merged here first, unlocked, so that under the
+    // lock only the changes made in between are left to fold in
+    medicineManager.getSnapshot();
+    reminderScheduler.getSnapshot();
+    reminderQueue.getSnapshot();
+
+    std::shared_ptr<const SnapshotPart<MedicineRecord>> medicines;
+    std::shared_ptr<const SnapshotPart<ReminderRecord>> reminders, due;
+    WalRecord head, tail;   // Categories; undo and redo history
+    {
+        // Under the shared lock (and with dispatchDue kept out, as it writes
+        // under the shared lock too) the state and the log stand still, so
+        // the listings are exactly the live contents
+        std::shared_lock<std::shared_mutex> lock(stateMutex);
+        std::lock_guard<std::mutex> dispatching(dispatchMutex);
+        if (readOnly)
+        {
+            return false;
+        }
+        medicines = medicineManager.getSnapshot();
+        reminders = reminderScheduler.getSnapshot();
+        due = reminderQueue.getSnapshot();
+        lsn = wal->getLastLsn();
+
+        head.u32(static_cast<uint32_t>(categoryManager.getCount()));
+        for (int i = 0; i < categoryManager.getCount(); i++)
+        {
+            head.str(categoryManager.getCategory(i));
+        }
+        tail.u32(static_cast<uint32_t>(undoManager.getSize()));
+        undoManager.forEachUndo([&](const Action &action)
+                                { encodeAction(tail, action); });
+        tail.u32(static_cast<uint32_t>(undoManager.getRedoSize()));
+        undoManager.forEachRedo([&](const Action &action)
+                                { encodeAction(tail, action); });
+    }
+
+    WalRecord out;
+    out.data().reserve(head.data().size() + tail.data().size() + 16 + medicines->items.size() * 64 +
+                       (reminders->items.size() + due->items.size()) * 32);
+    out.data() += head.data();
+
+    out.u32(static_cast<uint32_t>(medicines->items.size()));
+    for (const MedicineRecord &med : medicines->items)
+    {
+        encodeMedicine(out, med);
+    }
+    out.u32(static_cast<uint32_t>(reminders->items.size()));
+    for (const ReminderRecord &r : reminders->items)
     {
-        ss << "No reminders in queue.\n";
+        out.str(r.medicineName).str(r.time);
     }
-    else
+    out.u32(static_cast<uint32_t>(due->items.size()));
+    for (const ReminderRecord &r : due->items)
     {
-        QueueNode *current = front;
-        int count = 1;
-        while (current != nullptr)
-        {
-            ss << count++ << ". " << current->time << " - " << current->medicineName << "\n";
-            current = current->next;
-        }
+        out.str(r.medicineName).str(r.time);
     }
 
-    return ss.str();
+    out.data() += tail.data();
+    payload = std::move(out.data());
+    return true;
 }
 
-////// undo
-
-bool MedicineReminderSystem::undo()
+bool MedicineReminderSystem::loadSnapshot(const char *payload, size_t size)
 {
-    if (undoManager.isEmpty())
-        return false;
-
-    Action action = undoManager.pop();
+    WalReader in(payload, size);
 
-    if (action.type == "ADD_CATEGORY")
+    categoryManager.clear();
+    uint32_t count = in.u32();
+    for (uint32_t i = 0; i < count; i++)
     {
-        return categoryManager.removeCategory(action.name);
+        categoryManager.addCategory(in.str());
     }
-    else if (action.type == "REMOVE_CATEGORY")
+
+    // Cap the reservations by what the payload could hold (it is checksummed,
+    // but not necessarily written by this build)
+    count = in.u32();
+    std::vector<MedicineRecord> medicines;
+    medicines.reserve(std::min<size_t>(count, size / 24));
+    for (uint32_t i = 0; i < count; i++)
     {
-        return categoryManager.addCategory(action.name);
+        medicines.push_back(decodeMedicine(in));
     }
-    else if (action.type == "ADD_MEDICINE")
+    medicineManager.bulkLoad(std::move(medicines));
+
+    count = in.u32();
+    std::vector<ReminderRecord> reminders;
+    reminders.reserve(std::min<size_t>(count, size / 8));
+    for (uint32_t i = 0; i < count; i++)
     {
-        return medicineManager.deleteMedicine(action.name);
+        ReminderRecord r;
+        r.medicineName = in.str();
+        r.time = in.str();
+        reminders.push_back(std::move(r));
     }
-    else if (action.type == "DELETE_MEDICINE")
+    reminderScheduler.bulkLoad(std::move(reminders));
+
+    reminderQueue.clear();
+    count = in.u32();
+    for (uint32_t i = 0; i < count; i++)
     {
-        //return medicineManager.addMedicine(action.name, action.dose, action.timings, action.category);
+        std::string medicine = in.str(), time = in.str();
+        reminderQueue.enqueue(medicine, time);
     }
-    else if (action.type == "UPDATE_STOCK")
+
+    undoManager.clear();
+    count = in.u32();
+    for (uint32_t i = 0; i < count; i++)
     {
-        if (action.oldStock >= 0)
-            return medicineManager.updateStock(action.name, action.oldStock);
-        else
+        Action action;
+        if (!decodeAction(in, action))
+        {
             return false;
+        }
+        undoManager.record(std::move(action));
     }
-    else if (action.type == "DECREASE_STOCK")
+    count = in.u32();
+    for (uint32_t i = 0; i < count; i++)
     {
-        Medicine *med = medicineManager.searchMedicine(action.name);
-        if (med)
+        Action action;
+        if (!decodeAction(in, action))
         {
-            med->stockQuantity += action.quantity;
-            return true;
+            return false;
         }
-        return false;
-    }
-    else if (action.type == "SCHEDULE_REMINDER")
-    {
-        return deleteReminder(action.name, action.reminderTime);
-    }
-    else if (action.type == "DELETE_REMINDER")
-    {
-        scheduleReminder(action.name, action.reminderTime);
-        return true; // Assume success for undo operation
+        undoManager.pushRedo(std::move(action));
     }
+    return in.ok();
+}
 
-    else if (action.type == "MARK_TAKEN")
+bool MedicineReminderSystem::logLocked(std::unique_lock<std::shared_mutex> &lock, const WalRecord &record)
+{
+    std::vector<ChangeEvent> events;
+    events.swap(pendingEvents);
+    if (wal)
     {
-        scheduleReminder(action.name, action.reminderTime);
-        Medicine *med = medicineManager.searchMedicine(action.name);
-        if (med)
+        // Appended while still exclusive, so the log holds changes in the order
+        // they were made; waiting happens unlocked so other writers can join the sync
+        uint64_t lsn = wal->append(record.data());
+        if (lsn == 0)
+        {
+            readOnly = true;    // The log has already failed
+            return false;
+        }
+        uint64_t every = wal->getConfig().snapshotEvery;
+        if (every > 0 && lsn >= snapshotLsn + every && !snapshotBusy)
+        {
+            startSnapshotLocked(lsn);
+        }
+        // Registered while still exclusive: the log runs callbacks in
+        // registration order, so listeners hear of changes in log order
+        if (!events.empty())
+        {
+            wal->whenDurable(lsn, [this, events = std::move(events)](bool durable)
+            {
+                if (durable)
+                {
+                    changeListener(events);
+                }
+            });
+        }
+        lock.unlock();
+        DeferredCommit* deferred = DeferredCommit::current;
+        if (deferred != nullptr)
         {
-            med->stockQuantity += 1;
+            deferred->system = this;
+            deferred->log = wal.get();
+            deferred->lsn = lsn;
             return true;
         }
-        return false;
+        if (!wal->waitDurable(lsn))
+        {
+            readOnly = true;
+            return false;
+        }
+        return true;
     }
-    return false;
+    lock.unlock();
+    if (!events.empty())
+    {
+        changeListener(events);
+    }
+    return true;
 }
 
-UndoManager::UndoManager() : top(nullptr), stackSize(0) {}
+thread_local DeferredCommit* DeferredCommit::current = nullptr;
 
-UndoManager::~UndoManager()
+DeferredCommit::DeferredCommit() : outer(current), system(nullptr), log(nullptr), lsn(0)
 {
-    while (!isEmpty())
-    {
-        pop();
-    }
+    current = this;
+}
+
+DeferredCommit::~DeferredCommit()
+{
+    current = outer;
 }
 
-void UndoManager::push(const Action &action)
+void DeferredCommit::then(std::function<void(bool durable)> done)
 {
-    // Remove oldest action if stack is full
-    if (stackSize >= MAX_HISTORY)
+    if (log == nullptr)
+    {
+        done(true);
+        return;
+    }
+    // Records become durable in log order, so the newest covers the rest
+    MedicineReminderSystem* owner = system;
+    log->whenDurable(lsn, [owner, done = std::move(done)](bool durable)
     {
-        // Remove bottom element (requires traversal)
-        if (top != nullptr)
+        if (!durable)
         {
-            if (top->next == nullptr)
-            {
-                delete top;
-                top = nullptr;
-            }
-            else
-            {
-                StackNode *current = top;
-                while (current->next->next != nullptr)
-                {
-                    current = current->next;
-                }
-                delete current->next;
-                current->next = nullptr;
-            }
-            stackSize--;
+            owner->readOnly = true;
         }
-    }
+        done(durable);
+    });
+}
 
-    // Create new node and push to top
-    StackNode *newNode = new StackNode(action);
-    newNode->next = top;
-    top = newNode;
-    stackSize++;
+void MedicineReminderSystem::setChangeListener(ChangeListener listener)
+{
+    std::unique_lock<std::shared_mutex> lock(stateMutex);
+    changeListener = std::move(listener);
 }
 
-Action UndoManager::pop()
+void MedicineReminderSystem::noteLocked(ChangeEvent &&event)
 {
-    if (isEmpty())
+    if (changeListener)
     {
-        return Action{"EMPTY", "No actions to undo", ""};
+        pendingEvents.push_back(std::move(event));
     }
-
-    // Remove and return top action
-    StackNode *temp = top;
-    Action action = temp->action;
-    top = top->next;
-    delete temp;
-    stackSize--;
-
-    return action;
 }
 
-Action UndoManager::peek() const
+void MedicineReminderSystem::noteStockLocked(const Medicine &med, int before)
 {
-    if (isEmpty())
+    if (!changeListener || med.stockQuantity == before)
+    {
+        return;
+    }
+    pendingEvents.push_back(ChangeEvent{ChangeKind::StockChanged, med.name, "", med.stockQuantity, med.lowStockThreshold, {}});
+    // Only the move that takes it to or under the threshold, not every one after
+    if (before > med.lowStockThreshold && med.stockQuantity <= med.lowStockThreshold)
     {
-        return Action{"EMPTY", "No actions to undo", ""};
+        pendingEvents.push_back(ChangeEvent{ChangeKind::LowStock, med.name, "", med.stockQuantity, med.lowStockThreshold, {}});
     }
-    return top->action;
 }
 
-std::string UndoManager::getHistory() const
+void MedicineReminderSystem::replayRecord(const char *payload, size_t size)
 {
-    std::stringstream ss;
-    ss << "Action History (" << stackSize << " recent actions):\n";
-
-    if (isEmpty())
+    WalReader in(payload, size);
+    switch (in.op())
     {
-        ss << "No actions recorded yet.\n";
+    case WAL_ADD_CATEGORY:
+        addCategory(in.str());
+        break;
+    case WAL_REMOVE_CATEGORY:
+        removeCategory(in.str());
+        break;
+    case WAL_ADD_MEDICINE:
+    {
+        std::string name = in.str(), dose = in.str(), timings = in.str(), category = in.str();
+        addMedicine(name, dose, timings, category);
+        break;
     }
-    else
+    case WAL_ADD_MEDICINE_WITH_STOCK:
     {
-        StackNode *current = top;
-        int count = 1;
-        while (current != nullptr)
+        std::string name = in.str(), dose = in.str(), timings = in.str(), category = in.str();
+        int stock = in.i32();
+        int threshold = in.i32();
+        addMedicineWithStock(name, dose, timings, category, stock, threshold);
+        break;
+    }
+    case WAL_DELETE_MEDICINE:
+        deleteMedicine(in.str());
+        break;
+    case WAL_UPDATE_STOCK:
+    {
+        std::string name = in.str();
+        updateStock(name, in.i32());
+        break;
+    }
+    case WAL_DECREASE_STOCK:
+    {
+        std::string name = in.str();
+        decreaseStock(name, in.i32());
+        break;
+    }
+    case WAL_SCHEDULE_REMINDER:
+    {
+        std::string medicine = in.str(), time = in.str();
+        scheduleReminder(medicine, time);
+        break;
+    }
+    case WAL_DELETE_REMINDER:
+    {
+        std::string medicine = in.str(), time = in.str();
+        deleteReminder(medicine, time);
+        break;
+    }
+    case WAL_DISPATCH:
+    {
+        // The reminders that actually fired, not the minute range: the
+        // schedule may have changed since
+        std::unique_lock<std::shared_mutex> lock(stateMutex);
+        uint32_t count = in.u32();
+        for (uint32_t i = 0; i < count; i++)
+        {
+            std::string medicine = in.str(), time = in.str();
+            reminderQueue.enqueue(medicine, time);
+        }
+        break;
+    }
+    case WAL_MARK_TAKEN:
+        markReminderTaken();
+        break;
+    case WAL_UNDO:
+        undo();
+        break;
+    case WAL_REDO:
+        redo();
+        break;
+    case WAL_BATCH:
+    {
+        Action batch;
+        if (!decodeAction(in, batch) || !in.ok() || !std::holds_alternative<BatchAction>(batch))
         {
-            ss << count++ << ". " << current->action.type
-               << " - " << current->action.details << "\n";
-            current = current->next;
+            std::cerr << "WAL: skipping malformed batch record\n";
+            break;
         }
+        size_t failedAt;
+        applyBatch(std::move(std::get<BatchAction>(batch).actions), failedAt);
+        break;
+    }
+    case WAL_IMPORT_MEDICINES:
+    {
+        uint32_t count = in.u32();
+        if (count > in.remaining())
+        {
+            std::cerr << "WAL: skipping malformed import record\n";
+            break;
+        }
+        std::vector<MedicineRecord> records(count);
+        for (MedicineRecord &record : records)
+        {
+            record = decodeMedicine(in);
+        }
+        std::vector<size_t> rejected;
+        importMedicines(std::move(records), rejected);
+        break;
+    }
+    case WAL_IMPORT_REMINDERS:
+    {
+        uint32_t count = in.u32();
+        if (count > in.remaining())
+        {
+            std::cerr << "WAL: skipping malformed import record\n";
+            break;
+        }
+        std::vector<ReminderRecord> records(count);
+        for (ReminderRecord &record : records)
+        {
+            record.medicineName = in.str();
+            record.time = in.str();
+        }
+        std::vector<size_t> rejected;
+        importReminders(std::move(records), rejected);
+        break;
+    }
+    default:
+        std::cerr << "WAL: skipping record with unknown op\n";
+        break;
     }
-
-    return ss.str();
 }
 
 /////////////////////////////////////////////////
 
-MedicineReminderSystem::MedicineReminderSystem() {}
-
 bool MedicineReminderSystem::addCategory(const std::string &category)
 {
-    bool success = categoryManager.addCategory(category);
+    std::unique_lock<std::shared_mutex> lock(stateMutex);
+    bool success = !readOnly && categoryManager.addCategory(category);
     if (success)
     {
-        Action action;
-        action.type = "ADD_CATEGORY";
-        action.details = "Added category: " + category;
-        undoManager.push(action);
+        undoManager.record(AddCategoryAction{category});
+        success = logLocked(lock, WalRecord(WAL_ADD_CATEGORY).str(category));
     }
     return success;
 }
 
 bool MedicineReminderSystem::removeCategory(const std::string &category)
 {
-    bool success = categoryManager.removeCategory(category);
+    std::unique_lock<std::shared_mutex> lock(stateMutex);
+    bool success = !readOnly && categoryManager.removeCategory(category);
     if (success)
     {
-        Action action;
-        action.type = "REMOVE_CATEGORY";
-        action.details = "Removed category: " + category;
-        undoManager.push(action);
+        undoManager.record(RemoveCategoryAction{category});
+        success = logLocked(lock, WalRecord(WAL_REMOVE_CATEGORY).str(category));
     }
     return success;
 }
 
 std::string MedicineReminderSystem::listCategories() const
 {
+    std::shared_lock<std::shared_mutex> lock(stateMutex);
     return categoryManager.getAllCategories();
 }
 
-void MedicineReminderSystem::addMedicine(const std::string &name, const std::string &dose,
+bool MedicineReminderSystem::addMedicine(const std::string &name, const std::string &dose,
                                          const std::string &timings, const std::string &category)
 {
-    medicineManager.addMedicine(name, dose, timings, category);
+    std::unique_lock<std::shared_mutex> lock(stateMutex);
+    if (readOnly || !medicineManager.addMedicine(name, dose, timings, category))
+    {
+        return false;
+    }
 
-    Action action;
-    action.type = "ADD_MEDICINE";
-    action.name = name;
-    action.dose = dose;
-    action.timings = timings;
-    action.category = category;
-    action.details = "Added medicine: " + name + " (" + category + ")";
-    undoManager.push(action);
+    const Medicine *med = medicineManager.searchMedicine(name);
+    undoManager.record(AddMedicineAction{std::make_unique<MedicineRecord>(MedicineRecord{
+                                             name, dose, timings, category, med->stockQuantity, med->lowStockThreshold}),
+                                         false});
+    return logLocked(lock, WalRecord(WAL_ADD_MEDICINE).str(name).str(dose).str(timings).str(category));
 }
 
 bool MedicineReminderSystem::deleteMedicine(const std::string &name)
 {
-    bool success = medicineManager.deleteMedicine(name);
-    if (success)
+    std::unique_lock<std::shared_mutex> lock(stateMutex);
+    const Medicine *med = medicineManager.searchMedicine(name);
+    if (med == nullptr || readOnly)
     {
-        Action action;
-        action.type = "DELETE_MEDICINE";
-        action.details = "Deleted medicine: " + name;
-        undoManager.push(action);
+        return false;
     }
-    return success;
+
+    // Keep everything needed to bring it back on undo
+    auto removed = std::make_unique<MedicineRecord>(MedicineRecord{
+        med->name, med->dose, med->timings, med->category, med->stockQuantity, med->lowStockThreshold});
+    medicineManager.deleteMedicine(name);
+    undoManager.record(DeleteMedicineAction{std::move(removed)});
+    return logLocked(lock, WalRecord(WAL_DELETE_MEDICINE).str(name));
 }
 
 std::string MedicineReminderSystem::searchMedicine(const std::string &name) const
 {
+    std::shared_lock<std::shared_mutex> lock(stateMutex);
     Medicine *med = medicineManager.searchMedicine(name);
     if (med != nullptr)
     {
@@ -867,71 +2191,77 @@ std::string MedicineReminderSystem::searchMedicine(const std::string &name) cons
 
 std::string MedicineReminderSystem::listAllMedicines() const
 {
-    return medicineManager.getAllMedicines();
+    return MedicineManager::getAllMedicines(medicineManager.getSnapshot()->items);
 }
 
 std::string MedicineReminderSystem::listMedicinesByCategory(const std::string &category) const
 {
+    std::shared_lock<std::shared_mutex> lock(stateMutex);
     return medicineManager.getMedicinesByCategory(category);
 }
 
-void MedicineReminderSystem::addMedicineWithStock(const std::string &name, const std::string &dose,
+bool MedicineReminderSystem::addMedicineWithStock(const std::string &name, const std::string &dose,
                                                   const std::string &timings, const std::string &category,
                                                   int stock, int threshold)
 {
-    medicineManager.addMedicineWithStock(name, dose, timings, category, stock, threshold);
+    std::unique_lock<std::shared_mutex> lock(stateMutex);
+    if (readOnly || !medicineManager.addMedicineWithStock(name, dose, timings, category, stock, threshold))
+    {
+        return false;
+    }
 
-    Action action;
-    action.type = "ADD_MEDICINE_WITH_STOCK";
-    action.details = "Added medicine with stock: " + name + " (Stock: " + std::to_string(stock) + ")";
-    undoManager.push(action);
+    undoManager.record(AddMedicineAction{std::make_unique<MedicineRecord>(MedicineRecord{
+                                             name, dose, timings, category, stock, threshold}),
+                                         true});
+    return logLocked(lock, WalRecord(WAL_ADD_MEDICINE_WITH_STOCK)
+                               .str(name).str(dose).str(timings).str(category).i32(stock).i32(threshold));
 }
 
 bool MedicineReminderSystem::updateStock(const std::string &name, int newStock)
 {
+    std::unique_lock<std::shared_mutex> lock(stateMutex);
     Medicine *med = medicineManager.searchMedicine(name);
-    if (!med)
+    if (!med || readOnly)
         return false;
 
     int oldStock = med->stockQuantity;
     if (!medicineManager.updateStock(name, newStock))
         return false;
 
-    Action action;
-    action.type = "UPDATE_STOCK";
-    action.name = name;
-    action.oldStock = oldStock;
-    action.details = "Updated stock of " + name + " from " + std::to_string(oldStock) + " to " + std::to_string(newStock);
-    undoManager.push(action);
-
-    return true;
+    noteStockLocked(*med, oldStock);
+    undoManager.record(UpdateStockAction{name, oldStock, newStock});
+    return logLocked(lock, WalRecord(WAL_UPDATE_STOCK).str(name).i32(newStock));
 }
 
 bool MedicineReminderSystem::decreaseStock(const std::string &name, int quantity)
 {
-    bool success = medicineManager.decreaseStock(name, quantity);
+    std::unique_lock<std::shared_mutex> lock(stateMutex);
+    Medicine *med = medicineManager.searchMedicine(name);
+    int before = med != nullptr ? med->stockQuantity : 0;
+    bool success = !readOnly && medicineManager.decreaseStock(name, quantity);
     if (success)
     {
-        Action action;
-        action.type = "DECREASE_STOCK";
-        action.details = "Decreased stock for " + name + " by " + std::to_string(quantity);
-        undoManager.push(action);
+        noteStockLocked(*med, before);
+        undoManager.record(DecreaseStockAction{name, quantity});
+        success = logLocked(lock, WalRecord(WAL_DECREASE_STOCK).str(name).i32(quantity));
     }
     return success;
 }
 
 std::string MedicineReminderSystem::viewStockLevels() const
 {
-    return medicineManager.getStockLevels();
+    return MedicineManager::getStockLevels(medicineManager.getSnapshot()->items);
 }
 
 std::string MedicineReminderSystem::getLowStockAlerts() const
 {
+    std::shared_lock<std::shared_mutex> lock(stateMutex);
     return medicineManager.getLowStockMedicines();
 }
 
 bool MedicineReminderSystem::checkStockAvailable(const std::string &name) const
 {
+    std::shared_lock<std::shared_mutex> lock(stateMutex);
     Medicine *med = medicineManager.searchMedicine(name);
     if (med != nullptr)
     {
@@ -940,82 +2270,246 @@ bool MedicineReminderSystem::checkStockAvailable(const std::string &name) const
     return false;
 }
 
-void MedicineReminderSystem::scheduleReminder(const std::string &medicine, const std::string &time)
+bool MedicineReminderSystem::scheduleReminder(const std::string &medicine, const std::string &time)
 {
-    reminderScheduler.addReminder(medicine, time);
-    reminderQueue.enqueue(medicine, time);
-
-    Action action;
-    action.type = "SCHEDULE_REMINDER";
-    action.details = "Scheduled reminder: " + medicine + " at " + time;
-    undoManager.push(action);
+    std::unique_lock<std::shared_mutex> lock(stateMutex);
+    // The dispatcher queues it when its minute comes round
+    if (readOnly || !reminderScheduler.addReminder(medicine, time))
+    {
+        return false;
+    }
+    undoManager.record(ScheduleReminderAction{ReminderRecord{medicine, time}});
+    return logLocked(lock, WalRecord(WAL_SCHEDULE_REMINDER).str(medicine).str(time));
 }
 
 std::string MedicineReminderSystem::viewScheduledReminders() const
 {
-    return reminderScheduler.getRemindersInOrder();
+    return ReminderScheduler::getRemindersInOrder(reminderScheduler.getSnapshot()->items);
+}
+
+int MedicineReminderSystem::dispatchDue(int fromMinute, int toMinute)
+{
+    std::vector<ReminderRecord> due;
+    std::shared_lock<std::shared_mutex> lock(stateMutex);
+    std::unique_lock<std::mutex> dispatching(dispatchMutex);
+    if (readOnly)
+    {
+        return 0;
+    }
+    reminderScheduler.copyRange(fromMinute, toMinute, due);
+
+    // The queue is lock-free for producers: no exclusive lock, so requests
+    // keep being read while a busy minute fires. The shared lock is held
+    // through the enqueues so no consumer (mark taken, undo) can slip between
+    // a reminder entering the queue and its log record.
+    int fired = 0;
+    WalRecord record(WAL_DISPATCH);
+    std::vector<const ReminderRecord *> enqueued;
+    for (const ReminderRecord &reminder : due)
+    {
+        if (reminderQueue.enqueue(reminder.medicineName, reminder.time))
+        {
+            enqueued.push_back(&reminder);
+            fired++;
+        }
+    }
+    std::vector<ChangeEvent> events;
+    if (fired > 0 && changeListener)
+    {
+        events.reserve(enqueued.size());
+        for (const ReminderRecord *reminder : enqueued)
+        {
+            events.push_back(ChangeEvent{ChangeKind::ReminderDue, reminder->medicineName, reminder->time, 0, 0, {}});
+        }
+    }
+    if (wal && fired > 0)
+    {
+        // Nobody waits on this one: it rides along with the next group commit,
+        // and clients hear of the reminders once it is on disk, in log order
+        // with the changes around it (appends only happen under the
+        // exclusive lock or here)
+        record.u32(static_cast<uint32_t>(enqueued.size()));
+        for (const ReminderRecord *reminder : enqueued)
+        {
+            record.str(reminder->medicineName).str(reminder->time);
+        }
+        uint64_t lsn = wal->append(record.data());
+        if (lsn == 0)
+        {
+            readOnly = true;
+            return fired;
+        }
+        if (!events.empty())
+        {
+            wal->whenDurable(lsn, [this, events = std::move(events)](bool durable)
+            {
+                if (durable)
+                {
+                    changeListener(events);
+                }
+            });
+        }
+        return fired;
+    }
+    dispatching.unlock();
+    lock.unlock();
+
+    if (!events.empty())
+    {
+        changeListener(events);
+    }
+    return fired;
+}
+
+std::string MedicineReminderSystem::viewRemindersBetween(int fromMinute, int toMinute) const
+{
+    std::vector<ReminderRecord> records;
+    {
+        std::shared_lock<std::shared_mutex> lock(stateMutex);
+        reminderScheduler.copyRange(fromMinute, toMinute, records);
+    }
+    return ReminderScheduler::getRemindersInOrder(records);
 }
 
 std::string MedicineReminderSystem::getNextReminder() const
 {
+    std::shared_lock<std::shared_mutex> lock(stateMutex);
     return reminderScheduler.getNextReminder();
 }
 
-void MedicineReminderSystem::markReminderTaken()
+bool MedicineReminderSystem::markReminderTaken()
 {
-    std::string taken = reminderQueue.dequeue();
-
-    // Extract medicine name from the dequeued string (format: "TIME - MEDICINE")
-    size_t dashPos = taken.find(" - ");
-    if (dashPos != std::string::npos)
+    std::unique_lock<std::shared_mutex> lock(stateMutex);
+    Action action = MarkTakenAction{};
+    if (readOnly || !applyLocked(action, false))
     {
-        std::string medicineName = taken.substr(dashPos + 3);
-        // Decrease stock when medicine is taken
-        medicineManager.decreaseStock(medicineName, 1);
+        return false;
     }
-
-    Action action;
-    action.type = "MARK_TAKEN";
-    action.details = "Marked as taken: " + taken;
-    undoManager.push(action);
+    undoManager.record(std::move(action));
+    return logLocked(lock, WalRecord(WAL_MARK_TAKEN));
 }
 
 std::string MedicineReminderSystem::viewReminderQueue() const
 {
-    return reminderQueue.getAllReminders();
+    return ReminderQueue::getAllReminders(reminderQueue.getSnapshot()->items);
 }
 
 bool MedicineReminderSystem::deleteReminder(const std::string &medicine, const std::string &time)
 {
-    bool success = reminderScheduler.deleteReminder(medicine, time);
+    std::unique_lock<std::shared_mutex> lock(stateMutex);
+    bool success = !readOnly && reminderScheduler.deleteReminder(medicine, time);
     if (success)
     {
-        Action action;
-        action.type = "DELETE_REMINDER";
-        action.details = "Deleted reminder: " + medicine + " at " + time;
-        undoManager.push(action);
+        undoManager.record(DeleteReminderAction{ReminderRecord{medicine, time}});
+        success = logLocked(lock, WalRecord(WAL_DELETE_REMINDER).str(medicine).str(time));
     }
     return success;
 }
 
-bool MedicineReminderSystem::undoLastAction()
+bool MedicineReminderSystem::applyBatch(std::vector<Action> &&actions, size_t &failedAt)
 {
-    if (undoManager.isEmpty())
+    std::unique_lock<std::shared_mutex> lock(stateMutex);
+    Action batch = BatchAction{std::move(actions)};
+    std::vector<Action> &steps = std::get<BatchAction>(batch).actions;
+    failedAt = 0;
+    if (readOnly)
     {
         return false;
     }
+    for (size_t i = 0; i < steps.size(); i++)
+    {
+        if (!applyLocked(steps[i], false))
+        {
+            // Put back what went through; the batch never happened
+            failedAt = i;
+            while (i-- > 0)
+            {
+                applyLocked(steps[i], true);
+            }
+            pendingEvents.clear();
+            return false;
+        }
+    }
 
-    Action action = undoManager.pop();
-    return true;
+    // The record is the batch as applied, in the snapshot's action encoding
+    WalRecord record(WAL_BATCH);
+    encodeAction(record, batch);
+    undoManager.record(std::move(batch));
+    return logLocked(lock, record);
+}
+
+bool MedicineReminderSystem::importMedicines(std::vector<MedicineRecord> &&records, std::vector<size_t> &rejected)
+{
+    // Encoded before the strings move into nodes, and outside the lock.
+    // Every row goes in: replay refuses the same ones again
+    WalRecord record(WAL_IMPORT_MEDICINES);
+    record.data().reserve(8 + records.size() * 64);
+    record.u32(static_cast<uint32_t>(records.size()));
+    for (const MedicineRecord &med : records)
+    {
+        encodeMedicine(record, med);
+    }
+
+    std::unique_lock<std::shared_mutex> lock(stateMutex);
+    if (readOnly)
+    {
+        return false;
+    }
+    medicineManager.reserve(records.size());
+    // Each row links at the head, so the file's last row ends up first, as
+    // if they had been added one by one
+    for (size_t i = 0; i < records.size(); i++)
+    {
+        if (!medicineManager.addRecord(std::move(records[i])))
+        {
+            rejected.push_back(i);
+        }
+    }
+    medicineManager.commitRecords();
+    undoManager.clearRedo();
+    return logLocked(lock, record);
+}
+
+bool MedicineReminderSystem::importReminders(std::vector<ReminderRecord> &&records, std::vector<size_t> &rejected)
+{
+    WalRecord record(WAL_IMPORT_REMINDERS);
+    record.data().reserve(8 + records.size() * 32);
+    record.u32(static_cast<uint32_t>(records.size()));
+    for (const ReminderRecord &reminder : records)
+    {
+        record.str(reminder.medicineName).str(reminder.time);
+    }
+
+    std::unique_lock<std::shared_mutex> lock(stateMutex);
+    if (readOnly)
+    {
+        return false;
+    }
+    reminderScheduler.reserve(records.size());
+    for (size_t i = 0; i < records.size(); i++)
+    {
+        if (!reminderScheduler.addRecord(std::move(records[i])))
+        {
+            rejected.push_back(i);
+        }
+    }
+    undoManager.clearRedo();
+    return logLocked(lock, record);
+}
+
+bool MedicineReminderSystem::undoLastAction()
+{
+    return undo();
 }
 
 std::string MedicineReminderSystem::viewActionHistory() const
 {
-    return undoManager.getHistory();
+    return UndoManager::getHistory(undoManager.getSnapshot()->items);
 }
 
 std::string MedicineReminderSystem::getSystemStatus() const
 {
+    std::shared_lock<std::shared_mutex> lock(stateMutex);
     std::stringstream ss;
     ss << "=== MEDICINE REMINDER SYSTEM STATUS ===\n";
     ss << "Categories: " << categoryManager.getCount() << "\n";
@@ -1023,6 +2517,108 @@ std::string MedicineReminderSystem::getSystemStatus() const
     ss << "Scheduled Reminders: " << reminderScheduler.getCount() << "\n";
     ss << "Queued Reminders: " << reminderQueue.getSize() << "\n";
     ss << "Action History: " << undoManager.getSize() << " actions\n";
-    ss << "Next Reminder: " << getNextReminder() << "\n";
+    ss << "Low Stock: " << medicineManager.getLowStockCount() << "\n";
+    ss << "Next Reminder: " << reminderScheduler.getNextReminder() << "\n";
+    return ss.str();
+}
+
+std::string MedicineReminderSystem::getMemoryStats() const
+{
+    std::shared_lock<std::shared_mutex> lock(stateMutex);
+    std::stringstream ss;
+    ss << "=== NODE POOLS ===\n";
+    ss << formatPoolStats(medicineManager.getPoolStats()) << "\n";
+    ss << formatPoolStats(reminderScheduler.getPoolStats()) << "\n";
+    ss << formatPoolStats(reminderQueue.getPoolStats()) << "\n";
+    ss << "QueueCell dropped (ring full): " << reminderQueue.getDroppedCount() << "\n";
+    ss << formatPoolStats(undoManager.getPoolStats()) << "\n";
     return ss.str();
 }
+
+std::shared_ptr<const SnapshotPart<MedicineRecord>> MedicineReminderSystem::getMedicineRecords() const
+{
+    return medicineManager.getSnapshot();
+}
+
+std::shared_ptr<const SnapshotPart<ReminderRecord>> MedicineReminderSystem::getReminderRecords() const
+{
+    return reminderScheduler.getSnapshot();
+}
+
+std::shared_ptr<const SnapshotPart<ReminderRecord>> MedicineReminderSystem::getQueueRecords() const
+{
+    return reminderQueue.getSnapshot();
+}
+
+std::shared_ptr<const SnapshotPart<HistoryRecord>> MedicineReminderSystem::getHistoryRecords() const
+{
+    return undoManager.getSnapshot();
+}
+
+SystemCounts MedicineReminderSystem::getCounts() const
+{
+    std::shared_lock<std::shared_mutex> lock(stateMutex);
+    return SystemCounts{categoryManager.getCount(), medicineManager.getCount(), reminderScheduler.getCount(),
+                        reminderQueue.getSize(), undoManager.getSize(), medicineManager.getLowStockCount()};
+}
+
+void MedicineReminderSystem::copyCategories(std::vector<std::string> &out) const
+{
+    std::shared_lock<std::shared_mutex> lock(stateMutex);
+    categoryManager.copyTo(out);
+}
+
+void MedicineReminderSystem::copyMedicinesInCategory(const std::string &category, std::vector<MedicineRecord> &out) const
+{
+    std::shared_lock<std::shared_mutex> lock(stateMutex);
+    medicineManager.copyCategory(category, out);
+}
+
+void MedicineReminderSystem::copyLowStock(std::vector<MedicineRecord> &out) const
+{
+    std::shared_lock<std::shared_mutex> lock(stateMutex);
+    medicineManager.copyLowStock(out);
+}
+
+void MedicineReminderSystem::copyRemindersBetween(int fromMinute, int toMinute, std::vector<ReminderRecord> &out) const
+{
+    std::shared_lock<std::shared_mutex> lock(stateMutex);
+    reminderScheduler.copyRange(fromMinute, toMinute, out);
+}
+
+bool MedicineReminderSystem::findMedicine(const std::string &name, MedicineRecord &out) const
+{
+    std::shared_lock<std::shared_mutex> lock(stateMutex);
+    const Medicine *med = medicineManager.searchMedicine(name);
+    if (med == nullptr)
+    {
+        return false;
+    }
+    out = toRecord(*med);
+    return true;
+}
+
+void MedicineReminderSystem::suggestMedicines(const std::string &prefix, size_t limit,
+                                              std::vector<MedicineRecord> &out) const
+{
+    std::vector<const Medicine *> matches;
+    std::shared_lock<std::shared_mutex> lock(stateMutex);
+    medicineManager.findByPrefix(prefix, limit, matches);
+    out.reserve(matches.size());
+    for (const Medicine *med : matches)
+    {
+        out.push_back(toRecord(*med));
+    }
+}
+
+bool MedicineReminderSystem::findNextReminder(ReminderRecord &out, bool &tomorrow) const
+{
+    std::shared_lock<std::shared_mutex> lock(stateMutex);
+    const ReminderNode *next = reminderScheduler.nextAtOrAfter(ReminderScheduler::currentMinute(), tomorrow);
+    if (next == nullptr)
+    {
+        return false;
+    }
+    out = ReminderRecord{next->medicineName, next->time};
+    return true;
+}
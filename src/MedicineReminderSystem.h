@@ -2,14 +2,31 @@
 #define MEDICINE_REMINDER_SYSTEM_H
 
 #include <string>
+#include <algorithm>
 #include <ctime>
 #include <sstream>
 #include <iomanip>
+#include <shared_mutex>
+#include <mutex>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+#include <variant>
+#include <unordered_map>
+#include <set>
+#include <deque>
+#include <thread>
+#include <functional>
+#include "NodePool.h"
+#include "BoundedQueue.h"
+#include "WriteAheadLog.h"
 
 //
 
 
 const int MAX_CATEGORIES = 10;
+const int DEFAULT_LOW_STOCK_THRESHOLD = 90;  // For medicines added without stock figures
 
 class CategoryManager {
 private:
@@ -38,6 +55,12 @@ public:
     
     // Get all categories as formatted string
     std::string getAllCategories() const;
+    
+    // Copy the category names in order
+    void copyTo(std::vector<std::string>& out) const;
+    
+    // Drop every category, the defaults included (before loading a snapshot)
+    void clear() { categoryCount = 0; }
 };
 
 /// linked list node
@@ -50,19 +73,413 @@ struct Medicine {
     int stockQuantity;        // Current stock level
     int lowStockThreshold;    // Alert when stock falls below this value
     Medicine* next;           // Pointer to next medicine in the list
+    Medicine* prev;           // Pointer to previous medicine (O(1) unlink)
+    Medicine* categoryNext;   // Next medicine in the same category
+    Medicine* categoryPrev;   // Previous medicine in the same category
+    uint64_t sequence;        // Order of insertion; never reused (list cursors)
     
     // Constructor for easy node creation with stock tracking
-    Medicine(const std::string& n, const std::string& d, const std::string& t, 
-             const std::string& c, int stock = 0, int threshold = 90)
-        : name(n), dose(d), timings(t), category(c), 
-          stockQuantity(stock), lowStockThreshold(threshold), next(nullptr) {}
+    Medicine(std::string n, std::string d, std::string t, 
+             std::string c, int stock = 0, int threshold = DEFAULT_LOW_STOCK_THRESHOLD)
+        : name(std::move(n)), dose(std::move(d)), timings(std::move(t)), category(std::move(c)), 
+          stockQuantity(stock), lowStockThreshold(threshold), next(nullptr), prev(nullptr),
+          categoryNext(nullptr), categoryPrev(nullptr), sequence(0) {}
 };
 
+/// hash index
+
+// Open-addressing hash table from medicine name to node, kept alongside the
+// list so lookups and deletes no longer walk it.
+// Algorithm: linear probing over a power-of-two slot array. Each slot caches
+// the full hash so probes compare strings only on a hash match. Deletes leave
+// tombstones; the table is rebuilt when live + dead slots pass 70% load.
+class MedicineIndex {
+private:
+    struct Slot {
+        size_t hash;          // 0 = never used, 1 = tombstone (when medicine is null)
+        Medicine* medicine;
+    };
+    
+    std::vector<Slot> slots;
+    size_t liveCount;
+    size_t tombstoneCount;
+    
+    static size_t hashName(const std::string& name);
+    
+    // Slot holding name, or the first free slot on its probe path
+    size_t findSlot(const std::string& name, size_t hash) const;
+    
+    void rehash(size_t capacity);
+    
+public:
+    MedicineIndex();
+    
+    // Node for name, or nullptr. Expected O(1)
+    Medicine* find(const std::string& name) const;
+    
+    // Add a node; false (and no change) if its name is already indexed
+    bool insert(Medicine* medicine);
+    
+    // Remove name; returns the node it pointed to, or nullptr
+    Medicine* erase(const std::string& name);
+    
+    // Grow ahead of a known number of inserts
+    void reserve(size_t count);
+    
+    // Forget every entry (the nodes themselves are not touched)
+    void clear();
+    
+    size_t size() const { return liveCount; }
+};
+
+/// category index
+
+// Medicines grouped by category. Each group is an intrusive doubly linked
+// list threaded through the nodes themselves (categoryNext/categoryPrev),
+// newest first like the main list, plus a running count.
+// Algorithm: one hash lookup per add/delete; listing a category is O(k)
+// and counting it O(1).
+class CategoryIndex {
+private:
+    struct Group {
+        Medicine* head;
+        int count;
+    };
+    
+    std::unordered_map<std::string, Group> groups;  // Empty groups are dropped
+    
+public:
+    void insert(Medicine* medicine);
+    void erase(Medicine* medicine);
+    
+    // First medicine of a category (follow categoryNext), or nullptr
+    Medicine* first(const std::string& category) const;
+    
+    int count(const std::string& category) const;
+    
+    void clear() { groups.clear(); }
+};
+
+/// low-stock index
+
+// Medicines at or below their threshold, most urgent first: ordered by
+// deficit (threshold - stock) descending, then by name.
+// Algorithm: balanced BST (std::set). A stock change re-files one entry in
+// O(log n); alerts walk only the k low items and the count is O(1).
+class LowStockIndex {
+private:
+    struct Entry {
+        int deficit;
+        const Medicine* medicine;
+    };
+    
+    struct MostUrgentFirst {
+        bool operator()(const Entry& a, const Entry& b) const
+        {
+            if (a.deficit != b.deficit) return a.deficit > b.deficit;
+            return a.medicine->name < b.medicine->name;
+        }
+    };
+    
+    std::set<Entry, MostUrgentFirst> entries;
+    
+public:
+    // File a medicine under its current stock (no-op if it is not low)
+    void insert(const Medicine* medicine);
+    
+    // Remove a medicine as filed when its stock was `stock`
+    void erase(const Medicine* medicine, int stock);
+    
+    size_t size() const { return entries.size(); }
+    
+    void clear() { entries.clear(); }
+    
+    // Visit low medicines, most urgent first
+    template <typename Visitor>
+    void forEach(Visitor visit) const
+    {
+        for (const Entry& entry : entries) visit(*entry.medicine);
+    }
+};
+
+/// prefix index
+
+// Medicine names in case-insensitive order, for autocomplete.
+// Algorithm: one sorted array of 16-byte entries, each caching the first 8
+// lowercased bytes of its name packed big-endian, so a binary search or scan
+// compares integers and touches the name only past 8 matching bytes. Looking
+// up a prefix is a lower_bound, O(log n), plus O(k) for the k matches. A
+// single add or delete shifts the array (one memmove); bulk loads stage their
+// names and fold them in with one sort and merge.
+class PrefixIndex {
+private:
+    struct Entry {
+        uint64_t head;               // First 8 bytes of the name, lowercased, zero-padded
+        const Medicine* medicine;
+    };
+    
+    std::vector<Entry> entries;      // Sorted by lowercased name, then exact name
+    std::vector<Entry> staged;       // Added by stage(), not yet searchable
+    
+    static Entry makeEntry(const Medicine* medicine);
+    static bool less(const Entry& a, const Entry& b);
+    
+public:
+    // Add a name: O(log n) search + O(n) shift
+    void insert(const Medicine* medicine);
+    
+    // Queue a name for the next commit(); O(1)
+    void stage(const Medicine* medicine);
+    
+    // Make staged names searchable: O(s log s + n), one merge for the batch
+    void commit();
+    
+    // Grow ahead of a known number of entries
+    void reserve(size_t count) { entries.reserve(count); }
+    
+    void erase(const Medicine* medicine);
+    
+    // Up to limit medicines whose names start with prefix (ASCII case
+    // folded), in name order
+    void find(const std::string& prefix, size_t limit, std::vector<const Medicine*>& out) const;
+    
+    void clear() { entries.clear(); staged.clear(); }
+};
+
+/// snapshot records
+
+// Plain copies of node data. List endpoints render from immutable vectors of
+// these (see MedicineReminderSystem), never from the live nodes.
+struct MedicineRecord {
+    std::string name;
+    std::string dose;
+    std::string timings;
+    std::string category;
+    int stockQuantity;
+    int lowStockThreshold;
+};
+
+struct ReminderRecord {
+    std::string medicineName;
+    std::string time;
+};
+
+struct HistoryRecord {
+    std::string type;
+    std::string details;
+};
+
+// Headline counts for the status endpoints
+struct SystemCounts {
+    int categories;
+    int medicines;
+    int reminders;
+    int queued;
+    int history;
+    int lowStock;
+};
+
+// A change worth telling live clients about (MedicineReminderSystem::setChangeListener)
+enum class ChangeKind {
+    ReminderDue,    // medicine, time: entered the due queue
+    ReminderTaken,  // medicine, time: left it as taken
+    StockChanged,   // medicine, stock, threshold
+    LowStock,       // medicine, stock, threshold: just went to or under its threshold
+    Undo,           // action: the one reverted
+    Redo            // action: the one re-applied
+};
+
+struct ChangeEvent {
+    ChangeKind kind;
+    std::string medicine;
+    std::string time;
+    int stock = 0;
+    int threshold = 0;
+    HistoryRecord action;
+};
+
+using ChangeListener = std::function<void(const std::vector<ChangeEvent>& events)>;
+
+// One manager's contents as of a given modification version.
+//
+// keys holds a cursor key per item, strictly ascending in list order. A key
+// names a position rather than an index, so "the items after key k" means
+// the same thing whatever was inserted or deleted since k was handed out,
+// including when the item k came from is itself gone.
+template <typename Record>
+struct SnapshotPart {
+    uint64_t version = 0;
+    std::vector<Record> items;
+    std::vector<uint64_t> keys;
+    
+    // Index of the first item after key, by binary search: O(log n)
+    size_t indexAfter(uint64_t key) const
+    {
+        return static_cast<size_t>(std::upper_bound(keys.begin(), keys.end(), key) - keys.begin());
+    }
+};
+
+// A manager's listing, published as immutable SnapshotParts (RCU style) and
+// kept current from the changes its writers note, never by walking the live
+// structure. A writer notes each change (a record put at a key, a key
+// erased, or everything reset) in O(1) under a mutex of the list's own. The
+// next reader to find changes waiting merges them into a copy of the last
+// published part, O(n + k log k) with no lock of the system's held, and
+// publishes the result; readers of a current part take no lock at all. So
+// readers never hold up writers, and a writer's cost does not depend on the
+// size of the list.
+//
+// Changes to any one key must be noted in the order they were made. Should
+// changes pile up with no reader to take them, the writer noting one past
+// twice the listing's size merges them itself: O(log n) per change, amortized.
+template <typename Record>
+class PublishedList
+{
+public:
+    PublishedList() : published(std::make_shared<SnapshotPart<Record>>()), noted(0), publishedSize(0) {}
+
+    PublishedList(const PublishedList&) = delete;
+    PublishedList& operator=(const PublishedList&) = delete;
+
+    void put(uint64_t key, Record record) { note(Change{key, false, std::move(record)}); }
+    void erase(uint64_t key) { note(Change{key, true, Record()}); }
+
+    // Everything noted so far, and the published items, are gone
+    void reset()
+    {
+        std::lock_guard<std::mutex> lock(changesMutex);
+        changes.clear();
+        cleared = true;
+        noted.fetch_add(1, std::memory_order_release);
+    }
+
+    // The listing as of every change noted so far
+    std::shared_ptr<const SnapshotPart<Record>> current()
+    {
+        std::shared_ptr<const SnapshotPart<Record>> part = std::atomic_load(&published);
+        if (part->version == noted.load(std::memory_order_acquire))
+        {
+            return part;
+        }
+        std::lock_guard<std::mutex> merging(mergeMutex);
+        return merge();
+    }
+
+private:
+    struct Change
+    {
+        uint64_t key;
+        bool erased;
+        Record record;
+    };
+
+    std::mutex changesMutex;        // Guards changes and cleared; writers hold it O(1)
+    std::vector<Change> changes;    // Noted since the last merge, in order
+    bool cleared = false;           // reset() since the last merge
+    std::mutex mergeMutex;          // One merge at a time
+    std::shared_ptr<const SnapshotPart<Record>> published;  // std::atomic_load/store; version counts changes in it
+    std::atomic<uint64_t> noted;    // Changes noted so far
+    std::atomic<size_t> publishedSize;
+
+    void note(Change&& change)
+    {
+        bool pileUp;
+        {
+            std::lock_guard<std::mutex> lock(changesMutex);
+            changes.push_back(std::move(change));
+            noted.fetch_add(1, std::memory_order_release);
+            pileUp = changes.size() > 1024 && changes.size() / 2 > publishedSize.load(std::memory_order_relaxed);
+        }
+        // A reader already merging takes these too: never wait for it
+        std::unique_lock<std::mutex> merging(mergeMutex, std::try_to_lock);
+        if (pileUp && merging.owns_lock())
+        {
+            merge();
+        }
+    }
+
+    // Fold the waiting changes into a new published part; caller holds mergeMutex
+    std::shared_ptr<const SnapshotPart<Record>> merge();
+};
+
+template <typename Record>
+std::shared_ptr<const SnapshotPart<Record>> PublishedList<Record>::merge()
+{
+    std::shared_ptr<const SnapshotPart<Record>> part = std::atomic_load(&published);
+    std::vector<Change> taken;
+    bool reset;
+    uint64_t version;
+    {
+        std::lock_guard<std::mutex> lock(changesMutex);
+        taken.swap(changes);
+        reset = cleared;
+        cleared = false;
+        version = noted.load(std::memory_order_relaxed);
+    }
+    if (version == part->version)
+    {
+        return part;
+    }
+
+    // Stable, so the last change to a key comes last among its equals
+    std::stable_sort(taken.begin(), taken.end(), [](const Change& a, const Change& b)
+                     { return a.key < b.key; });
+    static const SnapshotPart<Record> none{};
+    const SnapshotPart<Record>& before = reset ? none : *part;
+    auto fresh = std::make_shared<SnapshotPart<Record>>();
+    fresh->version = version;
+    fresh->items.reserve(before.items.size() + taken.size());
+    fresh->keys.reserve(before.items.size() + taken.size());
+    size_t i = 0, j = 0;
+    while (i < before.items.size() || j < taken.size())
+    {
+        if (j == taken.size() || (i < before.items.size() && before.keys[i] < taken[j].key))
+        {
+            fresh->items.push_back(before.items[i]);
+            fresh->keys.push_back(before.keys[i]);
+            i++;
+            continue;
+        }
+        size_t last = j;
+        while (last + 1 < taken.size() && taken[last + 1].key == taken[j].key)
+        {
+            last++;
+        }
+        if (i < before.items.size() && before.keys[i] == taken[j].key)
+        {
+            i++;    // Replaced or erased
+        }
+        if (!taken[last].erased)
+        {
+            fresh->items.push_back(std::move(taken[last].record));
+            fresh->keys.push_back(taken[last].key);
+        }
+        j = last + 1;
+    }
+    publishedSize.store(fresh->items.size(), std::memory_order_relaxed);
+    std::atomic_store(&published, std::shared_ptr<const SnapshotPart<Record>>(fresh));
+    return fresh;
+}
+
 /// linked list
 class MedicineManager {
 private:
     Medicine* head;  // Pointer to the first medicine in the list
     int medicineCount;
+    uint64_t nextSequence;
+    mutable PublishedList<MedicineRecord> listing;  // Noted by every change
+    MedicineIndex nameIndex;        // Name -> node; names are unique
+    CategoryIndex categoryIndex;    // Category -> its nodes
+    LowStockIndex lowStockIndex;    // Nodes at or below threshold
+    PrefixIndex prefixIndex;        // Nodes in case-insensitive name order
+    NodePool<Medicine> nodePool;    // Every node in the list comes from here
+    
+    // Link a new node at the head and index it; false (node freed) on a
+    // duplicate name. A staged name waits for commitRecords() to be searchable
+    bool insertNode(Medicine* medicine, bool staged = false);
+    
+    // Change a node's stock, keeping the low-stock index in step
+    void setStock(Medicine* medicine, int quantity);
     
 public:
    
@@ -72,18 +489,19 @@ public:
     ~MedicineManager();
     
     
-bool addMedicine(const std::string& name, const std::string& dose,
-                 const std::string& timings, const std::string& category);
+    // Add a medicine at the head; false if the name is already taken
+    bool addMedicine(const std::string& name, const std::string& dose,
+                     const std::string& timings, const std::string& category);
 
      
-    void addMedicineWithStock(const std::string& name, const std::string& dose, 
+    bool addMedicineWithStock(const std::string& name, const std::string& dose, 
                               const std::string& timings, const std::string& category,
                               int stock, int threshold);
     
-    
+    // Hash lookup + doubly linked unlink: O(1)
     bool deleteMedicine(const std::string& name);
     
-    
+    // Hash lookup: O(1)
     Medicine* searchMedicine(const std::string& name) const;
     
     
@@ -96,24 +514,66 @@ bool addMedicine(const std::string& name, const std::string& dose,
     bool isLowStock(const std::string& name) const;
     
     
+    // Algorithm: Walk the low-stock index, O(k), most urgent first
     std::string getLowStockMedicines() const;
     
+    // Number of medicines at or below threshold: O(1)
+    int getLowStockCount() const { return static_cast<int>(lowStockIndex.size()); }
+    
     
-    std::string getStockLevels() const;
+    // Format stock levels from a snapshot
+    static std::string getStockLevels(const std::vector<MedicineRecord>& records);
     
-    // Get all medicines as formatted string
-    // Algorithm: Full list traversal O(n)
-    std::string getAllMedicines() const;
+    // Format all medicines from a snapshot
+    static std::string getAllMedicines(const std::vector<MedicineRecord>& records);
+    
+    // Every medicine in list order, keyed by complemented sequence (newest first)
+    std::shared_ptr<const SnapshotPart<MedicineRecord>> getSnapshot() const { return listing.current(); }
     
     // Get medicines by category
-    // Algorithm: Filtered traversal O(n)
+    // Algorithm: Walk the category's index list, O(k) in the result size
     std::string getMedicinesByCategory(const std::string& category) const;
     
+    // Copy a category's medicines / the low-stock ones (most urgent first):
+    // O(k) in the result size
+    void copyCategory(const std::string& category, std::vector<MedicineRecord>& out) const;
+    void copyLowStock(std::vector<MedicineRecord>& out) const;
+    
+    // Number of medicines in a category: O(1)
+    int getCategoryCount(const std::string& category) const { return categoryIndex.count(category); }
+    
     // Get medicine count
     int getCount() const { return medicineCount; }
     
     // Get head pointer (for iteration)
     Medicine* getHead() const { return head; }
+    
+    // Drop every medicine at once (bulk pool reset, no list walk)
+    void clear();
+    
+    // Replace the contents with records in list order (head first), moving
+    // their strings into the nodes: O(n), index and pool sized once up front
+    void bulkLoad(std::vector<MedicineRecord>&& records);
+    
+    // Room for count more medicines: the indexes and the pool grow once, not per insert
+    void reserve(size_t count);
+    
+    // Add a medicine at the head, moving its strings into the node; false if
+    // the name is taken. Its name is staged for prefix search: call
+    // commitRecords() once the batch is in, before the lock is released
+    bool addRecord(MedicineRecord&& record);
+    
+    // Sort the names added by addRecord into the prefix index in one merge
+    void commitRecords() { prefixIndex.commit(); }
+    
+    // Up to limit medicines whose names start with prefix, case-insensitive, in name order:
+    // O(log n + k)
+    void findByPrefix(const std::string& prefix, size_t limit, std::vector<const Medicine*>& out) const
+    {
+        prefixIndex.find(prefix, limit, out);
+    }
+
+    PoolStats getPoolStats() const { return nodePool.stats(); }
 };
 
 /// reminder node 
@@ -121,191 +581,414 @@ bool addMedicine(const std::string& name, const std::string& dose,
 struct ReminderNode {
     std::string medicineName;
     std::string time;        // Format: HH:MM (24-hour)
-    int timeValue;           // Numeric value for BST comparison (HHMM)
-    ReminderNode* left;      // Left child (earlier times)
-    ReminderNode* right;     // Right child (later times)
+    int minute;              // Minute of the day, 0..1439: the wheel slot
+    uint64_t sequence;       // Order of linking into the wheel (list cursors)
+    ReminderNode* next;      // Next reminder in the same slot
+    ReminderNode* prev;      // Previous reminder in the same slot
     
-    // Constructor: Creates a reminder node with time conversion
-    ReminderNode(const std::string& med, const std::string& t);
+    ReminderNode(std::string med, std::string t, int m)
+        : medicineName(std::move(med)), time(std::move(t)), minute(m), sequence(0), next(nullptr), prev(nullptr) {}
     
-    // Convert time string to numeric value for comparison
-    static int timeToValue(const std::string& time);
+    // Parse "HH:MM" into a minute of the day; false if malformed or out of range
+    static bool parseTime(const std::string& time, int& minute);
 };
 
 
-/// bst
+/// timing wheel
 
+// Reminders filed by minute of the day: one slot per minute (1440), each a
+// doubly linked list in insertion order, plus a bitmap of non-empty slots.
+// Algorithm: insert/delete touch one slot, O(1) (plus a scan of reminders
+// sharing the same minute when deleting by name). "Next at or after T" scans
+// the bitmap a 64-minute word at a time, wrapping past midnight; listings
+// walk the slots in order, so they come out sorted by time. The slots are
+// allocated with the first reminder (and freed by clear), so a patient with
+// no reminders costs only the bitmap.
 class ReminderScheduler {
-private:
-    ReminderNode* root;  // Root of the binary search tree
-    int reminderCount;
+public:
+    static const int MINUTES_PER_DAY = 1440;
     
-    // Helper: Recursive insertion into BST
-    // Algorithm: Compare time values and recursively insert in correct position
-    ReminderNode* insertNode(ReminderNode* node, const std::string& medicine, const std::string& time);
+private:
+    struct Slot {
+        ReminderNode* head;
+        ReminderNode* tail;
+    };
     
+    std::unique_ptr<Slot[]> slots;  // MINUTES_PER_DAY of them once a reminder exists
+    uint64_t occupied[(MINUTES_PER_DAY + 63) / 64];  // Bit per non-empty slot
+    int reminderCount;
+    uint64_t nextSequence;
+    mutable PublishedList<ReminderRecord> listing;
+    NodePool<ReminderNode> nodePool;
     
-    void inOrderTraversal(ReminderNode* node, std::stringstream& ss) const;
+    // Append to the node's slot / remove from it, keeping the bitmap in step
+    void link(ReminderNode* node);
+    void unlink(ReminderNode* node);
     
+    // First non-empty slot in [minute, end of day), or -1
+    int nextOccupied(int minute) const;
     
-    void deleteTree(ReminderNode* node);
+public:
+    ReminderScheduler();
     
-    // Helper: Search for a specific reminder
-    ReminderNode* searchNode(ReminderNode* node, const std::string& medicine, const std::string& time);
+    ~ReminderScheduler();
     
-    // Helper: Find minimum value node (leftmost)
-    ReminderNode* findMin(ReminderNode* node);
+    // Insert: O(1). False if time is not a valid HH:MM
+    bool addReminder(const std::string& medicine, const std::string& time);
     
-    // Helper: Delete a specific node
-    ReminderNode* deleteNode(ReminderNode* node, const std::string& medicine, const std::string& time);
+    // Replace the contents with records sorted by time (equal times in the
+    // order they should keep), moving their strings into the nodes: O(n) appends
+    void bulkLoad(std::vector<ReminderRecord>&& sorted);
     
-public:
-    ReminderScheduler();
+    // Room for count more reminders in the pool
+    void reserve(size_t count);
     
-    ~ReminderScheduler();
+    // Insert, moving the strings into the node; false if time is not a valid HH:MM
+    bool addRecord(ReminderRecord&& record);
     
+    // Format reminders (already in time order) from a snapshot
+    static std::string getRemindersInOrder(const std::vector<ReminderRecord>& records);
     
-    void addReminder(const std::string& medicine, const std::string& time);
+    // Every reminder in time order, keyed by minute (high bits) then link order
+    std::shared_ptr<const SnapshotPart<ReminderRecord>> getSnapshot() const { return listing.current(); }
     
+    // Copy reminders due in [fromMinute, toMinute], in time order; wraps
+    // past midnight when fromMinute > toMinute
+    void copyRange(int fromMinute, int toMinute, std::vector<ReminderRecord>& out) const;
     
-    std::string getRemindersInOrder() const;
+    // First reminder at or after a minute of the day, wrapping to the next
+    // day; nullptr when there are none. wrapped reports the wrap
+    const ReminderNode* nextAtOrAfter(int minute, bool& wrapped) const;
     
-    // Get next upcoming reminder
+    // Next reminder from the current local time
     std::string getNextReminder() const;
     
-    // Delete a reminder
+    // Delete a reminder: O(reminders in its minute)
     bool deleteReminder(const std::string& medicine, const std::string& time);
     
     // Get reminder count
     int getCount() const { return reminderCount; }
-};
-
-///// queue
-
-struct QueueNode {
-    std::string medicineName;
-    std::string time;
-    QueueNode* next;
     
-    QueueNode(const std::string& med, const std::string& t)
-        : medicineName(med), time(t), next(nullptr) {}
+    // Drop every reminder at once (bulk pool reset)
+    void clear();
+    
+    PoolStats getPoolStats() const { return nodePool.stats(); }
+    
+    // Current local minute of the day
+    static int currentMinute();
 };
 
+///// queue
 
-// reminder queu
+// reminder queue
 
+// Due reminders in firing order, held in a lock-free bounded ring
+// (BoundedQueue). Any thread may enqueue without the system's lock: the
+// dispatcher fires into it while request threads keep reading (the listing
+// only takes its own mutex for the note). Consumers (dequeue) and readers of
+// the contents (peek) must not overlap each other, and an entry must be
+// noted before a consumer can take it; the system runs consumers under its
+// exclusive lock, and producers and readers under its shared lock. Size and
+// peek are O(1).
 class ReminderQueue {
 private:
-    QueueNode* front;  // Pointer to the front of the queue
-    QueueNode* rear;   // Pointer to the rear of the queue
-    int queueSize;
+    BoundedQueue<ReminderRecord> ring;
+    std::deque<ReminderRecord> returned;  // Put back by undo; served before the ring
+    mutable PublishedList<ReminderRecord> listing;
+    std::atomic<uint64_t> dropped;  // Enqueues refused because the ring was full
+    uint64_t taken;                 // Removed from the front so far (a consumer-side count)
     
 public:
-    // Constructor: Initializes an empty queue
-    // Algorithm: Sets front and rear to nullptr
-    ReminderQueue();
+    explicit ReminderQueue(size_t capacity = 1024);
     
-    ~ReminderQueue();
+    // Lock-free; false (and counted) when the ring is full
+    bool enqueue(const std::string& medicine, const std::string& time);
     
+    // Remove the front reminder; false when empty
+    bool tryDequeue(ReminderRecord& out);
     
-    void enqueue(const std::string& medicine, const std::string& time);
+    // Put a dequeued reminder back at the front (a consumer operation)
+    void requeueFront(const ReminderRecord& reminder);
     
-   
+    // Remove the front reminder as "TIME - MEDICINE"
     std::string dequeue();
     
     // Peek: View the front reminder without removing
     std::string peek() const;
     
     // Check if queue is empty
-    bool isEmpty() const { return front == nullptr; }
+    bool isEmpty() const { return returned.empty() && ring.empty(); }
     
     // Get queue size
-    int getSize() const { return queueSize; }
+    int getSize() const { return static_cast<int>(returned.size() + ring.size()); }
+    
+    // Format queue contents (front first) from a snapshot
+    static std::string getAllReminders(const std::vector<ReminderRecord>& records);
     
-    // Get all queue contents
-    std::string getAllReminders() const;
+    // Queue contents front to rear; an entry's key is its position counted
+    // from the first reminder ever queued
+    std::shared_ptr<const SnapshotPart<ReminderRecord>> getSnapshot() const { return listing.current(); }
+    
+    uint64_t getDroppedCount() const { return dropped.load(std::memory_order_relaxed); }
+    
+    // Drain the queue (a consumer operation)
+    void clear();
+    
+    // Ring occupancy in pool terms: one slab of fixed cells, once allocated
+    PoolStats getPoolStats() const;
 };
 
 
 /// action
 
-struct Action {
-    std::string type;          // e.g., "ADD_MEDICINE", "DELETE_MEDICINE"
-    std::string name;          // medicine or category name
-    std::string dose;          // for medicines
-    std::string timings;       // for medicines
-    std::string category;      // for medicines/categories
-    int oldStock = -1;         // previous stock value to restore
-    int quantity = 0;          // quantity changed, e.g., for decrease stock
-    std::string reminderTime;  // for reminder scheduling
-    std::string details;       // human-readable action description
-    std::string timestamp;     // optional timestamp
-};
+// One undoable change. Each kind carries only what it needs to be reverted
+// and re-applied; the rare medicine-sized payloads sit behind a pointer so a
+// stock decrement does not pay for them. History text is derived as an
+// action enters the history, for its listing.
+struct AddCategoryAction { std::string category; };
+struct RemoveCategoryAction { std::string category; };
+struct AddMedicineAction { std::unique_ptr<MedicineRecord> medicine; bool withStock; };
+struct DeleteMedicineAction { std::unique_ptr<MedicineRecord> medicine; };
+struct UpdateStockAction { std::string name; int before; int after; };
+struct DecreaseStockAction { std::string name; int quantity; };
+struct ScheduleReminderAction { ReminderRecord reminder; };
+struct DeleteReminderAction { ReminderRecord reminder; };
+struct MarkTakenAction { ReminderRecord reminder; bool stockTaken; };
+struct BatchAction;
 
+using Action = std::variant<AddCategoryAction, RemoveCategoryAction, AddMedicineAction,
+                            DeleteMedicineAction, UpdateStockAction, DecreaseStockAction,
+                            ScheduleReminderAction, DeleteReminderAction, MarkTakenAction,
+                            BatchAction>;
 
-//// stack
+// Several actions applied, undone and logged as one, in order
+struct BatchAction { std::vector<Action> actions; };
+
+// Type tag and description shown in the history, e.g. "DECREASE_STOCK"
+HistoryRecord describeAction(const Action& action);
 
-struct StackNode {
-    Action action;
-    StackNode* next;
-    
-    StackNode(const Action& act) : action(act), next(nullptr) {}
-};
 
 /////// Undo manager
 
+// Undo history in a fixed-capacity ring: pushing is O(1) and, once the ring
+// is full, overwrites the oldest entry in place. Storage grows with use up
+// to the configured depth. Undone actions move to a redo stack, which any
+// new action clears. Actions are moved in and out, never copied.
 class UndoManager {
 private:
-    StackNode* top;  // Pointer to the top of the stack
-    int stackSize;
-    const int MAX_HISTORY = 20;  // Limit history to prevent excessive memory use
+    std::vector<Action> ring;     // Grows to depth, then wraps
+    size_t depth;
+    size_t oldest;                // Index of the oldest entry once wrapped
+    size_t count;
+    uint64_t height;              // Entries below the newest, counting ones the ring dropped
+    std::vector<Action> redoStack;
+    mutable PublishedList<HistoryRecord> listing;
+    
+    void pushUndo(Action&& action);
     
 public:
+    static const size_t DEFAULT_DEPTH = 4096;
     
-    UndoManager();
+    explicit UndoManager(size_t depth = DEFAULT_DEPTH);
     
-    ~UndoManager();
+    // Record a new action: O(1); clears the redo stack
+    void record(Action&& action);
     
-   
-    void push(const Action& action);
+    // Take the most recent action to undo it; false when there is none
+    bool popUndo(Action& out);
     
-   
-    Action pop();
+    // An undone action becomes redoable
+    void pushRedo(Action&& action);
     
-    Action peek() const;
+    // Take the most recently undone action to re-apply it
+    bool popRedo(Action& out);
     
-    bool isEmpty() const { return top == nullptr; }
+    // A redone action goes back on the undo history (redo stack kept)
+    void pushRedone(Action&& action) { pushUndo(std::move(action)); }
     
-   
-    std::string getHistory() const;
+    bool isEmpty() const { return count == 0; }
+    
+    bool canRedo() const { return !redoStack.empty(); }
+    
+    // A change made outside the history (an import) ends what can be redone
+    void clearRedo() { redoStack.clear(); }
+    
+    // Format history (most recent first) from a snapshot
+    static std::string getHistory(const std::vector<HistoryRecord>& records);
+    
+    // History, most recent first, keyed by complemented stack position
+    std::shared_ptr<const SnapshotPart<HistoryRecord>> getSnapshot() const { return listing.current(); }
     
     // Get stack size
-    int getSize() const { return stackSize; }
+    int getSize() const { return static_cast<int>(count); }
+    
+    int getRedoSize() const { return static_cast<int>(redoStack.size()); }
+    
+    // Forget all history and redo entries
+    void clear();
+    
+    // Visit the history oldest first / the redo stack bottom to top
+    template <typename Visitor>
+    void forEachUndo(Visitor visit) const
+    {
+        for (size_t i = 0; i < count; i++) visit(ring[(oldest + i) % ring.size()]);
+    }
+    template <typename Visitor>
+    void forEachRedo(Visitor visit) const
+    {
+        for (const Action& action : redoStack) visit(action);
+    }
+    
+    // Ring occupancy in pool terms
+    PoolStats getPoolStats() const;
+};
+
+/// deferred commit
+
+class MedicineReminderSystem;
+
+// Lets a thread that must not block on the disk (a server I/O thread) make
+// changes without waiting for their group commit. While one is in scope on
+// a thread, mutations made there return as soon as their record is appended
+// (true meaning "applied, not yet durable") and the scope keeps the newest
+// record; then() has the log's commit thread report back instead. Without
+// one, mutations wait for the disk as before. Scopes nest; the innermost wins.
+class DeferredCommit {
+public:
+    DeferredCommit();
+    ~DeferredCommit();
+    DeferredCommit(const DeferredCommit&) = delete;
+    DeferredCommit& operator=(const DeferredCommit&) = delete;
+
+    // A change was logged in this scope and is not known to be durable yet
+    bool pending() const { return log != nullptr; }
+
+    // done(true) once every change logged in this scope is on disk, or
+    // done(false) if the log failed first (the system is read-only by then);
+    // right away when nothing is pending. See WriteAheadLog::whenDurable
+    void then(std::function<void(bool durable)> done);
+
+private:
+    friend class MedicineReminderSystem;
+    static thread_local DeferredCommit* current;
+    DeferredCommit* outer;
+    MedicineReminderSystem* system;
+    WriteAheadLog* log;
+    uint64_t lsn;
 };
 
 
+// Thread safety: every public operation is atomic. Reads hold stateMutex
+// shared, so dashboard traffic runs in parallel; mutations (including
+// composites such as markReminderTaken and undo, which touch several
+// managers and the undo stack) hold it exclusively for their whole duration.
+//
+// List endpoints go further and render from immutable, reference-counted
+// snapshots (RCU style) that the managers publish through a PublishedList:
+// each change is noted as it is made, and a reader folds the changes into a
+// new version without touching stateMutex. No reader copies live state or
+// holds up a writer, formatting and streaming happen with no lock held, and
+// old versions are freed when their last reader drops them.
+//
+// Persistence (enableLog): mutations are appended to a write-ahead log under
+// the exclusive lock and acknowledged once group-committed (by waiting, or
+// through a DeferredCommit on threads that must not block). Every
+// snapshotEvery records the writer that crosses the mark starts a background
+// thread, which takes a consistent image from the published snapshots
+// (holding the shared lock only to fold in the last changes and to encode the
+// categories and undo history), writes it out and then has the log cut back
+// to the point the image covers. Start-up maps the snapshot, bulk-loads it and
+// replays only the log records after it. If the log ever fails to write,
+// the change in flight is reported as failed and the system goes read-only
+// rather than acknowledge changes that would be lost.
 class MedicineReminderSystem {
 private:
+    friend class DeferredCommit;
+
     CategoryManager categoryManager;
     MedicineManager medicineManager;
     ReminderScheduler reminderScheduler;
     ReminderQueue reminderQueue;
     UndoManager undoManager;
     
+    mutable std::shared_mutex stateMutex;
+    
+    // Revert (undo) or re-apply (redo) an action; caller holds stateMutex
+    // exclusively. Returns false (action dropped) when the state no longer allows it
+    bool applyLocked(Action& action, bool reverse);
+    
+    // Durable log of every mutation; null while running in memory only
+    std::unique_ptr<WriteAheadLog> wal;
+    
+    // Log a mutation made under the exclusive lock, then release the lock and
+    // wait for the record's group commit (or leave that to the thread's
+    // DeferredCommit). Change events noted under the lock are delivered by the
+    // log once the record is durable, so listeners only hear about durable
+    // changes, in the order they were made. False if the record did not reach
+    // the disk: the change stands in memory only, and the system turns read-only
+    bool logLocked(std::unique_lock<std::shared_mutex>& lock, const WalRecord& record);
+    
+    // Set once the log fails; every mutation is refused from then on
+    std::atomic<bool> readOnly;
+    
+    ChangeListener changeListener;
+    std::vector<ChangeEvent> pendingEvents;     // Noted under the exclusive lock, handed out by logLocked
+    
+    // Note a change for the listener (no-op without one); caller holds stateMutex exclusively
+    void noteLocked(ChangeEvent&& event);
+    // Note med's stock moving from before to its current value, and crossing into low stock
+    void noteStockLocked(const Medicine& med, int before);
+    // Re-apply one logged mutation during startup
+    void replayRecord(const char* payload, size_t size);
+    
+    uint64_t snapshotLsn;               // Log position the newest snapshot started covers
+    std::thread snapshotWriter;
+    std::atomic<bool> snapshotBusy;     // A snapshot is being written
+    mutable std::mutex dispatchMutex;   // Keeps dispatchDue (a shared-lock writer) out of a snapshot image
+    
+    // Have snapshotWriter snapshot the state (as of lsn or later); caller
+    // holds stateMutex exclusively
+    void startSnapshotLocked(uint64_t lsn);
+    // Encode the whole state and set lsn to the last log record it reflects;
+    // false (nothing to write) once the system is read-only. Takes the
+    // shared lock itself, so never call it holding stateMutex
+    bool encodeSnapshot(std::string& payload, uint64_t& lsn) const;
+    // Replace the state with a snapshot payload; false if it does not decode
+    bool loadSnapshot(const char* payload, size_t size);
+    
 public:
-    // Constructor
-    MedicineReminderSystem();
+    // historyDepth: how many actions undo can go back
+    explicit MedicineReminderSystem(size_t historyDepth = UndoManager::DEFAULT_DEPTH);
+    ~MedicineReminderSystem();
+    
+    // Persistence: rebuild this (empty) system from the snapshot and log named
+    // in config, then log every mutation from here on. False if the log cannot
+    // be opened or the snapshot is unreadable
+    bool enableLog(const WalConfig& config);
+    // Write a final snapshot, sync what is still pending and stop logging
+    void closeLog();
+    
+    // The log could not be written: mutations all fail (return false) and
+    // nothing more is persisted; reads still work. Cleared only by a restart
+    bool isReadOnly() const { return readOnly.load(std::memory_order_acquire); }
+    
+    // Called after each change with what it did (reminders due or taken,
+    // stock moves, low stock, undo/redo), once the change is durable, with no
+    // lock held: on the thread that made it, or on the log's commit thread.
+    // Set it before serving (after enableLog, so replay is quiet)
+    void setChangeListener(ChangeListener listener);
     
     // Category operations
     bool addCategory(const std::string& category);
     bool removeCategory(const std::string& category);
     bool undo();
+    bool redo();
     std::string listCategories() const;
     
-    // Medicine operations
-    void addMedicine(const std::string& name, const std::string& dose, 
+    // Medicine operations (adds fail when the name already exists)
+    bool addMedicine(const std::string& name, const std::string& dose, 
                      const std::string& timings, const std::string& category);
-    void addMedicineWithStock(const std::string& name, const std::string& dose, 
+    bool addMedicineWithStock(const std::string& name, const std::string& dose, 
                               const std::string& timings, const std::string& category,
                               int stock, int threshold);
     bool deleteMedicine(const std::string& name);
@@ -320,14 +1003,35 @@ public:
     std::string getLowStockAlerts() const;
     bool checkStockAvailable(const std::string& name) const;
     
-    // Reminder operations
-    void scheduleReminder(const std::string& medicine, const std::string& time);
+    // Reminder operations (scheduling fails on a malformed time)
+    bool scheduleReminder(const std::string& medicine, const std::string& time);
     std::string viewScheduledReminders() const;
+    std::string viewRemindersBetween(int fromMinute, int toMinute) const;
+    
+    // Move reminders scheduled in [fromMinute, toMinute] into the due queue
+    // (called by ReminderDispatcher); returns how many fired
+    int dispatchDue(int fromMinute, int toMinute);
     std::string getNextReminder() const;
-    void markReminderTaken();
+    // Take the front due reminder (one unit of its stock); false if none are due
+    bool markReminderTaken();
     std::string viewReminderQueue() const;
     bool deleteReminder(const std::string& medicine, const std::string& time);
     
+    // Apply actions in order as one change: a single lock hold, one undo
+    // entry and one log record. If any of them is refused, those already
+    // applied are reverted, failedAt is set to its index and nothing changes.
+    // Actions come in as requested (an UpdateStockAction's before is filled in)
+    bool applyBatch(std::vector<Action>&& actions, size_t& failedAt);
+    
+    // Bulk import: every row added under one exclusive hold and written as
+    // one log record, strings moved into the nodes, index and pool grown once
+    // up front. Not undoable (tens of thousands of rows would swamp the
+    // history); like any new change it clears the redo stack. rejected gets
+    // the indices of refused rows (name already taken / invalid time). False
+    // if none of it was persisted (the system is read-only)
+    bool importMedicines(std::vector<MedicineRecord>&& records, std::vector<size_t>& rejected);
+    bool importReminders(std::vector<ReminderRecord>&& records, std::vector<size_t>& rejected);
+    
     // Undo operations
     bool undoLastAction();
     std::string viewActionHistory() const;
@@ -335,7 +1039,29 @@ public:
     // System status
     std::string getSystemStatus() const;
     
-    // Get individual managers
+    // Node pool occupancy, one line per node type
+    std::string getMemoryStats() const;
+    
+    // Structured reads for the JSON API. The lists are the same immutable
+    // snapshots the text listings render from and can be walked with no lock
+    // held; the smaller results are copied under the shared lock.
+    std::shared_ptr<const SnapshotPart<MedicineRecord>> getMedicineRecords() const;
+    std::shared_ptr<const SnapshotPart<ReminderRecord>> getReminderRecords() const;
+    std::shared_ptr<const SnapshotPart<ReminderRecord>> getQueueRecords() const;
+    std::shared_ptr<const SnapshotPart<HistoryRecord>> getHistoryRecords() const;
+    SystemCounts getCounts() const;
+    void copyCategories(std::vector<std::string>& out) const;
+    void copyMedicinesInCategory(const std::string& category, std::vector<MedicineRecord>& out) const;
+    void copyLowStock(std::vector<MedicineRecord>& out) const;
+    void copyRemindersBetween(int fromMinute, int toMinute, std::vector<ReminderRecord>& out) const;
+    bool findMedicine(const std::string& name, MedicineRecord& out) const;
+    // Autocomplete: up to limit medicines whose names start with prefix
+    // (case-insensitive), in name order
+    void suggestMedicines(const std::string& prefix, size_t limit, std::vector<MedicineRecord>& out) const;
+    // Next reminder from the current local time; tomorrow set when it wraps
+    bool findNextReminder(ReminderRecord& out, bool& tomorrow) const;
+    
+    // Get individual managers (unsynchronised: single-threaded use only)
     CategoryManager& getCategoryManager() { return categoryManager; }
     MedicineManager& getMedicineManager() { return medicineManager; }
     ReminderScheduler& getReminderScheduler() { return reminderScheduler; }
@@ -0,0 +1,136 @@
+#ifndef NODE_POOL_H
+#define NODE_POOL_H
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+/// slab allocator
+
+// Occupancy of one pool, for diagnostics
+struct PoolStats {
+    const char* type;
+    size_t slabs;       // Contiguous blocks obtained from the heap
+    size_t capacity;    // Node slots across all slabs
+    size_t inUse;       // Slots holding a live node
+    size_t bytes;       // Heap held by the slabs
+};
+
+// Typed pool for one kind of list/tree node. Nodes are carved out of
+// contiguous slabs (32 slots at first, doubling up to 4096) and recycled
+// through an intrusive free list, so adds and removes do not touch malloc
+// once the pool has warmed up, and nodes allocated together sit together.
+//
+// Not synchronised: each pool belongs to one manager and is only used under
+// the lock that guards that manager.
+template <typename T>
+class NodePool {
+public:
+    explicit NodePool(const char* type) : type(type), freeList(nullptr), nextSlabSlots(32), inUse(0), capacity(0) {}
+
+    NodePool(const NodePool&) = delete;
+    NodePool& operator=(const NodePool&) = delete;
+
+    ~NodePool() { reset(); }
+
+    // Construct a node in a free slot
+    template <typename... Args>
+    T* create(Args&&... args) {
+        if (freeList == nullptr) {
+            grow(nextSlabSlots);
+            if (nextSlabSlots < 4096) {
+                nextSlabSlots *= 2;
+            }
+        }
+        Slot* slot = freeList;
+        T* node = new (slot->storage) T(std::forward<Args>(args)...);
+        freeList = slot->nextFree;
+        slot->live = true;
+        inUse++;
+        return node;
+    }
+
+    // Destroy a node from this pool and return its slot to the free list
+    void destroy(T* node) {
+        if (node == nullptr) return;
+        Slot* slot = reinterpret_cast<Slot*>(node);
+        node->~T();
+        slot->live = false;
+        slot->nextFree = freeList;
+        freeList = slot;
+        inUse--;
+    }
+
+    // Make room for count more nodes with at most one heap call: a single
+    // slab sized to the shortfall (bulk loads)
+    void reserve(size_t count) {
+        size_t free = capacity - inUse;
+        if (count > free) {
+            grow(count - free);
+        }
+    }
+
+    // Destroy every live node and release all slabs in one pass, without
+    // the owner walking its structure node by node
+    void reset() {
+        for (Slab& slab : slabs) {
+            for (size_t i = 0; i < slab.count; i++) {
+                if (slab.slots[i].live) {
+                    reinterpret_cast<T*>(slab.slots[i].storage)->~T();
+                }
+            }
+        }
+        slabs.clear();
+        freeList = nullptr;
+        nextSlabSlots = 32;
+        inUse = 0;
+        capacity = 0;
+    }
+
+    PoolStats stats() const {
+        return PoolStats{type, slabs.size(), capacity, inUse, capacity * sizeof(Slot)};
+    }
+
+private:
+    // The node must sit at offset 0 so destroy() can map it back to its slot
+    struct Slot {
+        alignas(T) unsigned char storage[sizeof(T)];
+        Slot* nextFree;
+        bool live;
+    };
+
+    struct Slab {
+        std::unique_ptr<Slot[]> slots;
+        size_t count;
+    };
+
+    const char* type;
+    std::vector<Slab> slabs;
+    Slot* freeList;
+    size_t nextSlabSlots;
+    size_t inUse;
+    size_t capacity;
+
+    void grow(size_t count) {
+        Slab slab{std::unique_ptr<Slot[]>(new Slot[count]), count};
+        // Thread the new slots onto the free list in address order
+        for (size_t i = 0; i < count; i++) {
+            slab.slots[i].live = false;
+            slab.slots[i].nextFree = i + 1 < count ? &slab.slots[i + 1] : freeList;
+        }
+        freeList = &slab.slots[0];
+        slabs.push_back(std::move(slab));
+        capacity += count;
+    }
+};
+
+// One line per pool: "<type>: <inUse>/<capacity> nodes in <slabs> slabs (<bytes> bytes)"
+inline std::string formatPoolStats(const PoolStats& stats) {
+    return std::string(stats.type) + ": " + std::to_string(stats.inUse) + "/" + std::to_string(stats.capacity) +
+           " nodes in " + std::to_string(stats.slabs) + " slabs (" + std::to_string(stats.bytes) + " bytes)";
+}
+
+#endif // NODE_POOL_H
@@ -0,0 +1,160 @@
+#include "PatientRegistry.h"
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <thread>
+
+PatientRegistry::PatientRegistry(const PatientConfig& config, ReminderDispatcher& dispatcher,
+                                 std::function<void(Patient&)> ready)
+    : config(config), dispatcher(dispatcher), ready(std::move(ready)), defaultPatient(""), created(0), loaded(0) {
+    size_t count = config.shards != 0 ? config.shards : std::max(1u, std::thread::hardware_concurrency());
+    shards.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        shards.push_back(std::make_unique<Shard>(config.wal.groupCommitUs));
+        shards.back()->committer.start();
+    }
+}
+
+PatientRegistry::~PatientRegistry() {
+    close();
+}
+
+bool PatientRegistry::validId(std::string_view id) {
+    if (id.empty() || id.size() > 64) {
+        return false;
+    }
+    for (char c : id) {
+        if (!std::isalnum(static_cast<unsigned char>(c)) && c != '_' && c != '-') {
+            return false;
+        }
+    }
+    return true;
+}
+
+PatientRegistry::Shard& PatientRegistry::shardOf(std::string_view id) const {
+    return *shards[std::hash<std::string_view>()(id) % shards.size()];
+}
+
+bool PatientRegistry::open() {
+    // Patients saved by earlier runs; entries are only made when asked for
+    std::error_code error;
+    for (std::filesystem::directory_iterator it(config.dataDir, error), end; !error && it != end;
+         it.increment(error)) {
+        std::string extension = it->path().extension().string();
+        std::string id = it->path().stem().string();
+        if ((extension == ".wal" || extension == ".snap") && validId(id)) {
+            shardOf(id).onDisk.insert(id);
+        }
+    }
+
+    if (loadFrom(defaultPatient, config.wal)) {
+        return true;
+    }
+    // Serve from memory, as a single-patient server always has
+    ready(defaultPatient);
+    dispatcher.attach(&defaultPatient.system);
+    defaultPatient.state.store(Patient::Ready, std::memory_order_release);
+    loaded.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+bool PatientRegistry::loadFrom(Patient& patient, const WalConfig& wal) {
+    std::lock_guard<std::mutex> lock(patient.loadMutex);
+    int state = patient.state.load(std::memory_order_acquire);
+    if (state != Patient::Unloaded) {
+        return state == Patient::Ready;
+    }
+    // A patient whose data does not load stays refused (until restart)
+    // rather than starting empty and overwriting it with a new snapshot
+    if (!patient.system.enableLog(wal)) {
+        patient.state.store(Patient::Failed, std::memory_order_release);
+        return false;
+    }
+    ready(patient);
+    dispatcher.attach(&patient.system);
+    patient.state.store(Patient::Ready, std::memory_order_release);
+    loaded.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+Patient* PatientRegistry::lookup(std::string_view id, bool create, Lookup& result) {
+    result = Lookup::Found;
+    if (id.empty()) {
+        return &defaultPatient;
+    }
+    if (!validId(id)) {
+        result = Lookup::Invalid;
+        return nullptr;
+    }
+    Shard& shard = shardOf(id);
+    std::string key(id);
+    {
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        auto it = shard.patients.find(key);
+        if (it != shard.patients.end()) {
+            return it->second.get();
+        }
+        if (!create && shard.onDisk.count(key) == 0) {
+            result = Lookup::Unknown;
+            return nullptr;
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    std::unique_ptr<Patient>& slot = shard.patients[key];
+    if (!slot) {
+        if (created.fetch_add(1, std::memory_order_relaxed) >= config.maxPatients) {
+            created.fetch_sub(1, std::memory_order_relaxed);
+            shard.patients.erase(key);
+            result = Lookup::Full;
+            return nullptr;
+        }
+        slot = std::make_unique<Patient>(key);
+        shard.onDisk.erase(key);
+    }
+    return slot.get();
+}
+
+bool PatientRegistry::load(Patient& patient) {
+    if (isLoaded(patient) || &patient == &defaultPatient) {
+        return isLoaded(patient);   // The default patient is settled by open()
+    }
+    std::call_once(dataDirCreated, [this] {
+        std::error_code error;
+        std::filesystem::create_directories(config.dataDir, error);
+    });
+    WalConfig wal = config.wal;
+    wal.committer = &shardOf(patient.id).committer;
+    wal.path = config.dataDir + "/" + patient.id + ".wal";
+    wal.snapshotPath = config.dataDir + "/" + patient.id + ".snap";
+    return loadFrom(patient, wal);
+}
+
+Patient* PatientRegistry::find(std::string_view id, bool create) {
+    Lookup result;
+    Patient* patient = lookup(id, create, result);
+    return patient != nullptr && load(*patient) ? patient : nullptr;
+}
+
+void PatientRegistry::close() {
+    // Requests have stopped by now; shards close side by side since every
+    // patient writes a final snapshot
+    std::vector<std::thread> closers;
+    for (const std::unique_ptr<Shard>& shard : shards) {
+        closers.emplace_back([this, &shard] {
+            std::unique_lock<std::shared_mutex> lock(shard->mutex);
+            for (auto& [id, patient] : shard->patients) {
+                if (patient->state.load(std::memory_order_acquire) == Patient::Ready) {
+                    dispatcher.detach(&patient->system);
+                    patient->system.closeLog();
+                }
+            }
+            shard->committer.stop();
+        });
+    }
+    for (std::thread& closer : closers) {
+        closer.join();
+    }
+    dispatcher.detach(&defaultPatient.system);
+    defaultPatient.system.closeLog();
+}
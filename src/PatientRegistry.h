@@ -0,0 +1,133 @@
+#ifndef PATIENT_REGISTRY_H
+#define PATIENT_REGISTRY_H
+
+#include "MedicineReminderSystem.h"
+#include "ReminderDispatcher.h"
+#include "EventHub.h"
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/// patients
+
+// One patient's independent state: its own system (locks, lists, undo
+// history, log) and its own live event stream.
+struct Patient {
+    explicit Patient(std::string id) : id(std::move(id)), events(std::make_shared<EventHub>()) {}
+
+    const std::string id;                   // Empty for the default patient
+    MedicineReminderSystem system;
+    std::shared_ptr<EventHub> events;       // Behind /api/events?patient=id
+
+private:
+    friend class PatientRegistry;
+    enum State { Unloaded, Ready, Failed };
+    std::atomic<int> state{Unloaded};
+    std::mutex loadMutex;                   // Held while the log is replayed
+};
+
+struct PatientConfig {
+    WalConfig wal;                  // Default patient's log; the others use its settings
+    std::string dataDir = "patients";   // Holds <id>.wal and <id>.snap per patient
+    size_t shards = 0;              // 0: one per hardware thread
+    size_t maxPatients = 10000;     // Further IDs are refused rather than created
+};
+
+// Patient ID -> Patient. A patient is created by its first change (or by
+// an import naming it); looking up an ID that has neither an entry nor files
+// from an earlier run creates nothing, so stray or mistyped IDs cost no
+// memory. Which IDs have files is read from dataDir once, by open().
+//
+// Patients are spread over shards by a hash of the ID, each shard with its
+// own lock and map, so a lookup only ever waits on lookups in the same
+// shard, and then only while a new patient's entry is being added. lookup()
+// never touches the disk; load() (snapshot + log replay) runs under that
+// patient's own mutex, not the shard's, and the server calls it from a
+// worker thread. After the lookup a request takes only its patient's locks,
+// so two patients' requests never contend.
+//
+// The default patient (no ID) keeps the server's original log files and
+// commit thread; the others persist to dataDir, and a shard's patients share
+// one commit thread (WalCommitter), so thousands of patients do not mean
+// thousands of threads. Every loaded patient is attached to the shared
+// ReminderDispatcher. Patients stay loaded until close().
+class PatientRegistry {
+public:
+    // ready runs once per patient after its state is loaded, before any
+    // request sees it (to attach change listeners)
+    PatientRegistry(const PatientConfig& config, ReminderDispatcher& dispatcher,
+                    std::function<void(Patient&)> ready);
+    ~PatientRegistry();
+
+    PatientRegistry(const PatientRegistry&) = delete;
+    PatientRegistry& operator=(const PatientRegistry&) = delete;
+
+    // 1-64 of [A-Za-z0-9_-]: IDs become file names
+    static bool validId(std::string_view id);
+
+    // Load the default patient and note which patients have files in
+    // dataDir; false if the default patient's log could not be opened (it
+    // then runs in memory only, as before sharding)
+    bool open();
+
+    enum class Lookup { Found, Invalid, Unknown, Full };
+
+    // The patient for id, an empty id being the default patient, whether or
+    // not it is loaded yet. An unknown id (no entry, no files) gets an entry
+    // only with create. nullptr if id is invalid or unknown, or if the
+    // registry is full; result says which
+    Patient* lookup(std::string_view id, bool create, Lookup& result);
+
+    // Load patient's state if that has not happened yet; blocks on the disk.
+    // False if its data cannot be loaded (the patient then stays refused
+    // until restart rather than start empty over it)
+    bool load(Patient& patient);
+
+    static bool isLoaded(const Patient& patient) {
+        return patient.state.load(std::memory_order_acquire) == Patient::Ready;
+    }
+
+    // lookup and load in one, for callers that may block (--import):
+    // nullptr if either fails
+    Patient* find(std::string_view id, bool create);
+
+    // Close every patient's log (final snapshots written in parallel, one
+    // thread per shard), detach them from the dispatcher and stop the
+    // shards' commit threads
+    void close();
+
+    size_t shardCount() const { return shards.size(); }
+    size_t patientCount() const { return loaded.load(std::memory_order_relaxed); }
+
+private:
+    struct Shard {
+        explicit Shard(int groupCommitUs) : committer(groupCommitUs) {}
+
+        WalCommitter committer;     // Syncs the logs of every patient in the shard (outlives them)
+        mutable std::shared_mutex mutex;
+        std::unordered_map<std::string, std::unique_ptr<Patient>> patients;
+        std::unordered_set<std::string> onDisk;     // IDs with files from an earlier run, not yet looked up
+    };
+
+    Shard& shardOf(std::string_view id) const;
+    bool loadFrom(Patient& patient, const WalConfig& wal);
+
+    PatientConfig config;
+    ReminderDispatcher& dispatcher;
+    std::function<void(Patient&)> ready;
+    Patient defaultPatient;
+    std::vector<std::unique_ptr<Shard>> shards;
+    std::atomic<size_t> created;    // Entries added to shards (maxPatients)
+    std::atomic<size_t> loaded;     // Patients with state Ready, the default included
+    std::once_flag dataDirCreated;
+};
+
+#endif // PATIENT_REGISTRY_H
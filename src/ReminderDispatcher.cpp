@@ -0,0 +1,88 @@
+#include "ReminderDispatcher.h"
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+
+ReminderDispatcher::ReminderDispatcher() : stopping(false), fired(0) {}
+
+ReminderDispatcher::~ReminderDispatcher() {
+    stop();
+}
+
+void ReminderDispatcher::attach(MedicineReminderSystem* system) {
+    std::lock_guard<std::mutex> lock(mutex);
+    systems.push_back(system);
+}
+
+void ReminderDispatcher::detach(MedicineReminderSystem* system) {
+    std::lock_guard<std::mutex> lock(mutex);
+    systems.erase(std::remove(systems.begin(), systems.end(), system), systems.end());
+}
+
+void ReminderDispatcher::start() {
+    if (thread.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = false;
+    }
+    thread = std::thread(&ReminderDispatcher::run, this);
+}
+
+void ReminderDispatcher::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+ReminderDispatcher::LocalMinute ReminderDispatcher::now() {
+    std::time_t seconds = std::time(nullptr);
+    std::tm local{};
+#ifdef _WIN32
+    localtime_s(&local, &seconds);
+#else
+    localtime_r(&seconds, &local);
+#endif
+    return LocalMinute{local.tm_year * 366L + local.tm_yday, local.tm_hour * 60 + local.tm_min};
+}
+
+void ReminderDispatcher::dispatch(int fromMinute, int toMinute) {
+    // Caller holds mutex, so attached systems cannot be detached mid-dispatch
+    for (MedicineReminderSystem* system : systems) {
+        fired.fetch_add(system->dispatchDue(fromMinute, toMinute), std::memory_order_relaxed);
+    }
+}
+
+void ReminderDispatcher::run() {
+    using namespace std::chrono;
+
+    // Pretend the previous minute was processed so the current one fires
+    LocalMinute last = now();
+    last.minute--;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        LocalMinute current = now();
+        // Day keys are ordered, so a smaller one is a backward step across
+        // midnight: like any backward step it waits for the clock to pass last
+        if (current.day > last.day) {
+            // Crossed midnight: finish the old day, then today up to now
+            if (last.minute + 1 < ReminderScheduler::MINUTES_PER_DAY) {
+                dispatch(last.minute + 1, ReminderScheduler::MINUTES_PER_DAY - 1);
+            }
+            dispatch(0, current.minute);
+            last = current;
+        } else if (current.day == last.day && current.minute > last.minute) {
+            dispatch(last.minute + 1, current.minute);
+            last = current;
+        }
+
+        // Sleep until just past the next wall-clock minute
+        auto nextMinute = time_point_cast<minutes>(system_clock::now()) + minutes(1) + milliseconds(20);
+        wake.wait_until(lock, nextMinute, [this] { return stopping; });
+    }
+}
@@ -0,0 +1,63 @@
+#ifndef REMINDER_DISPATCHER_H
+#define REMINDER_DISPATCHER_H
+
+#include "MedicineReminderSystem.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// wall-clock dispatch
+
+// Background thread that fires reminders: at each minute of local time it
+// moves the reminders scheduled for that minute from every attached system's
+// timing wheel into its due queue. The thread sleeps on a condition variable
+// until the next minute boundary, so request threads never do this work.
+//
+// Catch-up: each wake covers every minute since the last one processed, read
+// from the wheel's occupancy bitmap, so a stall or a forward clock jump fires
+// what was missed without scanning the schedule. After a stall that crosses
+// midnight the rest of the old day and today up to now are fired; whole days
+// in between are not replayed. A backward clock step, even one back across
+// midnight, fires nothing until the clock passes the last minute processed
+// again.
+class ReminderDispatcher {
+public:
+    ReminderDispatcher();
+    ~ReminderDispatcher();
+
+    ReminderDispatcher(const ReminderDispatcher&) = delete;
+    ReminderDispatcher& operator=(const ReminderDispatcher&) = delete;
+
+    // Systems to fire reminders for; detach blocks while a dispatch is running
+    void attach(MedicineReminderSystem* system);
+    void detach(MedicineReminderSystem* system);
+
+    // Start the thread; reminders from the current minute on are fired
+    void start();
+    void stop();
+
+    // Reminders moved into due queues since start
+    uint64_t getFiredCount() const { return fired.load(std::memory_order_relaxed); }
+
+private:
+    struct LocalMinute {
+        long day;       // Changes once per local day (not contiguous)
+        int minute;     // 0..1439
+    };
+
+    static LocalMinute now();
+    void run();
+    void dispatch(int fromMinute, int toMinute);
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping;
+    std::thread thread;
+    std::vector<MedicineReminderSystem*> systems;
+    std::atomic<uint64_t> fired;
+};
+
+#endif // REMINDER_DISPATCHER_H
@@ -0,0 +1,102 @@
+#ifndef ROUTE_TABLE_H
+#define ROUTE_TABLE_H
+
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+
+// Bit flags so one route can accept several methods
+enum HttpMethod : unsigned {
+    METHOD_GET = 1u << 0,
+    METHOD_POST = 1u << 1,
+};
+
+constexpr unsigned methodFlag(std::string_view method) {
+    return method == "GET" ? METHOD_GET : method == "POST" ? METHOD_POST : 0u;
+}
+
+template <typename Handler>
+struct Route {
+    std::string_view path{};
+    unsigned methods = 0;
+    Handler handler = nullptr;
+};
+
+// Seeded FNV-1a; the seed is what the perfect-hash search varies. The final
+// mix spreads high bits down, since FNV's low bits only see the inputs' low bits.
+constexpr uint32_t routeHash(std::string_view text, uint32_t seed) {
+    uint32_t hash = 2166136261u ^ (seed * 0x9e3779b9u);
+    for (char c : text) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 16777619u;
+    }
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bu;
+    hash ^= hash >> 13;
+    return hash;
+}
+
+/// compile-time perfect hash
+
+// Built entirely at compile time from a constexpr route array: searches for a
+// hash seed under which every path lands in its own slot of a power-of-two
+// table (at least twice the route count). Lookup is one hash, one slot read
+// and one string comparison, whatever the number of routes.
+template <typename Handler, size_t N>
+class RouteTable {
+public:
+    static constexpr size_t SLOTS = [] {
+        size_t size = 1;
+        while (size < 2 * N) size <<= 1;
+        return size;
+    }();
+
+    constexpr explicit RouteTable(const Route<Handler> (&list)[N]) {
+        for (size_t i = 0; i < N; i++) {
+            routes[i] = list[i];
+        }
+        for (seed = 1; seed < 100000; seed++) {
+            if (tryBuild()) {
+                return;
+            }
+        }
+        throw "RouteTable: no perfect hash seed found (duplicate path?)";
+    }
+
+    // The route registered for path, or nullptr
+    constexpr const Route<Handler>* find(std::string_view path) const {
+        int index = slots[routeHash(path, seed) & (SLOTS - 1)];
+        if (index < 0 || routes[index].path != path) {
+            return nullptr;
+        }
+        return &routes[index];
+    }
+
+    constexpr size_t size() const { return N; }
+
+private:
+    Route<Handler> routes[N] = {};
+    int16_t slots[SLOTS] = {};
+    uint32_t seed = 0;
+
+    constexpr bool tryBuild() {
+        for (size_t s = 0; s < SLOTS; s++) {
+            slots[s] = -1;
+        }
+        for (size_t i = 0; i < N; i++) {
+            size_t slot = routeHash(routes[i].path, seed) & (SLOTS - 1);
+            if (slots[slot] != -1) {
+                return false;
+            }
+            slots[slot] = static_cast<int16_t>(i);
+        }
+        return true;
+    }
+};
+
+template <typename Handler, size_t N>
+constexpr RouteTable<Handler, N> makeRouteTable(const Route<Handler> (&list)[N]) {
+    return RouteTable<Handler, N>(list);
+}
+
+#endif // ROUTE_TABLE_H
@@ -0,0 +1,238 @@
+#include "StaticAssets.h"
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <cstdio>
+
+namespace fs = std::filesystem;
+
+static std::shared_ptr<const std::string> readWholeFile(const fs::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) return nullptr;
+    auto content = std::make_shared<std::string>();
+    file.seekg(0, std::ios::end);
+    content->resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0, std::ios::beg);
+    file.read(&(*content)[0], static_cast<std::streamsize>(content->size()));
+    return content;
+}
+
+// Whether an Accept-Encoding header allows coding (present and not q=0)
+static bool acceptsEncoding(std::string_view header, std::string_view coding) {
+    while (!header.empty()) {
+        size_t comma = header.find(',');
+        std::string_view item = header.substr(0, comma);
+        header = comma == std::string_view::npos ? std::string_view() : header.substr(comma + 1);
+
+        size_t start = item.find_first_not_of(" \t");
+        if (start == std::string_view::npos) continue;
+        item = item.substr(start);
+        size_t semicolon = item.find(';');
+        std::string_view token = item.substr(0, semicolon);
+        while (!token.empty() && (token.back() == ' ' || token.back() == '\t')) token.remove_suffix(1);
+        if (token != coding) continue;
+
+        if (semicolon == std::string_view::npos) return true;
+        std::string_view params = item.substr(semicolon + 1);
+        size_t q = params.find("q=");
+        if (q == std::string_view::npos) return true;
+        std::string_view value = params.substr(q + 2);
+        return !(value.substr(0, 1) == "0" && value.find_first_of("123456789") == std::string_view::npos);
+    }
+    return false;
+}
+
+// If-None-Match uses weak comparison: W/ prefixes are ignored
+static bool etagMatches(std::string_view header, const std::string& etag) {
+    while (!header.empty()) {
+        size_t comma = header.find(',');
+        std::string_view item = header.substr(0, comma);
+        header = comma == std::string_view::npos ? std::string_view() : header.substr(comma + 1);
+
+        size_t start = item.find_first_not_of(" \t");
+        if (start == std::string_view::npos) continue;
+        item = item.substr(start);
+        while (!item.empty() && (item.back() == ' ' || item.back() == '\t')) item.remove_suffix(1);
+        if (item == "*") return true;
+        if (item.substr(0, 2) == "W/") item.remove_prefix(2);
+        if (item == etag) return true;
+    }
+    return false;
+}
+
+StaticAssets::StaticAssets(const std::string& root, int checkIntervalMs)
+    : root(root), checkIntervalMs(checkIntervalMs), stopping(false) {
+    std::atomic_store(&table, scan(nullptr));
+}
+
+StaticAssets::~StaticAssets() {
+    stop();
+}
+
+void StaticAssets::start() {
+    if (thread.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = false;
+    }
+    thread = std::thread(&StaticAssets::run, this);
+}
+
+void StaticAssets::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+void StaticAssets::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!wake.wait_for(lock, std::chrono::milliseconds(checkIntervalMs), [this] { return stopping; })) {
+        lock.unlock();
+        std::shared_ptr<const Table> current = std::atomic_load(&table);
+        std::atomic_store(&table, scan(current.get()));
+        lock.lock();
+    }
+}
+
+size_t StaticAssets::getCount() const {
+    return std::atomic_load(&table)->assets.size();
+}
+
+std::string StaticAssets::contentTypeFor(const std::string& extension) {
+    static const std::unordered_map<std::string, std::string> types = {
+        {".html", "text/html; charset=utf-8"},
+        {".css", "text/css; charset=utf-8"},
+        {".js", "application/javascript; charset=utf-8"},
+        {".json", "application/json"},
+        {".png", "image/png"},
+        {".jpg", "image/jpeg"},
+        {".jpeg", "image/jpeg"},
+        {".gif", "image/gif"},
+        {".svg", "image/svg+xml"},
+        {".ico", "image/x-icon"},
+        {".webp", "image/webp"},
+        {".woff2", "font/woff2"},
+        {".txt", "text/plain; charset=utf-8"},
+    };
+    auto it = types.find(extension);
+    return it != types.end() ? it->second : "application/octet-stream";
+}
+
+std::string StaticAssets::makeEtag(const std::string& content, const char* suffix) {
+    // FNV-1a 64-bit over the exact bytes sent: strong validator
+    unsigned long long hash = 1469598103934665603ULL;
+    for (unsigned char c : content) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    char buffer[40];
+    std::snprintf(buffer, sizeof(buffer), "\"%016llx%s\"", hash, suffix);
+    return buffer;
+}
+
+std::shared_ptr<const StaticAssets::Table> StaticAssets::scan(const Table* previous) const {
+    auto next = std::make_shared<Table>();
+    std::error_code ec;
+    for (fs::recursive_directory_iterator it(root, ec), end; !ec && it != end; it.increment(ec)) {
+        if (!it->is_regular_file(ec)) continue;
+        std::string filePath = it->path().generic_string();
+        next->stamps[filePath] = FileStamp{it->file_size(ec), it->last_write_time(ec)};
+    }
+
+    for (const auto& entry : next->stamps) {
+        fs::path path(entry.first);
+        std::string extension = path.extension().string();
+        if (extension == ".gz" || extension == ".br") continue;
+
+        std::string url = "/" + fs::relative(path, root).generic_string();
+        const std::string gzPath = entry.first + ".gz";
+        const std::string brPath = entry.first + ".br";
+
+        // Reuse the loaded asset if neither it nor its precompressed siblings changed
+        if (previous != nullptr) {
+            auto unchanged = [&](const std::string& file) {
+                auto now = next->stamps.find(file);
+                auto before = previous->stamps.find(file);
+                if (now == next->stamps.end() || before == previous->stamps.end()) {
+                    return now == next->stamps.end() && before == previous->stamps.end();
+                }
+                return now->second == before->second;
+            };
+            auto old = previous->assets.find(url);
+            if (old != previous->assets.end() && unchanged(entry.first) && unchanged(gzPath) && unchanged(brPath)) {
+                next->assets[url] = old->second;
+                continue;
+            }
+        }
+
+        StaticAsset asset;
+        asset.identity.body = readWholeFile(path);
+        if (asset.identity.body == nullptr) continue;
+        asset.identity.etag = makeEtag(*asset.identity.body, "");
+        asset.contentType = contentTypeFor(extension);
+        // HTML must revalidate so new script/style links are seen at once
+        asset.cacheControl = extension == ".html" ? "no-cache" : "public, max-age=60";
+
+        if (next->stamps.count(gzPath) && (asset.gzip.body = readWholeFile(gzPath)) != nullptr) {
+            asset.gzip.etag = makeEtag(*asset.gzip.body, "-gz");
+        }
+        if (next->stamps.count(brPath) && (asset.brotli.body = readWholeFile(brPath)) != nullptr) {
+            asset.brotli.etag = makeEtag(*asset.brotli.body, "-br");
+        }
+        next->assets[url] = std::move(asset);
+    }
+    return next;
+}
+
+bool StaticAssets::serve(const HttpRequest& request, HttpResponse& response) {
+    std::shared_ptr<const Table> current = std::atomic_load(&table);
+
+    std::string url(request.path);
+    if (url.empty() || url.back() == '/') {
+        url += "index.html";
+    }
+    auto it = current->assets.find(url);
+    if (it == current->assets.end()) {
+        // "/V1" -> "/V1/" so the page's relative links resolve inside the folder
+        if (current->assets.count(url + "/index.html")) {
+            response.status = "301 Moved Permanently";
+            response.contentType = "text/plain";
+            response.headers = "Location: " + std::string(request.path) + "/\r\n";
+            return true;
+        }
+        return false;
+    }
+
+    const StaticAsset& asset = it->second;
+    std::string_view acceptEncoding = request.header("Accept-Encoding");
+    const AssetVariant* variant = &asset.identity;
+    const char* encoding = nullptr;
+    if (asset.brotli.body && acceptsEncoding(acceptEncoding, "br")) {
+        variant = &asset.brotli;
+        encoding = "br";
+    } else if (asset.gzip.body && acceptsEncoding(acceptEncoding, "gzip")) {
+        variant = &asset.gzip;
+        encoding = "gzip";
+    }
+
+    response.contentType = asset.contentType;
+    response.headers = "ETag: " + variant->etag + "\r\nCache-Control: " + asset.cacheControl + "\r\n";
+    if (asset.gzip.body || asset.brotli.body) {
+        response.headers += "Vary: Accept-Encoding\r\n";
+    }
+    if (encoding != nullptr) {
+        response.headers += std::string("Content-Encoding: ") + encoding + "\r\n";
+    }
+
+    if (etagMatches(request.header("If-None-Match"), variant->etag)) {
+        response.status = "304 Not Modified";
+        return true;
+    }
+    response.sharedBody = variant->body;
+    return true;
+}
@@ -0,0 +1,81 @@
+#ifndef STATIC_ASSETS_H
+#define STATIC_ASSETS_H
+
+#include "HttpServer.h"
+#include <string>
+#include <string_view>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <unordered_map>
+#include <filesystem>
+
+/// in-memory static files
+
+// One encoding of a file: shared body plus its strong ETag
+struct AssetVariant {
+    std::shared_ptr<const std::string> body;  // nullptr when this encoding is absent
+    std::string etag;
+};
+
+struct StaticAsset {
+    std::string contentType;
+    std::string cacheControl;
+    AssetVariant identity;
+    AssetVariant gzip;      // From a precompressed "<file>.gz" next to the file
+    AssetVariant brotli;    // From a precompressed "<file>.br" next to the file
+};
+
+// Serves everything under a root directory from memory. Files are read once;
+// afterwards a request costs a hash lookup and a header comparison, and never
+// touches the disk. Once started, a background thread re-stats the tree every
+// checkIntervalMs and reloads changed files, publishing a new table
+// atomically while requests keep serving the old one.
+class StaticAssets {
+public:
+    explicit StaticAssets(const std::string& root, int checkIntervalMs = 2000);
+    ~StaticAssets();
+
+    StaticAssets(const StaticAssets&) = delete;
+    StaticAssets& operator=(const StaticAssets&) = delete;
+
+    // Start / stop watching the tree for changes
+    void start();
+    void stop();
+
+    // Fill response for an asset (200, 304 or a 301 to a directory's slash
+    // form). Returns false when no file matches the path.
+    bool serve(const HttpRequest& request, HttpResponse& response);
+
+    size_t getCount() const;
+
+private:
+    // Size + mtime of every file on disk, used to detect changes
+    struct FileStamp {
+        uintmax_t size;
+        std::filesystem::file_time_type mtime;
+        bool operator==(const FileStamp& o) const { return size == o.size && mtime == o.mtime; }
+    };
+
+    struct Table {
+        std::unordered_map<std::string, StaticAsset> assets;   // Keyed by URL path
+        std::unordered_map<std::string, FileStamp> stamps;     // Keyed by file path
+    };
+
+    std::string root;
+    int checkIntervalMs;
+    std::shared_ptr<const Table> table;     // Accessed with std::atomic_load/store
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping;
+    std::thread thread;
+
+    void run();
+    std::shared_ptr<const Table> scan(const Table* previous) const;
+    static std::string contentTypeFor(const std::string& extension);
+    static std::string makeEtag(const std::string& content, const char* suffix);
+};
+
+#endif // STATIC_ASSETS_H
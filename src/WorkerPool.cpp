@@ -0,0 +1,42 @@
+#include "WorkerPool.h"
+#include <chrono>
+
+WorkerPool::WorkerPool(size_t threads, size_t queueCapacity)
+    : threadCount(threads), jobs(queueCapacity), stopping(false) {}
+
+WorkerPool::~WorkerPool() {
+    stop();
+}
+
+void WorkerPool::start() {
+    if (!threads.empty()) return;
+    stopping = false;
+    for (size_t i = 0; i < threadCount; i++) {
+        threads.emplace_back(&WorkerPool::run, this);
+    }
+}
+
+void WorkerPool::stop() {
+    stopping = true;
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    threads.clear();
+}
+
+bool WorkerPool::submit(std::function<void()> job) {
+    return jobs.tryPush(std::move(job));
+}
+
+void WorkerPool::run() {
+    std::function<void()> job;
+    for (;;) {
+        // The timeout only bounds how long a stop goes unnoticed
+        if (jobs.waitPop(job, std::chrono::milliseconds(200))) {
+            job();
+            job = nullptr;
+        } else if (stopping) {
+            return;     // Nothing queued is left behind
+        }
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include "BoundedQueue.h"
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <thread>
+#include <vector>
+
+/// worker pool
+
+// A fixed set of threads for request work that must not run on a server I/O
+// thread: jobs that take long (an upload's import) or block on the disk.
+// Jobs wait in a BoundedQueue, and idle workers sleep in its waitPop, so
+// submitting never takes a lock unless a worker is asleep. The queue does
+// not grow: submit() refuses a job when it is full, so callers can answer
+// 503 rather than pile work up behind a slow disk.
+class WorkerPool {
+public:
+    WorkerPool(size_t threads, size_t queueCapacity);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    void start();
+    // Finish the jobs already queued, then join the threads
+    void stop();
+
+    // Queue job for the next free worker; false when the queue is full
+    bool submit(std::function<void()> job);
+
+private:
+    void run();
+
+    size_t threadCount;
+    BoundedQueue<std::function<void()>> jobs;
+    std::vector<std::thread> threads;
+    std::atomic<bool> stopping;
+};
+
+#endif // WORKER_POOL_H
@@ -0,0 +1,651 @@
+#include "WriteAheadLog.h"
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#ifdef _WIN32
+static int openLog(const char* path) { return _open(path, _O_RDWR | _O_CREAT | _O_BINARY, _S_IREAD | _S_IWRITE); }
+static long long readSome(int fd, char* buffer, size_t size) { return _read(fd, buffer, static_cast<unsigned>(size)); }
+static long long writeSome(int fd, const char* data, size_t size) { return _write(fd, data, static_cast<unsigned>(size)); }
+static bool syncLog(int fd) { return _commit(fd) == 0; }
+static bool truncateLog(int fd, size_t size) { return _chsize_s(fd, static_cast<long long>(size)) == 0; }
+static void seekStart(int fd) { _lseeki64(fd, 0, SEEK_SET); }
+static void seekEnd(int fd) { _lseeki64(fd, 0, SEEK_END); }
+static void closeLog(int fd) { _close(fd); }
+static int createFile(const char* path) { return _open(path, _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE); }
+static bool replaceFile(const char* from, const char* to) {
+    std::remove(to);    // rename() does not overwrite on Windows
+    return std::rename(from, to) == 0;
+}
+#else
+static int openLog(const char* path) { return ::open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644); }
+static long long readSome(int fd, char* buffer, size_t size) { return ::read(fd, buffer, size); }
+static long long writeSome(int fd, const char* data, size_t size) { return ::write(fd, data, size); }
+#ifdef __APPLE__
+static bool syncLog(int fd) { return ::fsync(fd) == 0; }
+#else
+static bool syncLog(int fd) { return ::fdatasync(fd) == 0; }
+#endif
+static bool truncateLog(int fd, size_t size) { return ::ftruncate(fd, static_cast<off_t>(size)) == 0; }
+static void seekStart(int fd) { ::lseek(fd, 0, SEEK_SET); }
+static void seekEnd(int fd) { ::lseek(fd, 0, SEEK_END); }
+static void closeLog(int fd) { ::close(fd); }
+static int createFile(const char* path) { return ::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644); }
+static bool replaceFile(const char* from, const char* to) {
+    if (std::rename(from, to) != 0) return false;
+    // Make the rename itself durable
+    std::string dir(to);
+    size_t slash = dir.find_last_of('/');
+    dir = slash == std::string::npos ? "." : slash == 0 ? "/" : dir.substr(0, slash);
+    int dirFd = ::open(dir.c_str(), O_RDONLY | O_CLOEXEC);
+    if (dirFd >= 0) {
+        ::fsync(dirFd);
+        ::close(dirFd);
+    }
+    return true;
+}
+#endif
+
+static bool writeFully(int fd, const char* data, size_t size) {
+    size_t written = 0;
+    while (written < size) {
+        long long n = writeSome(fd, data + written, size - written);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        written += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+static bool readFully(int fd, std::string& out) {
+    char buffer[64 * 1024];
+    long long n;
+    while ((n = readSome(fd, buffer, sizeof(buffer))) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        out.append(buffer, static_cast<size_t>(n));
+    }
+    return true;
+}
+
+/// record encoding
+
+uint32_t crc32(const char* data, size_t size, uint32_t previous) {
+    // Slicing-by-8: eight table lookups per 8 input bytes instead of one per
+    // byte, so checksumming a large snapshot at start-up is not the bottleneck
+    static const std::vector<uint32_t> table = [] {
+        std::vector<uint32_t> t(8 * 256);
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+        for (uint32_t i = 0; i < 256; i++) {
+            for (int slice = 1; slice < 8; slice++) {
+                uint32_t prev = t[(slice - 1) * 256 + i];
+                t[slice * 256 + i] = t[prev & 0xFF] ^ (prev >> 8);
+            }
+        }
+        return t;
+    }();
+    const uint32_t* t = table.data();
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+    uint32_t crc = previous ^ 0xFFFFFFFFu;
+    while (size >= 8) {
+        uint32_t low = crc ^ (static_cast<uint32_t>(p[0]) | static_cast<uint32_t>(p[1]) << 8 |
+                              static_cast<uint32_t>(p[2]) << 16 | static_cast<uint32_t>(p[3]) << 24);
+        crc = t[7 * 256 + (low & 0xFF)] ^ t[6 * 256 + ((low >> 8) & 0xFF)] ^
+              t[5 * 256 + ((low >> 16) & 0xFF)] ^ t[4 * 256 + (low >> 24)] ^
+              t[3 * 256 + p[4]] ^ t[2 * 256 + p[5]] ^ t[1 * 256 + p[6]] ^ t[p[7]];
+        p += 8;
+        size -= 8;
+    }
+    while (size-- > 0) {
+        crc = t[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+static const size_t HEADER_BYTES = 8;   // length + crc
+static const size_t LSN_BYTES = 8;
+
+static void putU32(std::string& out, uint32_t value) {
+    for (int i = 0; i < 4; i++) out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+}
+
+static uint32_t getU32(const char* p) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++) value |= static_cast<uint32_t>(static_cast<unsigned char>(p[i])) << (8 * i);
+    return value;
+}
+
+static uint64_t getU64(const char* p) {
+    return static_cast<uint64_t>(getU32(p)) | (static_cast<uint64_t>(getU32(p + 4)) << 32);
+}
+
+/// group commit
+
+WriteAheadLog::WriteAheadLog(const WalConfig& config)
+    : config(config), fd(-1), nextLsn(1), durableLsn(0), syncs(0), discardLsn(0), discardedLsn(0),
+      running(false), stopped(false), failed(false), queued(false), notifying(false) {}
+
+WriteAheadLog::~WriteAheadLog() {
+    close();
+}
+
+bool WriteAheadLog::open(const ReplayHandler& handler, uint64_t afterLsn) {
+    fd = openLog(config.path.c_str());
+    if (fd < 0) {
+        std::cerr << "WAL: cannot open " << config.path << ": " << std::strerror(errno) << "\n";
+        return false;
+    }
+
+    nextLsn = afterLsn + 1;
+    discardLsn = discardedLsn = afterLsn;
+    size_t records = replay(handler, afterLsn);
+    durableLsn = nextLsn - 1;
+    if (records > 0) {
+        std::cout << "WAL: replayed " << records << " records from " << config.path << "\n";
+    }
+
+    running = true;
+    stopped = false;
+    if (config.committer == nullptr) {
+        committer = std::thread(&WriteAheadLog::run, this);
+    }
+    return true;
+}
+
+size_t WriteAheadLog::replay(const ReplayHandler& handler, uint64_t afterLsn) {
+    std::string file;
+    readFully(fd, file);
+
+    size_t offset = 0;
+    size_t records = 0;
+    while (file.size() - offset >= HEADER_BYTES) {
+        const char* header = file.data() + offset;
+        uint32_t length = getU32(header);
+        uint32_t crc = getU32(header + 4);
+        if (length < LSN_BYTES || file.size() - offset - HEADER_BYTES < length) break;
+        const char* body = header + HEADER_BYTES;
+        if (crc32(body, length) != crc) break;
+
+        // Records the snapshot already covers are skipped (the file is cut
+        // back to the snapshot point lazily, so a crash can leave some)
+        uint64_t lsn = getU64(body);
+        if (lsn > afterLsn) {
+            handler(lsn, body + LSN_BYTES, length - LSN_BYTES);
+            nextLsn = lsn + 1;
+            records++;
+        }
+        offset += HEADER_BYTES + length;
+    }
+
+    // Drop a torn tail so new records are not appended after garbage
+    if (offset < file.size()) {
+        std::cerr << "WAL: discarding " << (file.size() - offset) << " bytes of incomplete tail\n";
+        truncateLog(fd, offset);
+    }
+    seekEnd(fd);
+    return records;
+}
+
+void WriteAheadLog::close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!running) {
+            if (fd >= 0) {
+                closeLog(fd);
+                fd = -1;
+            }
+            return;
+        }
+        running = false;
+    }
+    signal(true);
+    if (config.committer != nullptr) {
+        // Its next round flushes what is pending and marks the log stopped
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            durableWake.wait(lock, [this] { return stopped; });
+        }
+        config.committer->release(this);
+    } else {
+        committer.join();   // Flushes whatever is still pending on its way out
+    }
+    {
+        // Every waiter has been told by now; let the last callbacks finish
+        std::unique_lock<std::mutex> lock(mutex);
+        durableWake.wait(lock, [this] { return !notifying; });
+    }
+    closeLog(fd);
+    fd = -1;
+}
+
+uint64_t WriteAheadLog::append(const std::string& payload) {
+    uint64_t lsn;
+    bool wake;
+    bool full;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!running || failed) return 0;
+        lsn = nextLsn++;
+
+        size_t start = pending.size();
+        uint32_t length = static_cast<uint32_t>(LSN_BYTES + payload.size());
+        putU32(pending, length);
+        putU32(pending, 0);     // crc, filled in below
+        putU32(pending, static_cast<uint32_t>(lsn));
+        putU32(pending, static_cast<uint32_t>(lsn >> 32));
+        pending += payload;
+        uint32_t crc = crc32(pending.data() + start + HEADER_BYTES, length);
+        for (int i = 0; i < 4; i++) pending[start + 4 + i] = static_cast<char>((crc >> (8 * i)) & 0xFF);
+        // The commit thread sleeps until a batch starts, then again until it is full or the budget runs out
+        full = pending.size() >= config.maxBatchBytes;
+        wake = start == 0 || full;
+    }
+    if (wake) {
+        signal(full);
+    }
+    return lsn;
+}
+
+bool WriteAheadLog::waitDurable(uint64_t lsn) {
+    std::unique_lock<std::mutex> lock(mutex);
+    durableWake.wait(lock, [&] { return durableLsn >= lsn || failed || stopped; });
+    return durableLsn >= lsn;
+}
+
+void WriteAheadLog::whenDurable(uint64_t lsn, std::function<void(bool durable)> done) {
+    std::unique_lock<std::mutex> lock(mutex);
+    waiters.push_back(Waiter{lsn, std::move(done)});
+    notifyLocked(lock);
+}
+
+void WriteAheadLog::notifyLocked(std::unique_lock<std::mutex>& lock) {
+    if (notifying) {
+        return;     // That thread looks again before it stops
+    }
+    notifying = true;
+    std::vector<Waiter> due;
+    for (;;) {
+        // Settled: synced, or never going to be (lsn 0 is a refused append)
+        bool lost = failed || stopped;
+        auto settled = std::stable_partition(waiters.begin(), waiters.end(), [&](const Waiter& waiter) {
+            return waiter.lsn != 0 && waiter.lsn > durableLsn && !lost;
+        });
+        if (settled == waiters.end()) {
+            break;
+        }
+        due.assign(std::make_move_iterator(settled), std::make_move_iterator(waiters.end()));
+        waiters.erase(settled, waiters.end());
+        uint64_t durable = durableLsn;
+        lock.unlock();
+        for (Waiter& waiter : due) {
+            waiter.done(waiter.lsn != 0 && waiter.lsn <= durable);
+        }
+        due.clear();
+        lock.lock();
+    }
+    notifying = false;
+    durableWake.notify_all();
+}
+
+void WriteAheadLog::discardThrough(uint64_t lsn) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!running || lsn <= discardLsn) return;
+        discardLsn = lsn;
+    }
+    signal(false);
+}
+
+void WriteAheadLog::signal(bool urgent) {
+    if (config.committer != nullptr) {
+        config.committer->notify(this, urgent);
+    } else {
+        commitWake.notify_all();
+    }
+}
+
+void WriteAheadLog::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        commitWake.wait(lock, [&] { return !pending.empty() || !running || discardLsn > discardedLsn; });
+
+        if (discardLsn > discardedLsn && !failed) {
+            discardLocked(lock);
+            continue;
+        }
+        if (pending.empty()) break;     // Stopping with nothing left to sync
+
+        // Give writers that arrive within the budget a seat on this sync
+        if (running && pending.size() < config.maxBatchBytes) {
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(config.groupCommitUs);
+            commitWake.wait_until(lock, deadline, [&] {
+                return pending.size() >= config.maxBatchBytes || !running;
+            });
+        }
+        commitLocked(lock);
+    }
+    stopped = true;
+    durableWake.notify_all();
+    notifyLocked(lock);
+}
+
+void WriteAheadLog::commitShared() {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (discardLsn > discardedLsn && !failed) {
+        discardLocked(lock);
+    }
+    if (!pending.empty()) {
+        commitLocked(lock);
+    }
+    if (!running && pending.empty()) {
+        stopped = true;
+        durableWake.notify_all();
+        notifyLocked(lock);
+    }
+}
+
+void WriteAheadLog::discardLocked(std::unique_lock<std::mutex>& lock) {
+    // Only the commit thread touches the file, so it can be rewritten here;
+    // appends keep collecting in pending meanwhile
+    uint64_t through = discardLsn;
+    lock.unlock();
+    bool ok = compact(through);
+    lock.lock();
+    discardedLsn = through;
+    if (!ok) {
+        failed = true;
+        std::cerr << "WAL: rewriting " << config.path << " failed: " << std::strerror(errno)
+                  << " (changes are no longer persisted)\n";
+        durableWake.notify_all();
+        notifyLocked(lock);
+    }
+}
+
+void WriteAheadLog::commitLocked(std::unique_lock<std::mutex>& lock) {
+    batch.swap(pending);
+    pending.clear();
+    uint64_t batchLsn = nextLsn - 1;
+    lock.unlock();
+
+    bool ok = !failed && writeFully(fd, batch.data(), batch.size()) && syncLog(fd);
+    batch.clear();
+
+    lock.lock();
+    if (ok) {
+        durableLsn = batchLsn;
+        syncs++;
+    } else if (!failed) {
+        failed = true;
+        std::cerr << "WAL: write to " << config.path << " failed: " << std::strerror(errno)
+                  << " (changes are no longer persisted)\n";
+    }
+    durableWake.notify_all();
+    notifyLocked(lock);
+}
+
+WalCommitter::WalCommitter(int groupCommitUs) : groupCommitUs(groupCommitUs), urgent(false), stopping(false) {}
+
+WalCommitter::~WalCommitter() {
+    stop();
+}
+
+void WalCommitter::start() {
+    if (thread.joinable()) return;
+    stopping = false;
+    thread = std::thread(&WalCommitter::run, this);
+}
+
+void WalCommitter::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+void WalCommitter::notify(WriteAheadLog* log, bool urgentRound) {
+    bool first;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!log->queued) {
+            log->queued = true;
+            ready.push_back(log);
+        }
+        first = ready.size() == 1;
+        urgent = urgent || urgentRound;
+    }
+    if (first || urgentRound) {
+        wake.notify_one();
+    }
+}
+
+void WalCommitter::release(WriteAheadLog* log) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (log->queued) {
+        log->queued = false;
+        ready.erase(std::find(ready.begin(), ready.end(), log));
+    }
+    roundDone.wait(lock, [&] { return std::find(round.begin(), round.end(), log) == round.end(); });
+}
+
+void WalCommitter::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        wake.wait(lock, [&] { return !ready.empty() || stopping; });
+        if (ready.empty()) break;
+
+        // One budget per round: writers to any of the logs arriving within it share their log's sync
+        if (!urgent && !stopping) {
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(groupCommitUs);
+            wake.wait_until(lock, deadline, [&] { return urgent || stopping; });
+        }
+        round.swap(ready);
+        urgent = false;
+        for (WriteAheadLog* log : round) {
+            log->queued = false;
+        }
+        lock.unlock();
+
+        for (WriteAheadLog* log : round) {
+            log->commitShared();
+        }
+
+        lock.lock();
+        round.clear();
+        roundDone.notify_all();
+    }
+}
+
+bool WriteAheadLog::compact(uint64_t throughLsn) {
+    // Everything written so far is intact (it went through writeFully), so
+    // the scan only has to find where the records after throughLsn start
+    std::string file;
+    seekStart(fd);
+    if (!readFully(fd, file)) return false;
+    size_t offset = 0;
+    while (file.size() - offset >= HEADER_BYTES + LSN_BYTES) {
+        if (getU64(file.data() + offset + HEADER_BYTES) > throughLsn) break;
+        offset += HEADER_BYTES + getU32(file.data() + offset);
+    }
+    if (offset > file.size()) offset = file.size();
+
+    std::string temp = config.path + ".tmp";
+    int out = createFile(temp.c_str());
+    if (out < 0) return false;
+    bool ok = writeFully(out, file.data() + offset, file.size() - offset) && syncLog(out);
+    closeLog(out);
+    if (!ok) return false;
+
+    // Swap files with the old one closed (required on Windows); a crash in
+    // between leaves the old, longer log, which replays the same
+    closeLog(fd);
+    fd = -1;
+    if (!replaceFile(temp.c_str(), config.path.c_str())) {
+        fd = openLog(config.path.c_str());
+        if (fd >= 0) seekEnd(fd);
+        return false;
+    }
+    fd = openLog(config.path.c_str());
+    if (fd < 0) return false;
+    seekEnd(fd);
+    return true;
+}
+
+bool WriteAheadLog::isOpen() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return running;
+}
+
+uint64_t WriteAheadLog::getLastLsn() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return nextLsn - 1;
+}
+
+uint64_t WriteAheadLog::getDurableLsn() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return durableLsn;
+}
+
+uint64_t WriteAheadLog::getSyncCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return syncs;
+}
+
+/// snapshot file
+
+static const char SNAPSHOT_MAGIC[8] = {'M', 'E', 'D', 'L', 'O', 'G', 'I', 'X'};
+
+bool writeSnapshotFile(const std::string& path, uint64_t lsn, const std::string& payload) {
+    // Header fields after the crc are checksummed together with the payload
+    std::string covered;
+    covered.reserve(16);
+    for (int i = 0; i < 8; i++) covered.push_back(static_cast<char>((lsn >> (8 * i)) & 0xFF));
+    uint64_t size = payload.size();
+    for (int i = 0; i < 8; i++) covered.push_back(static_cast<char>((size >> (8 * i)) & 0xFF));
+
+    // CRC of covered followed by payload, continuing the running value
+    uint32_t crc = crc32(covered.data(), covered.size());
+    crc = crc32(payload.data(), payload.size(), crc);
+
+    std::string header(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    putU32(header, SnapshotFile::FORMAT_VERSION);
+    putU32(header, crc);
+    header += covered;
+
+    std::string temp = path + ".tmp";
+    int fd = createFile(temp.c_str());
+    if (fd < 0) return false;
+    bool ok = writeFully(fd, header.data(), header.size()) &&
+              writeFully(fd, payload.data(), payload.size()) && syncLog(fd);
+    closeLog(fd);
+    return ok && replaceFile(temp.c_str(), path.c_str());
+}
+
+SnapshotFile::SnapshotFile() : base(nullptr), size(0), lsn(0), mapped(false) {}
+
+SnapshotFile::~SnapshotFile() {
+    release();
+}
+
+void SnapshotFile::release() {
+#ifndef _WIN32
+    if (mapped) ::munmap(const_cast<char*>(base), size);
+#endif
+    mapped = false;
+    base = nullptr;
+    size = 0;
+    copy.clear();
+}
+
+bool SnapshotFile::open(const std::string& path) {
+    release();
+    error.clear();
+
+#ifdef _WIN32
+    int fd = _open(path.c_str(), _O_RDONLY | _O_BINARY);
+    if (fd < 0) return false;
+    bool read = readFully(fd, copy);
+    _close(fd);
+    if (!read) {
+        error = "cannot read " + path;
+        return false;
+    }
+    base = copy.data();
+    size = copy.size();
+#else
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+        error = std::string("cannot stat ") + path + ": " + std::strerror(errno);
+        ::close(fd);
+        return false;
+    }
+    size = static_cast<size_t>(info.st_size);
+    if (size > 0) {
+#ifdef MAP_POPULATE
+        int flags = MAP_PRIVATE | MAP_POPULATE;     // Fault the pages in up front, in one go
+#else
+        int flags = MAP_PRIVATE;
+#endif
+        void* map = ::mmap(nullptr, size, PROT_READ, flags, fd, 0);
+        if (map != MAP_FAILED) {
+            ::madvise(map, size, MADV_SEQUENTIAL);
+            base = static_cast<const char*>(map);
+            mapped = true;
+        } else if (readFully(fd, copy)) {
+            base = copy.data();
+        }
+    }
+    ::close(fd);
+    if (size > 0 && base == nullptr) {
+        error = "cannot read " + path;
+        size = 0;
+        return false;
+    }
+#endif
+
+    if (size < HEADER_BYTES || std::memcmp(base, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0) {
+        error = path + " is not a snapshot file";
+    } else if (getU32(base + 8) != FORMAT_VERSION) {
+        error = path + " has snapshot format version " + std::to_string(getU32(base + 8)) +
+                ", expected " + std::to_string(FORMAT_VERSION);
+    } else if (getU64(base + 24) != size - HEADER_BYTES) {
+        error = path + " is truncated";
+    } else if (crc32(base + 16, size - 16) != getU32(base + 12)) {
+        error = path + " failed its checksum";
+    }
+    if (!error.empty()) {
+        release();
+        return false;
+    }
+    lsn = getU64(base + 16);
+    return true;
+}
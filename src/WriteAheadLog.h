@@ -0,0 +1,290 @@
+#ifndef WRITE_AHEAD_LOG_H
+#define WRITE_AHEAD_LOG_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// record encoding
+
+// Payload of one log record: an op byte followed by little-endian fixed-width
+// integers and length-prefixed strings. The log itself only frames and
+// checksums payloads; what the op codes mean is up to the caller. Snapshots
+// use the same encoding, without the op byte.
+class WalRecord {
+public:
+    WalRecord() = default;
+    explicit WalRecord(uint8_t op) { bytes.push_back(static_cast<char>(op)); }
+
+    WalRecord& u8(uint8_t value) {
+        bytes.push_back(static_cast<char>(value));
+        return *this;
+    }
+    WalRecord& u32(uint32_t value) {
+        for (int i = 0; i < 4; i++) bytes.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+        return *this;
+    }
+    WalRecord& i32(int32_t value) { return u32(static_cast<uint32_t>(value)); }
+    WalRecord& u64(uint64_t value) { return u32(static_cast<uint32_t>(value)).u32(static_cast<uint32_t>(value >> 32)); }
+    WalRecord& str(const std::string& value) {
+        u32(static_cast<uint32_t>(value.size()));
+        bytes += value;
+        return *this;
+    }
+
+    const std::string& data() const { return bytes; }
+    std::string& data() { return bytes; }
+
+private:
+    std::string bytes;
+};
+
+// Reads a payload written by WalRecord. Any read past the end sets failed
+// and returns zero / empty, so a caller checks ok() once at the end.
+class WalReader {
+public:
+    WalReader(const char* data, size_t size) : data(data), size(size), offset(0), failed(false) {}
+
+    uint8_t op() { return offset < size ? static_cast<uint8_t>(data[offset++]) : fail8(); }
+    uint32_t u32() {
+        if (size - offset < 4) return fail32();
+        uint32_t value = 0;
+        for (int i = 0; i < 4; i++) value |= static_cast<uint32_t>(static_cast<unsigned char>(data[offset + i])) << (8 * i);
+        offset += 4;
+        return value;
+    }
+    int32_t i32() { return static_cast<int32_t>(u32()); }
+    uint64_t u64() {
+        uint64_t low = u32();
+        return low | (static_cast<uint64_t>(u32()) << 32);
+    }
+    std::string str() {
+        uint32_t length = u32();
+        if (failed || size - offset < length) {
+            failed = true;
+            return std::string();
+        }
+        std::string value(data + offset, length);
+        offset += length;
+        return value;
+    }
+
+    bool ok() const { return !failed && offset == size; }
+    size_t remaining() const { return size - offset; }
+
+private:
+    const char* data;
+    size_t size;
+    size_t offset;
+    bool failed;
+
+    uint8_t fail8() { failed = true; return 0; }
+    uint32_t fail32() { failed = true; return 0; }
+};
+
+// CRC-32 (IEEE); pass the previous result to continue over a second buffer
+uint32_t crc32(const char* data, size_t size, uint32_t previous = 0);
+
+/// group commit
+
+class WriteAheadLog;
+
+// One commit thread shared by many logs, for processes that keep more logs
+// open than is sensible to give a thread each (one per patient). A log with
+// a batch started queues itself here; each round waits out the group commit
+// budget once, then writes and syncs every queued log's batch in turn. Logs
+// using it must be closed before it is stopped.
+class WalCommitter {
+public:
+    explicit WalCommitter(int groupCommitUs = 2000);
+    ~WalCommitter();
+
+    WalCommitter(const WalCommitter&) = delete;
+    WalCommitter& operator=(const WalCommitter&) = delete;
+
+    void start();
+    void stop();
+
+private:
+    friend class WriteAheadLog;
+
+    // Queue log for the next round; urgent starts the round without waiting out the budget
+    void notify(WriteAheadLog* log, bool urgent);
+    // Forget a closing log: returns once no round holds it
+    void release(WriteAheadLog* log);
+    void run();
+
+    int groupCommitUs;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable roundDone;
+    std::vector<WriteAheadLog*> ready;  // Each at most once (WriteAheadLog::queued)
+    std::vector<WriteAheadLog*> round;  // Being committed right now
+    bool urgent;
+    bool stopping;
+    std::thread thread;
+};
+
+struct WalConfig {
+    std::string path = "medlogix.wal";
+    int groupCommitUs = 2000;               // Latency budget: how long a batch waits for company before syncing
+    size_t maxBatchBytes = 1024 * 1024;     // A batch this big is synced without waiting out the budget
+    std::string snapshotPath = "medlogix.snap";
+    uint64_t snapshotEvery = 50000;         // Records logged between snapshots (0: only on clean shutdown)
+    WalCommitter* committer = nullptr;      // Shared commit thread; null: the log starts its own
+};
+
+// Append-only, checksummed log of state mutations.
+//
+// File format: each record is [u32 length][u32 crc32][u64 lsn][payload],
+// length covering lsn + payload, crc covering the same bytes. LSNs start at 1
+// and increase by one per record.
+//
+// append() only copies the framed record into the pending batch under a short
+// mutex and returns its LSN; nothing is written on the caller's thread. A
+// single commit thread swaps the batch out, writes it with one write() and
+// makes it durable with one fdatasync(). waitDurable(lsn) blocks until a sync
+// has covered lsn, so N writers arriving within groupCommitUs of each other
+// share one sync instead of paying for N. Threads that must not block (the
+// server's I/O threads) use whenDurable(lsn, done) instead: the commit thread
+// runs done once the sync lands, so a batch is as big as the traffic, not
+// the number of threads willing to wait.
+//
+// open() replays the existing file and cuts off a torn tail (a record whose
+// length or checksum does not check out, as left by a crash mid-write).
+// Once a snapshot covers everything up to some LSN, discardThrough() has the
+// commit thread rewrite the file without those records, so the log only ever
+// holds what happened since the last snapshot.
+//
+// With config.committer set, the log has no thread of its own and a shared
+// WalCommitter does the same work for it.
+class WriteAheadLog {
+public:
+    using ReplayHandler = std::function<void(uint64_t lsn, const char* payload, size_t size)>;
+
+    explicit WriteAheadLog(const WalConfig& config = WalConfig());
+    ~WriteAheadLog();
+
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    // Open (creating if needed) and feed every intact record after afterLsn
+    // (the snapshot point) to handler in order, then start the commit thread.
+    // False if the file cannot be opened
+    bool open(const ReplayHandler& handler, uint64_t afterLsn = 0);
+    // Sync what is pending, stop the commit thread and close the file
+    void close();
+
+    // Queue a record for the next group commit; returns its LSN (0 when closed or failed)
+    uint64_t append(const std::string& payload);
+    // Block until the record at lsn is on disk; false if the log failed first
+    bool waitDurable(uint64_t lsn);
+    // Call done(true) once the record at lsn is on disk, or done(false) if the
+    // log fails or closes first; never blocks. Callbacks run one at a time, in
+    // the order they were registered and with no lock held: on the commit
+    // thread, or right here when lsn is already settled
+    void whenDurable(uint64_t lsn, std::function<void(bool durable)> done);
+    // Drop records up to lsn from the file (a snapshot now covers them); done
+    // by the commit thread between batches, so writers are not held up
+    void discardThrough(uint64_t lsn);
+
+    bool isOpen() const;
+    uint64_t getLastLsn() const;
+    uint64_t getDurableLsn() const;
+    uint64_t getSyncCount() const;
+    const WalConfig& getConfig() const { return config; }
+
+private:
+    friend class WalCommitter;
+
+    WalConfig config;
+    int fd;
+
+    mutable std::mutex mutex;
+    std::condition_variable commitWake;     // Commit thread: a batch has started
+    std::condition_variable durableWake;    // Writers: durableLsn moved
+    std::string pending;
+    std::string batch;      // Being written by the commit thread (buffer reused)
+    uint64_t nextLsn;
+    uint64_t durableLsn;
+    uint64_t syncs;
+    uint64_t discardLsn;    // Requested by discardThrough
+    uint64_t discardedLsn;  // Already cut from the file
+    bool running;
+    bool stopped;       // Commit thread has exited
+    bool failed;
+    std::thread committer;
+    bool queued;        // In the shared committer's ready list (guarded by its mutex)
+
+    struct Waiter {
+        uint64_t lsn;
+        std::function<void(bool durable)> done;
+    };
+    std::vector<Waiter> waiters;    // whenDurable callbacks not yet run, in registration order
+    bool notifying;     // A thread is running callbacks; it also takes any that settle meanwhile
+
+    size_t replay(const ReplayHandler& handler, uint64_t afterLsn);
+    void run();
+    // The commit thread's steps, called with mutex held (released meanwhile):
+    // cut the file back to discardLsn / write and sync the pending batch
+    void discardLocked(std::unique_lock<std::mutex>& lock);
+    void commitLocked(std::unique_lock<std::mutex>& lock);
+    // One round on the shared committer's thread: whatever is due, then stop if closing
+    void commitShared();
+    // Hand the commit thread work
+    void signal(bool urgent);
+    // Run the callbacks of waiters whose record is now durable or lost;
+    // called with mutex held (released meanwhile)
+    void notifyLocked(std::unique_lock<std::mutex>& lock);
+    bool compact(uint64_t throughLsn);
+};
+
+/// snapshot file
+
+// Whole-state image the log can be cut back to. Layout:
+//   [8-byte magic "MEDLOGIX"][u32 format version][u32 crc32][u64 lsn][u64 size][payload]
+// with the crc covering lsn, size and payload. The payload is WalRecord
+// encoded; its layout belongs to the caller and is what the version number
+// tracks. Written to a temporary file, synced, then renamed over the old
+// one, so a crash leaves either the old snapshot or the new one.
+bool writeSnapshotFile(const std::string& path, uint64_t lsn, const std::string& payload);
+
+// A snapshot file mapped read-only (read into memory where mmap is not
+// available) and verified: magic, version and checksum.
+class SnapshotFile {
+public:
+    static const uint32_t FORMAT_VERSION = 1;
+
+    SnapshotFile();
+    ~SnapshotFile();
+
+    SnapshotFile(const SnapshotFile&) = delete;
+    SnapshotFile& operator=(const SnapshotFile&) = delete;
+
+    // False if the file is missing (getError() empty) or invalid (getError() says why)
+    bool open(const std::string& path);
+
+    uint64_t getLsn() const { return lsn; }
+    const char* payload() const { return base + HEADER_BYTES; }
+    size_t payloadSize() const { return size - HEADER_BYTES; }
+    const std::string& getError() const { return error; }
+
+private:
+    static const size_t HEADER_BYTES = 32;
+
+    const char* base;
+    size_t size;
+    uint64_t lsn;
+    bool mapped;
+    std::string copy;       // Backing store when the file could not be mapped
+    std::string error;
+
+    void release();
+};
+
+#endif // WRITE_AHEAD_LOG_H
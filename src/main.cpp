@@ -1,29 +1,32 @@
-#ifdef _WIN32
-#include <winsock2.h>
-#include <ws2tcpip.h>
-#pragma comment(lib, "ws2_32.lib")
-using socket_t = SOCKET;
-#else
-#include <sys/socket.h>
-#include <netinet/in.h>
-#include <unistd.h>
-#include <arpa/inet.h>
-using socket_t = int;
-#define INVALID_SOCKET (-1)
-#define SOCKET_ERROR   (-1)
-#endif
-
 #include "MedicineReminderSystem.h"
+#include "HttpServer.h"
+#include "StaticAssets.h"
+#include "RouteTable.h"
+#include "ReminderDispatcher.h"
+#include "JsonWriter.h"
+#include "BulkImport.h"
+#include "PatientRegistry.h"
+#include "WorkerPool.h"
 #include <iostream>
-#include <fstream>
 #include <sstream>
 #include <cstring>
-#include <thread>
 #include <algorithm>
-void closeSocket(socket_t sock);
+#include <charconv>
+#include <chrono>
+#include <unordered_map>
+
+// Fires scheduled reminders into the due queue as their minute arrives
+ReminderDispatcher reminderDispatcher;
+
+// One Medicine Reminder System per patient, chosen by ?patient=ID (see handleAPI)
+std::unique_ptr<PatientRegistry> patients;
 
-// Global instance of the Medicine Reminder System
-MedicineReminderSystem medicineSystem;
+// Runs the requests that must not hold up an I/O thread (uploads); a few
+// threads are plenty, since an import holds its patient's lock anyway
+WorkerPool workers(4, 32);
+
+// Frontend files, loaded once and served from memory
+StaticAssets staticAssets("public");
 
 // URL decode function
 std::string urlDecode(const std::string& str) {
@@ -45,17 +48,21 @@ std::string urlDecode(const std::string& str) {
     return result;
 }
 
-// Parse POST data
-std::string getPostValue(const std::string& postData, const std::string& key) {
+// Parse POST data (a view straight into the request buffer)
+std::string getPostValue(std::string_view postData, const std::string& key) {
     std::string searchKey = key + "=";
     size_t pos = postData.find(searchKey);
+    // Only match whole field names ("name=" must not match "medicine_name=")
+    while (pos != std::string::npos && pos > 0 && postData[pos - 1] != '&') {
+        pos = postData.find(searchKey, pos + 1);
+    }
     if (pos != std::string::npos) {
         size_t start = pos + searchKey.length();
         size_t end = postData.find("&", start);
         if (end == std::string::npos) {
             end = postData.length();
         }
-        return urlDecode(postData.substr(start, end - start));
+        return urlDecode(std::string(postData.substr(start, end - start)));
     }
     return "";
 }
@@ -89,311 +96,1303 @@ bool safeParseInt(const std::string& str, int& result, int minValue = 0) {
     }
 }
 
-std::string handleAPI(const std::string& path, const std::string& postData) {
-    std::stringstream response;
-    
-    if (path == "/api/status") {
-        response << medicineSystem.getSystemStatus();
+/// API handlers
+
+// Typed access to an API request's form fields: the body first, then the
+// query string, so reads also work as plain GETs. system() is the state of
+// the patient the request is for
+class ApiArgs {
+public:
+    ApiArgs(const HttpRequest& request, Patient& patient) : request(request), patient(patient) {}
+
+    MedicineReminderSystem& system() const { return patient.system; }
+
+    std::string text(const std::string& key) const {
+        std::string value = getPostValue(request.body, key);
+        return value.empty() ? getPostValue(request.query, key) : value;
+    }
+
+    // Parse an integer field; false when missing, malformed or below minValue
+    bool integer(const std::string& key, int& value, int minValue) const {
+        return safeParseInt(text(key), value, minValue);
+    }
+
+    // A query string field only (for requests whose body is data, not a form)
+    std::string queryText(const std::string& key) const {
+        return getPostValue(request.query, key);
+    }
+
+    std::string_view body() const { return request.body; }
+
+private:
+    const HttpRequest& request;
+    Patient& patient;
+};
+
+using ApiHandler = std::string (*)(const ApiArgs& args);
+
+std::string apiStatus(const ApiArgs& args) {
+    return args.system().getSystemStatus();
+}
+
+// Across all patients, unlike everything else here
+std::string apiPatients(const ApiArgs&) {
+    return "Patients loaded: " + std::to_string(patients->patientCount()) + " (" +
+           std::to_string(patients->shardCount()) + " shards)";
+}
+
+std::string apiMemory(const ApiArgs& args) {
+    return args.system().getMemoryStats();
+}
+
+std::string apiCategories(const ApiArgs& args) {
+    return args.system().listCategories();
+}
+
+std::string apiAddCategory(const ApiArgs& args) {
+    std::string category = args.text("category");
+    if (args.system().addCategory(category)) {
+        return "SUCCESS: Category added: " + category;
+    }
+    return "ERROR: Could not add category (may already exist or array full)";
+}
+
+std::string apiRemoveCategory(const ApiArgs& args) {
+    std::string category = args.text("category");
+    if (args.system().removeCategory(category)) {
+        return "SUCCESS: Category removed: " + category;
+    }
+    return "ERROR: Category not found";
+}
+
+std::string apiMedicines(const ApiArgs& args) {
+    return args.system().listAllMedicines();
+}
+
+std::string apiMedicinesByCategory(const ApiArgs& args) {
+    return args.system().listMedicinesByCategory(args.text("category"));
+}
+
+std::string apiAddMedicine(const ApiArgs& args) {
+    std::string name = args.text("name");
+    if (!args.system().addMedicine(name, args.text("dose"), args.text("timings"), args.text("category"))) {
+        return "ERROR: Medicine already exists: " + name;
+    }
+    return "SUCCESS: Medicine added: " + name;
+}
+
+std::string apiDeleteMedicine(const ApiArgs& args) {
+    std::string name = args.text("name");
+    if (args.system().deleteMedicine(name)) {
+        return "SUCCESS: Medicine deleted: " + name;
+    }
+    return "ERROR: Medicine not found";
+}
+
+std::string apiSearchMedicine(const ApiArgs& args) {
+    return args.system().searchMedicine(args.text("name"));
+}
+
+// Autocomplete: ?prefix=as[&limit=N] returns the first N (default 10, at most
+// 100) medicines whose names start with prefix, ignoring case, in name order
+const int SUGGEST_DEFAULT_LIMIT = 10;
+const int SUGGEST_MAX_LIMIT = 100;
+
+static bool suggestMedicines(const ApiArgs& args, std::vector<MedicineRecord>& out, std::string& error) {
+    int limit = SUGGEST_DEFAULT_LIMIT;
+    if (!args.text("limit").empty() && !args.integer("limit", limit, 1)) {
+        error = "Invalid limit (must be at least 1)";
+        return false;
+    }
+    args.system().suggestMedicines(args.text("prefix"), static_cast<size_t>(std::min(limit, SUGGEST_MAX_LIMIT)), out);
+    return true;
+}
+
+std::string apiSuggest(const ApiArgs& args) {
+    std::vector<MedicineRecord> matches;
+    std::string error;
+    if (!suggestMedicines(args, matches, error)) {
+        return "ERROR: " + error;
+    }
+    std::string result;
+    for (const MedicineRecord& med : matches) {
+        result += med.name;
+        result += '\n';
+    }
+    return result.empty() ? "No medicines start with: " + args.text("prefix") : result;
+}
+
+std::string apiScheduleReminder(const ApiArgs& args) {
+    std::string medicine = args.text("medicine");
+    std::string time = args.text("time");
+    if (!args.system().scheduleReminder(medicine, time)) {
+        return "ERROR: Invalid time (use HH:MM, 00:00-23:59)";
+    }
+    return "SUCCESS: Reminder scheduled for " + medicine + " at " + time;
+}
+
+// Optional from/to (HH:MM) restrict the listing to a window; from > to wraps past midnight
+std::string apiReminders(const ApiArgs& args) {
+    std::string from = args.text("from");
+    std::string to = args.text("to");
+    if (from.empty() && to.empty()) {
+        return args.system().viewScheduledReminders();
+    }
+    int fromMinute = 0;
+    int toMinute = ReminderScheduler::MINUTES_PER_DAY - 1;
+    if ((!from.empty() && !ReminderNode::parseTime(from, fromMinute)) ||
+        (!to.empty() && !ReminderNode::parseTime(to, toMinute))) {
+        return "ERROR: Invalid time (use HH:MM, 00:00-23:59)";
+    }
+    return args.system().viewRemindersBetween(fromMinute, toMinute);
+}
+
+std::string apiNextReminder(const ApiArgs& args) {
+    return "Next Reminder: " + args.system().getNextReminder();
+}
+
+std::string apiReminderQueue(const ApiArgs& args) {
+    return args.system().viewReminderQueue();
+}
+
+std::string apiMarkTaken(const ApiArgs& args) {
+    if (!args.system().markReminderTaken()) {
+        return "ERROR: No due reminders to mark as taken";
+    }
+    return "SUCCESS: Reminder marked as taken";
+}
+
+std::string apiDeleteReminder(const ApiArgs& args) {
+    if (args.system().deleteReminder(args.text("medicine"), args.text("time"))) {
+        return "SUCCESS: Reminder deleted";
+    }
+    return "ERROR: Reminder not found";
+}
+
+std::string apiUndo(const ApiArgs& args) {
+    if (args.system().undo()) {
+        return "SUCCESS: Last action undone";
+    }
+    return "ERROR: No actions to undo";
+}
+
+std::string apiRedo(const ApiArgs& args) {
+    if (args.system().redo()) {
+        return "SUCCESS: Action redone";
+    }
+    return "ERROR: No actions to redo";
+}
+
+std::string apiHistory(const ApiArgs& args) {
+    return args.system().viewActionHistory();
+}
+
+std::string apiAddMedicineWithStock(const ApiArgs& args) {
+    std::string name = args.text("name");
+    int stock, threshold;
+    if (!args.integer("stock", stock, 0)) {
+        return "ERROR: Invalid stock quantity (must be a non-negative number)";
+    }
+    if (!args.integer("threshold", threshold, 1)) {
+        return "ERROR: Invalid threshold (must be a positive number)";
+    }
+    if (!args.system().addMedicineWithStock(name, args.text("dose"), args.text("timings"),
+                                             args.text("category"), stock, threshold)) {
+        return "ERROR: Medicine already exists: " + name;
     }
-    else if (path == "/api/categories") {
-        response << medicineSystem.listCategories();
+    return "SUCCESS: Medicine added with stock: " + name + " (Stock: " + std::to_string(stock) + ")";
+}
+
+std::string apiUpdateStock(const ApiArgs& args) {
+    std::string name = args.text("name");
+    int quantity;
+    if (!args.integer("quantity", quantity, 0)) {
+        return "ERROR: Invalid quantity (must be a non-negative number)";
+    }
+    if (args.system().updateStock(name, quantity)) {
+        return "SUCCESS: Stock updated for " + name + " to " + std::to_string(quantity);
+    }
+    return "ERROR: Medicine not found";
+}
+
+std::string apiDecreaseStock(const ApiArgs& args) {
+    std::string name = args.text("name");
+    int quantity;
+    if (!args.integer("quantity", quantity, 1)) {
+        return "ERROR: Invalid quantity (must be a positive number)";
     }
-    else if (path == "/api/add_category") {
-        std::string category = getPostValue(postData, "category");
-        if (medicineSystem.addCategory(category)) {
-            response << "SUCCESS: Category added: " << category;
+    if (args.system().decreaseStock(name, quantity)) {
+        return "SUCCESS: Stock decreased for " + name + " by " + std::to_string(quantity);
+    }
+    return "ERROR: Medicine not found or insufficient stock";
+}
+
+std::string apiStockLevels(const ApiArgs& args) {
+    return args.system().viewStockLevels();
+}
+
+std::string apiLowStockAlerts(const ApiArgs& args) {
+    return args.system().getLowStockAlerts();
+}
+
+std::string apiCheckStock(const ApiArgs& args) {
+    return args.system().checkStockAvailable(args.text("name")) ? "Stock Available" : "Out of Stock";
+}
+
+/// batch
+
+// One operation per line of the body, each form-encoded like the single
+// endpoint's fields plus op=<endpoint>:
+//   op=update_stock&name=Aspirin&quantity=40
+//   op=decrease_stock&name=Ibuprofen&quantity=2
+//   op=schedule_reminder&medicine=Aspirin&time=08:00
+// Allowed ops: add_medicine, add_medicine_with_stock, update_stock,
+// decrease_stock, schedule_reminder, delete_reminder.
+static bool parseBatchLine(std::string_view line, Action& out, std::string& error) {
+    std::string op = getPostValue(line, "op");
+    if (op == "add_medicine" || op == "add_medicine_with_stock") {
+        bool withStock = op == "add_medicine_with_stock";
+        MedicineRecord med{getPostValue(line, "name"), getPostValue(line, "dose"), getPostValue(line, "timings"),
+                           getPostValue(line, "category"), 0, 0};
+        if (med.name.empty()) {
+            error = "name is required";
+            return false;
+        }
+        if (withStock && !safeParseInt(getPostValue(line, "stock"), med.stockQuantity, 0)) {
+            error = "Invalid stock quantity (must be a non-negative number)";
+            return false;
+        }
+        if (withStock && !safeParseInt(getPostValue(line, "threshold"), med.lowStockThreshold, 1)) {
+            error = "Invalid threshold (must be a positive number)";
+            return false;
+        }
+        out = AddMedicineAction{std::make_unique<MedicineRecord>(std::move(med)), withStock};
+        return true;
+    }
+    if (op == "update_stock" || op == "decrease_stock") {
+        std::string name = getPostValue(line, "name");
+        bool update = op == "update_stock";
+        int quantity;
+        if (!safeParseInt(getPostValue(line, "quantity"), quantity, update ? 0 : 1)) {
+            error = update ? "Invalid quantity (must be a non-negative number)"
+                           : "Invalid quantity (must be a positive number)";
+            return false;
+        }
+        if (update) {
+            out = UpdateStockAction{std::move(name), 0, quantity};
         } else {
-            response << "ERROR: Could not add category (may already exist or array full)";
+            out = DecreaseStockAction{std::move(name), quantity};
         }
+        return true;
     }
-    else if (path == "/api/remove_category") {
-        std::string category = getPostValue(postData, "category");
-        if (medicineSystem.removeCategory(category)) {
-            response << "SUCCESS: Category removed: " << category;
+    if (op == "schedule_reminder" || op == "delete_reminder") {
+        ReminderRecord reminder{getPostValue(line, "medicine"), getPostValue(line, "time")};
+        int minute;
+        if (!ReminderNode::parseTime(reminder.time, minute)) {
+            error = "Invalid time (use HH:MM, 00:00-23:59)";
+            return false;
+        }
+        if (op == "schedule_reminder") {
+            out = ScheduleReminderAction{std::move(reminder)};
         } else {
-            response << "ERROR: Category not found";
+            out = DeleteReminderAction{std::move(reminder)};
         }
+        return true;
     }
-    else if (path == "/api/medicines") {
-        response << medicineSystem.listAllMedicines();
+    error = op.empty() ? "op is required" : "Unknown op: " + op;
+    return false;
+}
+
+// Why the system refused a well-formed operation, worded like the single endpoint
+static std::string batchRefusal(std::string_view line) {
+    std::string op = getPostValue(line, "op");
+    if (op == "add_medicine" || op == "add_medicine_with_stock") {
+        return "Medicine already exists: " + getPostValue(line, "name");
     }
-    else if (path == "/api/medicines_by_category") {
-        std::string category = getPostValue(postData, "category");
-        response << medicineSystem.listMedicinesByCategory(category);
+    if (op == "update_stock") {
+        return "Medicine not found";
     }
-    else if (path == "/api/add_medicine") {
-        std::string name = getPostValue(postData, "name");
-        std::string dose = getPostValue(postData, "dose");
-        std::string timings = getPostValue(postData, "timings");
-        std::string category = getPostValue(postData, "category");
-        medicineSystem.addMedicine(name, dose, timings, category);
-        response << "SUCCESS: Medicine added: " << name;
+    if (op == "decrease_stock") {
+        return "Medicine not found or insufficient stock";
     }
-    else if (path == "/api/delete_medicine") {
-        std::string name = getPostValue(postData, "name");
-        if (medicineSystem.deleteMedicine(name)) {
-            response << "SUCCESS: Medicine deleted: " << name;
-        } else {
-            response << "ERROR: Medicine not found";
+    return "Reminder not found";
+}
+
+// Every line is parsed and checked before anything is applied; the batch
+// then goes through as one change (one lock, one undo entry, one log
+// record) or not at all
+std::string apiBatch(const ApiArgs& args) {
+    std::string_view body = args.body();
+    std::vector<std::string_view> lines;
+    std::vector<Action> actions;
+    while (!body.empty()) {
+        size_t end = std::min(body.find('\n'), body.size());
+        std::string_view line = body.substr(0, end);
+        body.remove_prefix(std::min(end + 1, body.size()));
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
         }
+        if (line.empty()) {
+            continue;
+        }
+        std::string error;
+        actions.emplace_back();
+        if (!parseBatchLine(line, actions.back(), error)) {
+            return "ERROR: Operation " + std::to_string(actions.size()) + ": " + error + "; nothing was applied";
+        }
+        lines.push_back(line);
     }
-    else if (path == "/api/search_medicine") {
-        std::string name = getPostValue(postData, "name");
-        response << medicineSystem.searchMedicine(name);
+    if (actions.empty()) {
+        return "ERROR: Empty batch (one operation per line)";
     }
-    else if (path == "/api/schedule_reminder") {
-        std::string medicine = getPostValue(postData, "medicine");
-        std::string time = getPostValue(postData, "time");
-        medicineSystem.scheduleReminder(medicine, time);
-        response << "SUCCESS: Reminder scheduled for " << medicine << " at " << time;
+
+    size_t count = actions.size();
+    size_t failedAt = 0;
+    if (!args.system().applyBatch(std::move(actions), failedAt)) {
+        return "ERROR: Operation " + std::to_string(failedAt + 1) + " (" + getPostValue(lines[failedAt], "op") +
+               "): " + batchRefusal(lines[failedAt]) + "; nothing was applied";
     }
-    else if (path == "/api/reminders") {
-        response << medicineSystem.viewScheduledReminders();
+    return "SUCCESS: Batch applied: " + std::to_string(count) + " operations";
+}
+
+// POST /api/import?type=medicines|reminders&format=csv|ndjson with the file
+// as the body. Rows are streamed straight into the system; bad rows are
+// reported by line and skipped, the rest go in
+static bool importBody(const ApiArgs& args, ImportReport& report, std::string& error) {
+    std::string type = args.queryText("type");
+    std::string format = args.queryText("format");
+    if (type != "medicines" && type != "reminders") {
+        error = "type must be medicines or reminders";
+        return false;
+    }
+    if (!format.empty() && format != "csv" && format != "ndjson") {
+        error = "format must be csv or ndjson";
+        return false;
+    }
+    BulkImporter importer(args.system(), type == "medicines" ? ImportKind::Medicines : ImportKind::Reminders,
+                          format == "ndjson" ? ImportFormat::Ndjson : ImportFormat::Csv);
+    std::string_view body = args.body();
+    importer.feed(body.data(), body.size());
+    report = importer.finish();
+    if (report.rows == 0) {
+        error = "No rows to import";
+        return false;
     }
-    else if (path == "/api/next_reminder") {
-        response << "Next Reminder: " << medicineSystem.getNextReminder();
+    return true;
+}
+
+std::string apiImport(const ApiArgs& args) {
+    ImportReport report;
+    std::string error;
+    if (!importBody(args, report, error)) {
+        return "ERROR: " + error;
     }
-    else if (path == "/api/reminder_queue") {
-        response << medicineSystem.viewReminderQueue();
+    std::string result = report.imported > 0 ? "SUCCESS: Imported " : "ERROR: Imported ";
+    result += std::to_string(report.imported) + " of " + std::to_string(report.rows) + " rows";
+    for (const std::string& line : report.errors) {
+        result += "\n" + line;
     }
-    else if (path == "/api/mark_taken") {
-        medicineSystem.markReminderTaken();
-        response << "SUCCESS: Reminder marked as taken";
+    if (report.failed > report.errors.size()) {
+        result += "\n... and " + std::to_string(report.failed - report.errors.size()) + " more";
     }
-    else if (path == "/api/delete_reminder") {
-        std::string medicine = getPostValue(postData, "medicine");
-        std::string time = getPostValue(postData, "time");
-        if (medicineSystem.deleteReminder(medicine, time)) {
-            response << "SUCCESS: Reminder deleted";
-        } else {
-            response << "ERROR: Reminder not found";
+    return result;
+}
+
+// Every API endpoint: the only place a route needs to be added.
+// Reads accept GET and POST (the UI posts lookup fields); mutations are POST only.
+// SLOW routes run on the worker pool instead of the I/O thread (runOnWorker).
+constexpr unsigned READ = METHOD_GET | METHOD_POST;
+constexpr unsigned WRITE = METHOD_POST;
+constexpr unsigned SLOW = 1u << 8;
+
+constexpr Route<ApiHandler> API_ROUTES[] = {
+    {"/api/status",                  READ,  apiStatus},
+    {"/api/categories",              READ,  apiCategories},
+    {"/api/add_category",            WRITE, apiAddCategory},
+    {"/api/remove_category",         WRITE, apiRemoveCategory},
+    {"/api/medicines",               READ,  apiMedicines},
+    {"/api/medicines_by_category",   READ,  apiMedicinesByCategory},
+    {"/api/add_medicine",            WRITE, apiAddMedicine},
+    {"/api/delete_medicine",         WRITE, apiDeleteMedicine},
+    {"/api/search_medicine",         READ,  apiSearchMedicine},
+    {"/api/suggest",                 READ,  apiSuggest},
+    {"/api/schedule_reminder",       WRITE, apiScheduleReminder},
+    {"/api/reminders",               READ,  apiReminders},
+    {"/api/next_reminder",           READ,  apiNextReminder},
+    {"/api/reminder_queue",          READ,  apiReminderQueue},
+    {"/api/mark_taken",              WRITE, apiMarkTaken},
+    {"/api/delete_reminder",         WRITE, apiDeleteReminder},
+    {"/api/undo",                    WRITE, apiUndo},
+    {"/api/redo",                    WRITE, apiRedo},
+    {"/api/history",                 READ,  apiHistory},
+    {"/api/batch",                   WRITE, apiBatch},
+    {"/api/import",                  WRITE | SLOW, apiImport},
+    {"/api/add_medicine_with_stock", WRITE, apiAddMedicineWithStock},
+    {"/api/update_stock",            WRITE, apiUpdateStock},
+    {"/api/decrease_stock",          WRITE, apiDecreaseStock},
+    {"/api/stock_levels",            READ,  apiStockLevels},
+    {"/api/low_stock_alerts",        READ,  apiLowStockAlerts},
+    {"/api/check_stock",             READ,  apiCheckStock},
+    {"/api/memory",                  READ,  apiMemory},
+    {"/api/patients",                READ,  apiPatients},
+};
+
+constexpr auto API_TABLE = makeRouteTable(API_ROUTES);
+
+/// JSON API (v2)
+
+// Same operations as above under /api/v2/, answered in JSON so clients do
+// not have to parse display text. Lists are {"count": n, "items": [...]};
+// mutations answer {"ok": true, "message": ...} or {"ok": false, "error": ...}.
+using JsonHandler = void (*)(const ApiArgs& args, JsonWriter& json);
+
+// Item fields a list can be cut down to with ?fields=a,b; bit i of a field
+// mask selects entry i
+const char* const MEDICINE_FIELDS[] = {"name", "dose", "timings", "category", "stock", "threshold", "lowStock"};
+const char* const REMINDER_FIELDS[] = {"medicine", "time"};
+const char* const HISTORY_FIELDS[] = {"type", "details"};
+const uint32_t ALL_FIELDS = ~0u;
+
+static void writeMedicine(JsonWriter& json, const MedicineRecord& med, uint32_t fields) {
+    json.beginObject();
+    if (fields & 1u << 0) json.field("name", med.name);
+    if (fields & 1u << 1) json.field("dose", med.dose);
+    if (fields & 1u << 2) json.field("timings", med.timings);
+    if (fields & 1u << 3) json.field("category", med.category);
+    if (fields & 1u << 4) json.field("stock", med.stockQuantity);
+    if (fields & 1u << 5) json.field("threshold", med.lowStockThreshold);
+    if (fields & 1u << 6) json.field("lowStock", med.stockQuantity <= med.lowStockThreshold);
+    json.endObject();
+}
+
+static void writeReminder(JsonWriter& json, const ReminderRecord& reminder, uint32_t fields) {
+    json.beginObject();
+    if (fields & 1u << 0) json.field("medicine", reminder.medicineName);
+    if (fields & 1u << 1) json.field("time", reminder.time);
+    json.endObject();
+}
+
+static void writeHistory(JsonWriter& json, const HistoryRecord& record, uint32_t fields) {
+    json.beginObject();
+    if (fields & 1u << 0) json.field("type", record.type);
+    if (fields & 1u << 1) json.field("details", record.details);
+    json.endObject();
+}
+
+template <typename Record, typename Writer>
+static void writeList(JsonWriter& json, const std::vector<Record>& items, uint32_t fields, Writer write) {
+    json.beginObject().field("count", items.size()).key("items").beginArray();
+    for (const Record& item : items) {
+        write(json, item, fields);
+    }
+    json.endArray().endObject();
+}
+
+/// paging
+
+// ?limit=N&after=CURSOR&fields=a,b on the big lists. Without limit the whole
+// list is returned. With it, "next" is the cursor for the following page
+// (null on the last one); cursors are snapshot keys, so they survive inserts
+// and deletes between pages, and a page costs a binary search plus its own
+// items however long the list is.
+struct ListQuery {
+    size_t limit = SIZE_MAX;
+    bool paged = false;         // limit or after given
+    uint64_t after = 0;
+    bool hasAfter = false;
+    uint32_t fields = ALL_FIELDS;
+};
+
+// Parse fields=a,b against the endpoint's field names
+template <size_t N>
+static bool parseFields(const std::string& list, const char* const (&names)[N], uint32_t& mask, std::string& error) {
+    if (list.empty()) {
+        mask = ALL_FIELDS;
+        return true;
+    }
+    mask = 0;
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t comma = std::min(list.find(',', start), list.size());
+        std::string_view name(list.data() + start, comma - start);
+        size_t i = 0;
+        while (i < N && name != names[i]) i++;
+        if (i == N) {
+            error = "Unknown field: " + std::string(name);
+            return false;
         }
+        mask |= 1u << i;
+        start = comma + 1;
     }
-    else if (path == "/api/undo") {
-        if (medicineSystem.undo()) {
-        response << "SUCCESS: Last action undone";
+    return true;
+}
 
-        }else {
-            response << "ERROR: No actions to undo";
+template <size_t N>
+static bool parseListQuery(const ApiArgs& args, const char* const (&names)[N], ListQuery& query, std::string& error) {
+    std::string limit = args.text("limit");
+    if (!limit.empty()) {
+        int value = 0;
+        if (!safeParseInt(limit, value, 1)) {
+            error = "Invalid limit (must be at least 1)";
+            return false;
+        }
+        query.limit = static_cast<size_t>(value);
+        query.paged = true;
+    }
+    std::string after = args.text("after");
+    if (!after.empty()) {
+        auto result = std::from_chars(after.data(), after.data() + after.size(), query.after);
+        if (result.ec != std::errc() || result.ptr != after.data() + after.size()) {
+            error = "Invalid cursor";
+            return false;
         }
+        query.hasAfter = true;
+        query.paged = true;
     }
-    else if (path == "/api/history") {
-        response << medicineSystem.viewActionHistory();
+    return parseFields(args.text("fields"), names, query.fields, error);
+}
+
+static void writeError(JsonWriter& json, std::string_view error) {
+    json.beginObject().field("ok", false).field("error", error).endObject();
+}
+
+template <typename Record, typename Writer>
+static void writePage(JsonWriter& json, const SnapshotPart<Record>& part, const ListQuery& query, Writer write) {
+    size_t total = part.items.size();
+    size_t begin = query.hasAfter ? part.indexAfter(query.after) : 0;
+    size_t end = begin + std::min(query.limit, total - begin);
+
+    json.beginObject().field("count", end - begin).field("total", total).key("items").beginArray();
+    for (size_t i = begin; i < end; i++) {
+        write(json, part.items[i], query.fields);
     }
-    else if (path == "/api/add_medicine_with_stock") {
-        std::string name = getPostValue(postData, "name");
-        std::string dose = getPostValue(postData, "dose");
-        std::string timings = getPostValue(postData, "timings");
-        std::string category = getPostValue(postData, "category");
-        int stock, threshold;
-        
-        if (!safeParseInt(getPostValue(postData, "stock"), stock, 0)) {
-            response << "ERROR: Invalid stock quantity (must be a non-negative number)";
-        } else if (!safeParseInt(getPostValue(postData, "threshold"), threshold, 1)) {
-            response << "ERROR: Invalid threshold (must be a positive number)";
+    json.endArray();
+    if (query.paged) {
+        // A string: keys use all 64 bits, more than a JSON number keeps exactly
+        json.key("next");
+        if (end < total) {
+            char digits[24];
+            auto result = std::to_chars(digits, digits + sizeof(digits), part.keys[end - 1]);
+            json.value(std::string_view(digits, result.ptr - digits));
         } else {
-            medicineSystem.addMedicineWithStock(name, dose, timings, category, stock, threshold);
-            response << "SUCCESS: Medicine added with stock: " << name << " (Stock: " << stock << ")";
+            json.null();
         }
     }
-    else if (path == "/api/update_stock") {
-        std::string name = getPostValue(postData, "name");
-        int quantity;
-        
-        if (!safeParseInt(getPostValue(postData, "quantity"), quantity, 0)) {
-            response << "ERROR: Invalid quantity (must be a non-negative number)";
-        } else if (medicineSystem.updateStock(name, quantity)) {
-            response << "SUCCESS: Stock updated for " << name << " to " << quantity;
-        } else {
-            response << "ERROR: Medicine not found";
+    json.endObject();
+}
+
+// A paged, projectable listing of one snapshot
+template <typename Record, size_t N, typename Writer>
+static void writeSnapshotList(const ApiArgs& args, JsonWriter& json, const char* const (&names)[N],
+                              const SnapshotPart<Record>& part, Writer write) {
+    ListQuery query;
+    std::string error;
+    if (!parseListQuery(args, names, query, error)) {
+        writeError(json, error);
+        return;
+    }
+    writePage(json, part, query, write);
+}
+
+void jsonStatus(const ApiArgs& args, JsonWriter& json) {
+    SystemCounts counts = args.system().getCounts();
+    json.beginObject()
+        .field("categoryCount", counts.categories)
+        .field("medicineCount", counts.medicines)
+        .field("reminderCount", counts.reminders)
+        .field("queuedCount", counts.queued)
+        .field("historyCount", counts.history)
+        .field("lowStockCount", counts.lowStock)
+        .endObject();
+}
+
+void jsonPatients(const ApiArgs&, JsonWriter& json) {
+    json.beginObject()
+        .field("patients", patients->patientCount())
+        .field("shards", patients->shardCount())
+        .endObject();
+}
+
+void jsonCategories(const ApiArgs& args, JsonWriter& json) {
+    std::vector<std::string> categories;
+    args.system().copyCategories(categories);
+    writeList(json, categories, ALL_FIELDS, [](JsonWriter& out, const std::string& category, uint32_t) {
+        out.value(category);
+    });
+}
+
+void jsonMedicines(const ApiArgs& args, JsonWriter& json) {
+    writeSnapshotList(args, json, MEDICINE_FIELDS, *args.system().getMedicineRecords(), writeMedicine);
+}
+
+void jsonMedicinesByCategory(const ApiArgs& args, JsonWriter& json) {
+    std::vector<MedicineRecord> medicines;
+    args.system().copyMedicinesInCategory(args.text("category"), medicines);
+    writeList(json, medicines, ALL_FIELDS, writeMedicine);
+}
+
+void jsonSearchMedicine(const ApiArgs& args, JsonWriter& json) {
+    MedicineRecord med;
+    json.beginObject();
+    if (args.system().findMedicine(args.text("name"), med)) {
+        json.field("found", true).key("medicine");
+        writeMedicine(json, med, ALL_FIELDS);
+    } else {
+        json.field("found", false);
+    }
+    json.endObject();
+}
+
+// fields=name trims each match to its name
+void jsonSuggest(const ApiArgs& args, JsonWriter& json) {
+    std::vector<MedicineRecord> matches;
+    uint32_t fields = ALL_FIELDS;
+    std::string error;
+    if (!parseFields(args.text("fields"), MEDICINE_FIELDS, fields, error) ||
+        !suggestMedicines(args, matches, error)) {
+        writeError(json, error);
+        return;
+    }
+    writeList(json, matches, fields, writeMedicine);
+}
+
+void jsonStockLevels(const ApiArgs& args, JsonWriter& json) {
+    // Same snapshot as the medicine list; fields=name,stock trims it to stock
+    writeSnapshotList(args, json, MEDICINE_FIELDS, *args.system().getMedicineRecords(), writeMedicine);
+}
+
+void jsonLowStockAlerts(const ApiArgs& args, JsonWriter& json) {
+    std::vector<MedicineRecord> medicines;
+    args.system().copyLowStock(medicines);
+    writeList(json, medicines, ALL_FIELDS, writeMedicine);
+}
+
+void jsonCheckStock(const ApiArgs& args, JsonWriter& json) {
+    json.beginObject().field("available", args.system().checkStockAvailable(args.text("name"))).endObject();
+}
+
+void jsonReminders(const ApiArgs& args, JsonWriter& json) {
+    std::string from = args.text("from");
+    std::string to = args.text("to");
+    if (from.empty() && to.empty()) {
+        writeSnapshotList(args, json, REMINDER_FIELDS, *args.system().getReminderRecords(), writeReminder);
+        return;
+    }
+    // A window is already bounded by the clock; it can be projected but not paged
+    ListQuery query;
+    std::string error;
+    if (!parseListQuery(args, REMINDER_FIELDS, query, error)) {
+        writeError(json, error);
+        return;
+    }
+    if (query.paged) {
+        writeError(json, "limit/after cannot be combined with from/to");
+        return;
+    }
+    int fromMinute = 0;
+    int toMinute = ReminderScheduler::MINUTES_PER_DAY - 1;
+    if ((!from.empty() && !ReminderNode::parseTime(from, fromMinute)) ||
+        (!to.empty() && !ReminderNode::parseTime(to, toMinute))) {
+        writeError(json, "Invalid time (use HH:MM, 00:00-23:59)");
+        return;
+    }
+    std::vector<ReminderRecord> reminders;
+    args.system().copyRemindersBetween(fromMinute, toMinute, reminders);
+    writeList(json, reminders, query.fields, writeReminder);
+}
+
+void jsonNextReminder(const ApiArgs& args, JsonWriter& json) {
+    ReminderRecord next;
+    bool tomorrow = false;
+    json.beginObject();
+    if (args.system().findNextReminder(next, tomorrow)) {
+        json.field("medicine", next.medicineName).field("time", next.time).field("tomorrow", tomorrow);
+    } else {
+        json.key("medicine").null();
+    }
+    json.endObject();
+}
+
+void jsonReminderQueue(const ApiArgs& args, JsonWriter& json) {
+    writeSnapshotList(args, json, REMINDER_FIELDS, *args.system().getQueueRecords(), writeReminder);
+}
+
+void jsonHistory(const ApiArgs& args, JsonWriter& json) {
+    writeSnapshotList(args, json, HISTORY_FIELDS, *args.system().getHistoryRecords(), writeHistory);
+}
+
+void jsonImport(const ApiArgs& args, JsonWriter& json) {
+    ImportReport report;
+    std::string error;
+    if (!importBody(args, report, error)) {
+        writeError(json, error);
+        return;
+    }
+    json.beginObject()
+        .field("ok", report.imported > 0)
+        .field("rows", report.rows)
+        .field("imported", report.imported)
+        .field("failed", report.failed)
+        .key("errors")
+        .beginArray();
+    for (const std::string& line : report.errors) {
+        json.value(line);
+    }
+    json.endArray().endObject();
+}
+
+// Mutations reuse the text handlers: "SUCCESS: ..." / "ERROR: ..." become ok + message/error
+template <ApiHandler handler>
+void jsonCommand(const ApiArgs& args, JsonWriter& json) {
+    std::string result = handler(args);
+    std::string_view text(result);
+    bool ok = text.compare(0, 9, "SUCCESS: ") == 0;
+    if (ok) {
+        text.remove_prefix(9);
+    } else if (text.compare(0, 7, "ERROR: ") == 0) {
+        text.remove_prefix(7);
+    }
+    json.beginObject().field("ok", ok).field(ok ? "message" : "error", text).endObject();
+}
+
+constexpr Route<JsonHandler> API_V2_ROUTES[] = {
+    {"/api/v2/status",                  READ,  jsonStatus},
+    {"/api/v2/patients",                READ,  jsonPatients},
+    {"/api/v2/categories",              READ,  jsonCategories},
+    {"/api/v2/add_category",            WRITE, jsonCommand<apiAddCategory>},
+    {"/api/v2/remove_category",         WRITE, jsonCommand<apiRemoveCategory>},
+    {"/api/v2/medicines",               READ,  jsonMedicines},
+    {"/api/v2/medicines_by_category",   READ,  jsonMedicinesByCategory},
+    {"/api/v2/add_medicine",            WRITE, jsonCommand<apiAddMedicine>},
+    {"/api/v2/delete_medicine",         WRITE, jsonCommand<apiDeleteMedicine>},
+    {"/api/v2/search_medicine",         READ,  jsonSearchMedicine},
+    {"/api/v2/suggest",                 READ,  jsonSuggest},
+    {"/api/v2/schedule_reminder",       WRITE, jsonCommand<apiScheduleReminder>},
+    {"/api/v2/reminders",               READ,  jsonReminders},
+    {"/api/v2/next_reminder",           READ,  jsonNextReminder},
+    {"/api/v2/reminder_queue",          READ,  jsonReminderQueue},
+    {"/api/v2/mark_taken",              WRITE, jsonCommand<apiMarkTaken>},
+    {"/api/v2/delete_reminder",         WRITE, jsonCommand<apiDeleteReminder>},
+    {"/api/v2/undo",                    WRITE, jsonCommand<apiUndo>},
+    {"/api/v2/redo",                    WRITE, jsonCommand<apiRedo>},
+    {"/api/v2/history",                 READ,  jsonHistory},
+    {"/api/v2/batch",                   WRITE, jsonCommand<apiBatch>},
+    {"/api/v2/import",                  WRITE | SLOW, jsonImport},
+    {"/api/v2/add_medicine_with_stock", WRITE, jsonCommand<apiAddMedicineWithStock>},
+    {"/api/v2/update_stock",            WRITE, jsonCommand<apiUpdateStock>},
+    {"/api/v2/decrease_stock",          WRITE, jsonCommand<apiDecreaseStock>},
+    {"/api/v2/stock_levels",            READ,  jsonStockLevels},
+    {"/api/v2/low_stock_alerts",        READ,  jsonLowStockAlerts},
+    {"/api/v2/check_stock",             READ,  jsonCheckStock},
+};
+
+constexpr auto API_V2_TABLE = makeRouteTable(API_V2_ROUTES);
+
+// Resolve a route and check the method; on failure sets the status and
+// returns nullptr with error describing why
+template <typename Handler, size_t N>
+const Route<Handler>* findRoute(const RouteTable<Handler, N>& table, const HttpRequest& request,
+                                HttpResponse& response, const char*& error) {
+    const Route<Handler>* route = table.find(request.path);
+    if (route == nullptr) {
+        response.status = "404 Not Found";
+        error = "Unknown API endpoint";
+        return nullptr;
+    }
+    if ((route->methods & methodFlag(request.method)) == 0) {
+        response.status = "405 Method Not Allowed";
+        response.headers += route->methods & METHOD_GET ? "Allow: GET, POST\r\n" : "Allow: POST\r\n";
+        error = "Method not allowed";
+        return nullptr;
+    }
+    return route;
+}
+
+/// patients
+
+// The patient a request is for: ?patient=ID in the query string (whatever
+// the body holds), or the default patient without one. Only a change
+// (create) brings a new patient into being: reads of an ID never seen get
+// 404. The patient is not necessarily loaded yet (loadPatient). On failure
+// sets the status and returns nullptr with error describing why
+static Patient* findPatient(const HttpRequest& request, bool create, HttpResponse& response, const char*& error) {
+    PatientRegistry::Lookup result;
+    Patient* patient = patients->lookup(getPostValue(request.query, "patient"), create, result);
+    switch (result) {
+    case PatientRegistry::Lookup::Found:
+        break;
+    case PatientRegistry::Lookup::Invalid:
+        response.status = "400 Bad Request";
+        error = "Invalid patient ID";
+        break;
+    case PatientRegistry::Lookup::Unknown:
+        response.status = "404 Not Found";
+        error = "Unknown patient";
+        break;
+    case PatientRegistry::Lookup::Full:
+        response.status = "503 Service Unavailable";
+        error = "Too many patients";
+        break;
+    }
+    return patient;
+}
+
+// Replay the patient's snapshot and log if that has not happened yet: a
+// no-op once loaded, disk work the first time, so requests for a patient not
+// yet loaded run on the worker pool. False with the status set if its data
+// cannot be loaded
+static bool loadPatient(Patient& patient, HttpResponse& response, const char*& error) {
+    if (patients->load(patient)) {
+        return true;
+    }
+    response.status = "503 Service Unavailable";
+    error = "Patient data unavailable";
+    return false;
+}
+
+static const char* const READ_ONLY_ERROR = "Changes cannot be saved (the log cannot be written); data is read-only";
+
+// A change is only acknowledged once it is logged. After a log failure the
+// patient's data is read-only, so mutations get 503: refused up front, or
+// in place of the answer to the one that was in flight
+static bool changeRefused(unsigned methods, const Patient& patient, HttpResponse& response, const char*& error) {
+    if ((methods & METHOD_GET) != 0 || !patient.system.isReadOnly()) {
+        return false;
+    }
+    response.status = "503 Service Unavailable";
+    error = READ_ONLY_ERROR;
+    return true;
+}
+
+// Handlers run under a DeferredCommit, so a change is applied and logged
+// without the I/O thread waiting for the disk. Its answer is held back (the
+// connection waits) until the log's commit thread reports the record
+// durable, and becomes a 503 if it never gets there
+static void answerWhenDurable(DeferredCommit& commit, HttpResponse& response, bool json) {
+    if (!commit.pending()) {
+        return;
+    }
+    auto pending = std::make_shared<PendingResponse>();
+    HttpResponse answer = std::move(response);
+    response = HttpResponse();
+    response.pending = pending;
+    commit.then([pending, answer, json](bool durable) mutable {
+        if (!durable) {
+            answer.status = "503 Service Unavailable";
+            answer.body.clear();
+            if (json) {
+                JsonWriter(answer.body).beginObject().field("ok", false).field("error", READ_ONLY_ERROR).endObject();
+            } else {
+                answer.body = std::string("ERROR: ") + READ_ONLY_ERROR;
+            }
+        }
+        pending->complete(std::move(answer));
+    });
+}
+
+/// worker pool
+
+// A request's own copy of what the handlers read (method, path, query and
+// body), for a job that outlives the connection buffer the views point into
+struct DetachedRequest {
+    explicit DetachedRequest(const HttpRequest& source)
+        : method(source.method), path(source.path), query(source.query), body(source.body) {
+        request.method = method;
+        request.target = request.path = path;
+        request.query = query;
+        request.body = body;
+        request.version = "HTTP/1.1";
+    }
+
+    std::string method, path, query, body;
+    HttpRequest request;    // Views into the strings above
+};
+
+// Answer the request with run(request, response) on the worker pool (slow
+// routes, and anything for a patient not loaded yet); the connection waits
+// for it without holding up its I/O thread. The worker has no
+// DeferredCommit, so it waits for the disk itself and the answer is final.
+// False (response untouched) when the pool's queue is full
+template <typename Run>
+static bool runOnWorker(const HttpRequest& request, HttpResponse& response, Run run) {
+    auto detached = std::make_shared<DetachedRequest>(request);
+    auto pending = std::make_shared<PendingResponse>();
+    HttpResponse answer = response;     // Headers set so far
+    bool queued = workers.submit([detached, pending, answer, run]() mutable {
+        run(detached->request, answer);
+        pending->complete(std::move(answer));
+    });
+    if (queued) {
+        response = HttpResponse();
+        response.pending = pending;
+    }
+    return queued;
+}
+
+static const char* const BUSY_ERROR = "Server busy; try again shortly";
+
+// Run a v2 route for patient; the body is the handler's JSON or an error object
+static void runJsonRoute(const Route<JsonHandler>& route, const HttpRequest& request, Patient& patient,
+                         HttpResponse& response) {
+    // One render buffer per thread, reused across requests: after the first
+    // few responses it is big enough and rendering stops allocating
+    thread_local std::string buffer;
+    buffer.clear();
+    JsonWriter json(buffer);
+
+    const char* error = nullptr;
+    if (loadPatient(patient, response, error)) {
+        try {
+            route.handler(ApiArgs(request, patient), json);
+        } catch (const std::exception&) {
+            response.status = "400 Bad Request";
+            error = "Invalid request";
         }
+        changeRefused(route.methods, patient, response, error);
     }
-    else if (path == "/api/decrease_stock") {
-        std::string name = getPostValue(postData, "name");
-        int quantity;
-        
-        if (!safeParseInt(getPostValue(postData, "quantity"), quantity, 1)) {
-            response << "ERROR: Invalid quantity (must be a positive number)";
-        } else if (medicineSystem.decreaseStock(name, quantity)) {
-            response << "SUCCESS: Stock decreased for " << name << " by " << quantity;
-        } else {
-            response << "ERROR: Medicine not found or insufficient stock";
+    if (error != nullptr) {
+        buffer.clear();
+        JsonWriter(buffer).beginObject().field("ok", false).field("error", error).endObject();
+    }
+    response.body.assign(buffer);
+}
+
+void handleJsonAPI(const HttpRequest& request, HttpResponse& response) {
+    response.contentType = "application/json";
+    response.headers = "Cache-Control: no-cache\r\n";
+
+    DeferredCommit commit;
+    const char* error = nullptr;
+    const Route<JsonHandler>* route = findRoute(API_V2_TABLE, request, response, error);
+    Patient* patient = route != nullptr ? findPatient(request, (route->methods & METHOD_GET) == 0, response, error)
+                                        : nullptr;
+    if (patient != nullptr && !changeRefused(route->methods, *patient, response, error)) {
+        if ((route->methods & SLOW) == 0 && PatientRegistry::isLoaded(*patient)) {
+            runJsonRoute(*route, request, *patient, response);
+            answerWhenDurable(commit, response, true);
+            return;
         }
+        if (runOnWorker(request, response, [route, patient](const HttpRequest& detached, HttpResponse& answer) {
+                runJsonRoute(*route, detached, *patient, answer);
+            })) {
+            return;
+        }
+        response.status = "503 Service Unavailable";
+        error = BUSY_ERROR;
     }
-    else if (path == "/api/stock_levels") {
-        response << medicineSystem.viewStockLevels();
+    std::string body;
+    JsonWriter(body).beginObject().field("ok", false).field("error", error).endObject();
+    response.body = std::move(body);
+}
+
+/// live events
+
+// Answer with the patient's event stream, loading the patient first
+static void openStream(Patient& patient, HttpResponse& response) {
+    const char* error = nullptr;
+    if (!loadPatient(patient, response, error)) {
+        response.body = std::string("ERROR: ") + error;
+        return;
     }
-    else if (path == "/api/low_stock_alerts") {
-        response << medicineSystem.getLowStockAlerts();
+    response.contentType = "text/event-stream";
+    response.headers = "Cache-Control: no-cache\r\nX-Accel-Buffering: no\r\n";
+    response.body = "retry: 2000\n\n";    // How soon EventSource reconnects (e.g. after eviction)
+    response.stream = patient.events;
+}
+
+// GET /api/events: a Server-Sent Events stream of changes as they happen
+void handleEvents(const HttpRequest& request, HttpResponse& response) {
+    if (methodFlag(request.method) != METHOD_GET) {
+        response.status = "405 Method Not Allowed";
+        response.contentType = "text/plain";
+        response.headers = "Allow: GET\r\n";
+        response.body = "ERROR: Method not allowed";
+        return;
     }
-    else if (path == "/api/check_stock") {
-        std::string name = getPostValue(postData, "name");
-        if (medicineSystem.checkStockAvailable(name)) {
-            response << "Stock Available";
-        } else {
-            response << "Out of Stock";
+    const char* error = nullptr;
+    response.contentType = "text/plain";
+    Patient* patient = findPatient(request, false, response, error);
+    if (patient == nullptr) {
+        response.body = std::string("ERROR: ") + error;
+        return;
+    }
+    if (PatientRegistry::isLoaded(*patient)) {
+        openStream(*patient, response);
+    } else if (!runOnWorker(request, response, [patient](const HttpRequest&, HttpResponse& answer) {
+                   openStream(*patient, answer);
+               })) {
+        response.status = "503 Service Unavailable";
+        response.body = std::string("ERROR: ") + BUSY_ERROR;
+    }
+}
+
+// More events than this from one change (a big batch) go out as a single
+// "refresh", so a burst cannot overrun every client's buffer at once
+constexpr size_t MAX_EVENTS_PER_CHANGE = 256;
+
+// Change listener: each event goes to every client of the patient's
+// /api/events stream as one JSON line
+void publishChanges(EventHub& hub, const std::vector<ChangeEvent>& events) {
+    // Within one change (a batch) only a medicine's final stock level is
+    // news, followed by low_stock if it went low on the way and stayed there
+    struct StockSummary {
+        size_t last = 0;
+        bool crossed = false;
+    };
+    std::unordered_map<std::string_view, StockSummary> stock;
+    size_t stockEvents = 0;
+    for (size_t i = 0; i < events.size(); i++) {
+        if (events[i].kind == ChangeKind::StockChanged) {
+            stock[events[i].medicine].last = i;
+            stockEvents++;
+        } else if (events[i].kind == ChangeKind::LowStock) {
+            stock[events[i].medicine].crossed = true;
+            stockEvents++;
         }
     }
-    else {
-        response << "ERROR: Unknown API endpoint";
+    if (events.size() - stockEvents + stock.size() * 2 > MAX_EVENTS_PER_CHANGE) {
+        hub.publish("refresh", "{}");
+        return;
     }
-    
-    return response.str();
-}
-
-// Read file content
-std::string readFile(const std::string& filename) {
-    std::ifstream file(filename);
-    if (!file.is_open()) return "<h1>File not found</h1>";
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    return buffer.str();
-}
-
-// Handle HTTP request
-void handleRequest(socket_t clientSocket) {
-    char buffer[4096] = {0};
-#ifdef _WIN32
-    int bytesRead = recv(clientSocket, buffer, sizeof(buffer), 0);
-#else
-    ssize_t bytesRead = read(clientSocket, buffer, sizeof(buffer));
-#endif
-    if (bytesRead <= 0) {
-        closeSocket(clientSocket);
+
+    thread_local std::string buffer;
+    for (size_t i = 0; i < events.size(); i++) {
+        const ChangeEvent& event = events[i];
+        if (event.kind == ChangeKind::LowStock ||
+            (event.kind == ChangeKind::StockChanged && stock[event.medicine].last != i)) {
+            continue;
+        }
+        bool lowStock = event.kind == ChangeKind::StockChanged && stock[event.medicine].crossed &&
+                        event.stock <= event.threshold;
+        buffer.clear();
+        JsonWriter json(buffer);
+        json.beginObject();
+        const char* name = "";
+        switch (event.kind) {
+        case ChangeKind::ReminderDue:
+        case ChangeKind::ReminderTaken:
+            name = event.kind == ChangeKind::ReminderDue ? "reminder_due" : "reminder_taken";
+            json.field("medicine", event.medicine).field("time", event.time);
+            break;
+        case ChangeKind::StockChanged:
+        case ChangeKind::LowStock:
+            name = "stock";
+            json.field("medicine", event.medicine)
+                .field("stock", event.stock)
+                .field("threshold", event.threshold)
+                .field("lowStock", event.stock <= event.threshold);
+            break;
+        case ChangeKind::Undo:
+        case ChangeKind::Redo:
+            name = event.kind == ChangeKind::Undo ? "undo" : "redo";
+            json.field("type", event.action.type).field("details", event.action.details);
+            break;
+        }
+        json.endObject();
+        hub.publish(name, buffer);
+        if (lowStock) {
+            hub.publish("low_stock", buffer);
+        }
+    }
+}
+
+// Run a text route for patient; the body is the handler's text or an ERROR: line
+static void runApiRoute(const Route<ApiHandler>& route, const HttpRequest& request, Patient& patient,
+                        HttpResponse& response) {
+    const char* error = nullptr;
+    if (!loadPatient(patient, response, error)) {
+        response.body = std::string("ERROR: ") + error;
         return;
     }
-    
-    std::string request(buffer, bytesRead);
-    std::istringstream iss(request);
-    std::string method, path, version;
-    iss >> method >> path >> version;
-    
-    std::string response;
-    std::string contentType = "text/html";
-    std::string body;
-    
-    // Extract POST data if present
-    std::string postData;
-    size_t bodyPos = request.find("\r\n\r\n");
-    if (bodyPos != std::string::npos) {
-        postData = request.substr(bodyPos + 4);
+    try {
+        response.body = route.handler(ApiArgs(request, patient));
+    } catch (const std::exception&) {
+        // e.g. a malformed time reaching std::stoi; never take the server thread down
+        response.status = "400 Bad Request";
+        response.body = "ERROR: Invalid request";
     }
-    
-    if (path == "/" || path == "/index.html") {
-        body = readFile("public/index.html");
+    if (changeRefused(route.methods, patient, response, error)) {
+        response.body = std::string("ERROR: ") + error;
+    }
+}
+
+// Dispatch an /api/ request through the compile-time route table
+void handleAPI(const HttpRequest& request, HttpResponse& response) {
+    if (request.path == "/api/events") {
+        handleEvents(request, response);
+        return;
     }
-    else if (path == "/style.css") {
-        body = readFile("public/style.css");
-        contentType = "text/css";
+    if (request.path.substr(0, 8) == "/api/v2/") {
+        handleJsonAPI(request, response);
+        return;
     }
-    else if (path == "/script.js") {
-        body = readFile("public/script.js");
-        contentType = "application/javascript";
+
+    response.contentType = "text/plain";
+    response.headers = "Cache-Control: no-cache\r\n";
+
+    DeferredCommit commit;
+    const char* error = nullptr;
+    const Route<ApiHandler>* route = findRoute(API_TABLE, request, response, error);
+    Patient* patient = route != nullptr ? findPatient(request, (route->methods & METHOD_GET) == 0, response, error)
+                                        : nullptr;
+    if (patient == nullptr || changeRefused(route->methods, *patient, response, error)) {
+        response.body = std::string("ERROR: ") + error;
+        return;
     }
-    else if (path.find("/api/") == 0) {
-        body = handleAPI(path, postData);
-        contentType = "text/plain";
+    if ((route->methods & SLOW) == 0 && PatientRegistry::isLoaded(*patient)) {
+        runApiRoute(*route, request, *patient, response);
+        answerWhenDurable(commit, response, false);
+    } else if (!runOnWorker(request, response, [route, patient](const HttpRequest& detached, HttpResponse& answer) {
+                   runApiRoute(*route, detached, *patient, answer);
+               })) {
+        response.status = "503 Service Unavailable";
+        response.body = std::string("ERROR: ") + BUSY_ERROR;
     }
+}
+
+// Handle HTTP request: runs on the server's I/O threads for each complete request
+HttpResponse handleRequest(const HttpRequest& request) {
+    std::string_view path = request.path;
+    HttpResponse response;
     
-    else {
-        body = "<h1>404 Not Found</h1>";
+    if (path.substr(0, 5) == "/api/") {
+        handleAPI(request, response);
+    }
+    else if (!staticAssets.serve(request, response)) {
+        response.status = "404 Not Found";
+        response.body = "<h1>404 Not Found</h1>";
     }
     
-    response = "HTTP/1.1 200 OK\r\n";
-    response += "Content-Type: " + contentType + "\r\n";
-    response += "Content-Length: " + std::to_string(body.length()) + "\r\n";
-    response += "Cache-Control: no-cache\r\n";
-    response += "\r\n";
-    response += body;
-    
-#ifdef _WIN32
-    send(clientSocket, response.c_str(), static_cast<int>(response.length()), 0);
-#else
-    send(clientSocket, response.c_str(), response.length(), 0);
-#endif
-    
-    closeSocket(clientSocket);
+    return response;
 }
 
-void closeSocket(socket_t sock) {
-#ifdef _WIN32
-    closesocket(sock);
-#else
-    close(sock);
-#endif
-}
+// --import: load each file into the persisted state and report per file
+struct ImportFile {
+    ImportKind kind;
+    std::string path;
+    std::string patient;    // Empty: the default patient
+};
 
-bool startupSockets() {
-#ifdef _WIN32
-    WSADATA wsaData;
-    return WSAStartup(MAKEWORD(2, 2), &wsaData) == 0;
-#else
-    return true; // No init needed on UNIX
-#endif
+static int runImports(const std::vector<ImportFile>& imports) {
+    int status = 0;
+    for (const ImportFile& file : imports) {
+        const std::string& path = file.path;
+        Patient* patient = patients->find(file.patient, true);
+        if (patient == nullptr) {
+            std::cerr << path << ": patient " << file.patient << " is unavailable\n";
+            status = 1;
+            continue;
+        }
+        ImportReport report;
+        auto start = std::chrono::steady_clock::now();
+        if (!BulkImporter::importFile(patient->system, file.kind, path, report)) {
+            std::cerr << path << ": cannot open\n";
+            status = 1;
+            continue;
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << path << ": imported " << report.imported << " of " << report.rows << " rows in "
+                  << static_cast<long long>(seconds * 1000) << " ms ("
+                  << static_cast<long long>(seconds > 0 ? report.rows / seconds : 0) << " rows/s)\n";
+        for (const std::string& line : report.errors) {
+            std::cout << "  " << line << "\n";
+        }
+        if (report.failed > report.errors.size()) {
+            std::cout << "  ... and " << report.failed - report.errors.size() << " more\n";
+        }
+        if (report.failed > 0) {
+            status = 1;
+        }
+        if (patient->system.isReadOnly()) {
+            std::cerr << path << ": the log cannot be written; stopping\n";
+            return 1;
+        }
+    }
+    return status;
 }
 
-void cleanupSockets() {
-#ifdef _WIN32
-    WSACleanup();
-#endif
-}
+int main(int argc, char** argv) {
+    // --import medicines|reminders FILE (repeatable): import and exit
+    // without serving. CSV, or NDJSON for .ndjson / .jsonl files.
+    // --patient ID sends the imports after it to that patient
+    std::vector<ImportFile> imports;
+    std::string patient;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--patient" && i + 1 < argc && PatientRegistry::validId(argv[i + 1])) {
+            patient = argv[++i];
+            continue;
+        }
+        std::string type = i + 2 < argc ? argv[i + 1] : "";
+        if (arg != "--import" || (type != "medicines" && type != "reminders")) {
+            std::cerr << "Usage: " << argv[0] << " [[--patient ID] --import medicines|reminders FILE]...\n";
+            return 1;
+        }
+        imports.push_back({type == "medicines" ? ImportKind::Medicines : ImportKind::Reminders, argv[i + 2], patient});
+        i += 2;
+    }
 
-int main() {
     if (!startupSockets()) {
         std::cerr << "Socket startup failed\n";
         return 1;
     }
     
-    socket_t serverSocket = socket(AF_INET, SOCK_STREAM, 0);
-    if (serverSocket == INVALID_SOCKET) {
-        std::cerr << "Failed to create socket\n";
-        cleanupSockets();
-        return 1;
+    // Rebuild the default patient from its snapshot and log before the
+    // first request can see it; the others load on their first request
+    PatientConfig patientConfig;
+    patientConfig.wal.path = "medlogix.wal";
+    patientConfig.wal.groupCommitUs = 2000;
+    patientConfig.wal.snapshotPath = "medlogix.snap";
+    patientConfig.wal.snapshotEvery = 50000;
+    patients = std::make_unique<PatientRegistry>(patientConfig, reminderDispatcher, [](Patient& patient) {
+        EventHub& hub = *patient.events;
+        patient.system.setChangeListener([&hub](const std::vector<ChangeEvent>& events) {
+            publishChanges(hub, events);
+        });
+    });
+    if (!patients->open()) {
+        std::cerr << "Continuing without persistence: changes will be lost on restart\n";
     }
     
-    int opt = 1;
-#ifdef _WIN32
-    setsockopt(serverSocket, SOL_SOCKET, SO_REUSEADDR, (const char*)&opt, sizeof(opt));
-#else
-    setsockopt(serverSocket, SOL_SOCKET, SO_REUSEADDR | SO_REUSEPORT, &opt, sizeof(opt));
-#endif
-    
-    sockaddr_in address{};
-    address.sin_family = AF_INET;
-    address.sin_addr.s_addr = INADDR_ANY;
-    address.sin_port = htons(5000);
-    
-    if (bind(serverSocket, (sockaddr*)&address, sizeof(address)) == SOCKET_ERROR) {
-        std::cerr << "Bind failed\n";
-        closeSocket(serverSocket);
+    if (!imports.empty()) {
+        int status = runImports(imports);
+        patients->close();
         cleanupSockets();
-        return 1;
+        return status;
     }
     
-    if (listen(serverSocket, 10) == SOCKET_ERROR) {
-        std::cerr << "Listen failed\n";
-        closeSocket(serverSocket);
+    ServerConfig config;
+    config.port = 5000;
+    config.uploadPaths = {"/api/import", "/api/v2/import"};
+    HttpServer server(config, handleRequest);
+    if (!server.start()) {
         cleanupSockets();
         return 1;
     }
+    stopOnSignals();   // Ctrl+C / SIGTERM: run() returns and the logs close below
+    
+    reminderDispatcher.start();
+    workers.start();
+    staticAssets.start();
     
     std::cout << "=== Medicine Reminder System Server ===\n";
-    std::cout << "Server running on http://0.0.0.0:5000\n";
+    std::cout << "Server running on http://0.0.0.0:" << config.port << "\n";
     std::cout << "Data structures implemented:\n";
     std::cout << "  • Array (Category Manager)\n";
-    std::cout << "  • Linked List (Medicine Manager)\n";
-    std::cout << "  • Binary Search Tree (Reminder Scheduler)\n";
-    std::cout << "  • Queue (Reminder Queue)\n";
-    std::cout << "  • Stack (Undo Manager)\n\n";
+    std::cout << "  • Linked List + Hash Index + Prefix Index + Low-Stock Set (Medicine Manager)\n";
+    std::cout << "  • Timing Wheel + Occupancy Bitmap (Reminder Scheduler)\n";
+    std::cout << "  • Lock-Free Ring (Reminder Queue)\n";
+    std::cout << "  • Ring Buffer of Compact Actions + Redo Stack (Undo Manager)\n";
+    std::cout << "  • Write-Ahead Log + Snapshots (Persistence)\n";
+    std::cout << "  • Sharded Hash Map (Patient Registry)\n\n";
     
-    while (true) {
-        socket_t clientSocket = accept(serverSocket, nullptr, nullptr);
-        if (clientSocket != INVALID_SOCKET) {
-            std::thread(handleRequest, clientSocket).detach();
-        }
-    }
+    server.run();
     
-    closeSocket(serverSocket);
+    std::cout << "Shutting down: writing snapshots\n";
+    staticAssets.stop();
+    workers.stop();
+    reminderDispatcher.stop();
+    patients->close();
     cleanupSockets();
     return 0;
 }
@@ -461,7 +461,7 @@ async function viewQueue() {
 }
 
 async function markTaken() {
-    const result = await apiCall('/api/mark_taken');
+    const result = await apiCall('/api/mark_taken', {});
     const isSuccess = result.includes('SUCCESS');
     showToast(isSuccess ? 'Marked medicine as taken' : result, isSuccess ? 'success' : 'error');
     if (isSuccess) {
@@ -500,7 +500,7 @@ async function viewHistory() {
 }
 
 async function undoAction() {
-    const result = await apiCall('/api/undo');
+    const result = await apiCall('/api/undo', {});
     const isSuccess = result.includes('SUCCESS');
     showToast(isSuccess ? 'Undone last action' : result, isSuccess ? 'success' : 'error');
     if (isSuccess) {
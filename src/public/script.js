@@ -147,6 +147,26 @@ async function resetSearch() {
   showToast('Search reset to show all medicines');
 }
 
+// Autocomplete the search box from the server's prefix index; a slower
+// answer to an earlier keystroke is dropped
+let suggestRequest = 0;
+document.getElementById('searchName').addEventListener('input', async function() {
+  const prefix = this.value.trim();
+  const request = ++suggestRequest;
+  const list = document.getElementById('searchSuggestions');
+  if (!prefix) {
+    list.replaceChildren();
+    return;
+  }
+  const result = await apiJson(`/api/v2/suggest?fields=name&prefix=${encodeURIComponent(prefix)}`);
+  if (request !== suggestRequest || !result || !result.items) return;
+  list.replaceChildren(...result.items.map(item => {
+    const option = document.createElement('option');
+    option.value = item.name;
+    return option;
+  }));
+});
+
 // Optional: trigger search on pressing Enter key inside input box
 document.getElementById('searchName').addEventListener('keyup', function(event) {
   if (event.key === 'Enter') {
@@ -156,6 +176,15 @@ document.getElementById('searchName').addEventListener('keyup', function(event)
 
 
 
+// Open the page with ?patient=ID to work on that patient's records; every
+// API request carries it along (the server keeps each patient separately)
+const patientId = new URLSearchParams(location.search).get('patient');
+
+function patientUrl(endpoint) {
+  if (!patientId) return endpoint;
+  return `${endpoint}${endpoint.includes('?') ? '&' : '?'}patient=${encodeURIComponent(patientId)}`;
+}
+
 // Helper: API call
 async function apiCall(endpoint, data = null) {
   try {
@@ -164,13 +193,28 @@ async function apiCall(endpoint, data = null) {
       options.body = new URLSearchParams(data);
       options.headers['Content-Type'] = 'application/x-www-form-urlencoded';
     }
-    const response = await fetch(endpoint, options);
+    const response = await fetch(patientUrl(endpoint), options);
     return await response.text();
   } catch (error) {
     return `ERROR: ${error.message}`;
   }
 }
 
+// Helper: JSON API call (/api/v2/...); null when the request or the parse fails
+async function apiJson(endpoint, data = null) {
+  try {
+    const options = { method: data ? 'POST' : 'GET', headers: {} };
+    if (data) {
+      options.body = new URLSearchParams(data);
+      options.headers['Content-Type'] = 'application/x-www-form-urlencoded';
+    }
+    const response = await fetch(patientUrl(endpoint), options);
+    return await response.json();
+  } catch (error) {
+    return null;
+  }
+}
+
 // Toast notification
 function showToast(message, type = 'success') {
   const toast = document.getElementById('toast');
@@ -180,78 +224,47 @@ function showToast(message, type = 'success') {
 }
 
 async function updateStatus() {
-  const statusText = await apiCall('/api/status');
-  try {
-    const lines = statusText.split('\n');
-    let categories = 0, medicines = 0, reminders = 0, lowStock = 0;
-
-    lines.forEach(line => {
-      if (line.startsWith('Categories:')) {
-        categories = parseInt(line.split(':')[1].trim()) || 0;
-      } else if (line.startsWith('Medicines:')) {
-        medicines = parseInt(line.split(':')[1].trim()) || 0;
-      } else if (line.startsWith('Scheduled Reminders:')) {
-        reminders = parseInt(line.split(':')[1].trim()) || 0;
-      } else if (line.startsWith('Queued Reminders:')) {
-        // Optionally include queued reminders count if suitable
-      }
-      // No low stock line given, so lowStock remains 0 here
-    });
-
-    document.getElementById('categoryCount').textContent = categories;
-    document.getElementById('medicineCount').textContent = medicines;
-    document.getElementById('reminderCount').textContent = reminders;
-    document.getElementById('lowStockCount').textContent = lowStock;
-  } catch {
-    document.getElementById('categoryCount').textContent = '0';
-    document.getElementById('medicineCount').textContent = '0';
-    document.getElementById('reminderCount').textContent = '0';
-    document.getElementById('lowStockCount').textContent = '0';
-  }
+  const status = await apiJson('/api/v2/status');
+  document.getElementById('categoryCount').textContent = status ? status.categoryCount : 0;
+  document.getElementById('medicineCount').textContent = status ? status.medicineCount : 0;
+  document.getElementById('reminderCount').textContent = status ? status.reminderCount : 0;
+  document.getElementById('lowStockCount').textContent = status ? status.lowStockCount : 0;
 }
 
 
 // ------------ Category functions ------------
 
 async function updateCategoryList() {
-  const categoriesRaw = await apiCall('/api/categories');
+  const categories = await apiJson('/api/v2/categories');
   const list = document.getElementById('categoryList');
 
-  if (!categoriesRaw || categoriesRaw.toLowerCase().includes('error')) {
+  if (!categories || !categories.items) {
     list.innerHTML = '<p style="color: var(--muted);">Error loading categories.</p>';
     return;
   }
 
-  // Parse lines for categories numbered list
-  const lines = categoriesRaw.trim().split('\n').filter(line => /^\d+\./.test(line));
-  if (lines.length === 0) {
+  if (categories.items.length === 0) {
     list.innerHTML = '<p style="color: var(--muted);">No categories yet.</p>';
-    return;
-  }
-
-  list.innerHTML = lines.map(line => {
-    const category = line.replace(/^\d+\.\s*/, '').trim();
-    return `
+  } else {
+    list.innerHTML = categories.items.map((category, idx) => `
       <div class="list-item">
-        <span>${line}</span>
+        <span>${idx + 1}. ${category}</span>
         <button class="list-item-btn" onclick="removeCategory('${category}')">🗑️</button>
       </div>
-    `;
-  }).join('');
+    `).join('');
+  }
 
-  updateCategoryDropdowns(categoriesRaw);
+  updateCategoryDropdowns(categories.items);
 }
 
-function updateCategoryDropdowns(categoryText) {
-  const lines = categoryText.split('\n').filter(line => line.match(/^\d+\./))
-                .map(line => line.replace(/^\d+\.\s*/, '').trim());
+function updateCategoryDropdowns(categories) {
   ['medicineCategory', 'filterCategory'].forEach(id => {
     const select = document.getElementById(id);
     if (!select) return;
     const currentVal = select.value;
     select.innerHTML = '<option value="">Select category</option>' +
-      lines.map(cat => `<option value="${cat}">${cat}</option>`).join('');
-    if(lines.includes(currentVal)) select.value = currentVal;
+      categories.map(cat => `<option value="${cat}">${cat}</option>`).join('');
+    if(categories.includes(currentVal)) select.value = currentVal;
   });
 }
 
@@ -288,50 +301,37 @@ async function removeCategory(name) {
 // ------------ Medicine functions ------------
 
 async function updateMedicineList() {
-  const medicinesRaw = await apiCall('/api/medicines');
+  const medicines = await apiJson('/api/v2/medicines');
   const list = document.getElementById('medicineList');
 
-  if (!medicinesRaw || medicinesRaw.toLowerCase().includes('error')) {
+  if (!medicines || !medicines.items) {
     list.innerHTML = '<p style="color: var(--muted);">Error loading medicines.</p>';
     return;
   }
 
-  // Parse medicines multiline
-  const lines = medicinesRaw.trim().split('\n').filter(line => /^\d+\./.test(line));
-  if (lines.length === 0) {
+  renderMedicineList(list, medicines.items);
+  updateMedicineDropdowns(medicines.items);
+}
+
+function renderMedicineList(list, medicines) {
+  if (medicines.length === 0) {
     list.innerHTML = '<p style="color: var(--muted);">No medicines found.</p>';
     return;
   }
 
-  list.innerHTML = lines.map(line => {
-    const data = line.replace(/^\d+\.\s*/, '').split('|').map(s => s.trim());
-    const name = data[0] || '';
-    const dose = data[1] ? data[1].replace('Dose: ', '') : '';
-    const timings = data[2] ? data[2].replace('Timings: ', '') : '';
-    const category = data[3] ? data[3].replace('Category: ', '') : '';
-
-    return `
+  list.innerHTML = medicines.map(med => `
       <div class="list-item">
         <div class="list-item-content">
-          <div style="font-weight: 600;">${name}</div>
-          <div style="font-size: 0.75rem; color: var(--muted);">Dose: ${dose} | Timings: ${timings} | Category: ${category}</div>
+          <div style="font-weight: 600;">${med.name}</div>
+          <div style="font-size: 0.75rem; color: var(--muted);">Dose: ${med.dose} | Timings: ${med.timings} | Category: ${med.category}</div>
         </div>
-        <button class="list-item-btn" onclick="deleteMedicine('${name}')">🗑️</button>
+        <button class="list-item-btn" onclick="deleteMedicine('${med.name}')">🗑️</button>
       </div>
-    `;
-  }).join('');
-
-  updateMedicineDropdowns(medicinesRaw);
+    `).join('');
 }
 
-
-
-function updateMedicineDropdowns(medicineText) {
-  const lines = medicineText.split('\n').filter(line => line.trim() !== '' && !line.toLowerCase().startsWith('all medicines'));
-  const names = lines.map(line => {
-    let part = line.replace(/^\d+\.\s*/, '').trim();
-    return part.split('|')[0].trim();
-  });
+function updateMedicineDropdowns(medicines) {
+  const names = medicines.map(med => med.name);
   ['updateStockMedicine', 'decreaseStockMedicine', 'reminderMedicine'].forEach(id => {
     const select = document.getElementById(id);
     if (!select) return;
@@ -382,43 +382,39 @@ async function filterMedicines() {
     updateMedicineList();
     return;
   }
-  const medicines = await apiCall('/api/medicines_by_category', { category });
+  const medicines = await apiJson('/api/v2/medicines_by_category', { category });
   const list = document.getElementById('medicineList');
-  list.textContent = medicines;
-  updateMedicineDropdowns(medicines);
+  if (!medicines || !medicines.items) {
+    list.innerHTML = '<p style="color: var(--muted);">Error loading medicines.</p>';
+    return;
+  }
+  renderMedicineList(list, medicines.items);
+  updateMedicineDropdowns(medicines.items);
 }
 
 // ------------ Stock functions ------------
 
 async function updateStockList() {
   const list = document.getElementById('stockList');
-  const stockData = await apiCall('/api/stock_levels');
+  const stock = await apiJson('/api/v2/stock_levels?fields=name,stock,threshold');
 
-  if (!stockData || stockData.toLowerCase().includes('error')) {
+  if (!stock || !stock.items) {
     list.innerHTML = '<p style="color: var(--muted);">Error loading stock data.</p>';
     return;
   }
 
-  const lines = stockData.trim().split('\n').slice(1); // skip header
-  if (lines.length === 0) {
+  if (stock.items.length === 0) {
     list.innerHTML = '<p style="color: var(--muted);">No stock information available.</p>';
     return;
   }
 
   const LOW_STOCK_THRESHOLD = 15; // fixed value per your requirement
 
-  const htmlItems = lines.map(line => {
-    let cleaned = line.replace(/^\d+\.\s*/, '').trim();
-    let [medPart, rest] = cleaned.split(' - ');
-    if (!rest) return '';
-
-    const stockMatch = rest.match(/Stock:\s*(\d+)/i);
-    const thresholdMatch = rest.match(/Threshold:\s*(\d+)/i);
-    if (!stockMatch || !thresholdMatch) return '';
-
-    const quantity = parseInt(stockMatch[1], 10);
+  const htmlItems = stock.items.map(med => {
+    const medPart = med.name;
+    const quantity = med.stock;
     // threshold still displayed but not used here
-    const threshold = parseInt(thresholdMatch[1], 10);
+    const threshold = med.threshold;
 
     // Determine icon and bar color class based on fixed quantity threshold
     let icon = '📦';
@@ -496,41 +492,20 @@ function fixMojibake(text) {
 
 
 async function updateReminderList() {
-  const remindersRaw = await apiCall('/api/reminders');
+  const reminders = await apiJson('/api/v2/reminders');
   const list = document.getElementById('reminderList');
 
-  if (!remindersRaw || remindersRaw.toLowerCase().includes('error')) {
+  if (!reminders || !reminders.items) {
     list.innerHTML = '<p style="color: var(--muted);">Error loading reminders.</p>';
     return;
   }
 
-  // Split lines and remove the header line which contains "Scheduled Reminders"
-  const lines = remindersRaw.trim().split('\n');
-  if (lines.length === 0) {
+  if (reminders.items.length === 0) {
     list.innerHTML = '<p style="color: var(--muted);">No reminders scheduled.</p>';
     return;
   }
 
-  // Remove first header line
-  if (lines[0].toLowerCase().startsWith('scheduled reminders')) {
-    lines.shift();
-  }
-
-  // Filter lines that start with "- "
-  const reminderLines = lines.filter(line => line.trim().startsWith('- '));
-  if (reminderLines.length === 0) {
-    list.innerHTML = '<p style="color: var(--muted);">No reminders scheduled.</p>';
-    return;
-  }
-
-  list.innerHTML = reminderLines.map((line, idx) => {
-    // Remove leading '- ' and trim
-    const content = line.replace(/^- /, '').trim();
-    const parts = content.split(' - ');
-    const time = parts[0] || '';
-    const medicine = parts[1] || '';
-
-    return `
+  list.innerHTML = reminders.items.map(({ medicine, time }, idx) => `
       <div class="list-item ${idx === 0 ? 'highlight' : ''}">
         <div class="list-item-content">
           <div style="font-weight: 600;">🔔 ${medicine}</div>
@@ -538,8 +513,7 @@ async function updateReminderList() {
         </div>
         <button class="list-item-btn" onclick="deleteReminder('${medicine}', '${time}')">🗑️</button>
       </div>
-    `;
-  }).join('');
+    `).join('');
 }
 
 
@@ -576,26 +550,20 @@ async function deleteReminder(medicine, time) {
 // ------------ Queue functions ------------
 
 async function updateQueueList() {
-  const queueRaw = await apiCall('/api/reminder_queue');
+  const queue = await apiJson('/api/v2/reminder_queue');
   const list = document.getElementById('queueList');
 
-  if (!queueRaw || queueRaw.toLowerCase().includes('error')) {
+  if (!queue || !queue.items) {
     list.innerHTML = '<p style="color: var(--muted);">Error loading queue.</p>';
     return;
   }
 
-  const lines = queueRaw.trim().split('\n').filter(line => /^\d+\./.test(line));
-  if (lines.length === 0) {
+  if (queue.items.length === 0) {
     list.innerHTML = '<p style="color: var(--muted);">Queue is empty.</p>';
     return;
   }
 
-  list.innerHTML = lines.map((line, idx) => {
-    const content = line.replace(/^\d+\.\s*/, '').trim();
-    const parts = content.split(' - ');
-    const time = parts[0] || '';
-    const medicine = parts[1] || '';
-
+  list.innerHTML = queue.items.map(({ medicine, time }, idx) => {
     return `
       <div class="list-item ${idx === 0 ? 'highlight' : ''}">
         <div style="display: flex; align-items: center; gap: 1rem;">
@@ -624,7 +592,7 @@ async function updateQueueList() {
 }
 
 async function markTaken() {
-  const result = await apiCall('/api/mark_taken');
+  const result = await apiCall('/api/mark_taken', {});
   showToast(result, result.includes('SUCCESS') ? 'success' : 'error');
   updateQueueList();
   updateStatus();
@@ -633,22 +601,21 @@ async function markTaken() {
 // ------------ Undo functions ------------
 
 async function updateHistoryList() {
-  const historyRaw = await apiCall('/api/history');
+  const history = await apiJson('/api/v2/history');
   const list = document.getElementById('historyList');
 
-  if (!historyRaw || historyRaw.toLowerCase().includes('error')) {
+  if (!history || !history.items) {
     list.innerHTML = '<p style="color: var(--muted);">Error loading history.</p>';
     return;
   }
 
-  const lines = historyRaw.trim().split('\n').filter(line => /^\d+\./.test(line));
-  if (lines.length === 0) {
+  if (history.items.length === 0) {
     list.innerHTML = '<p style="color: var(--muted);">No history available.</p>';
     return;
   }
 
-  list.innerHTML = lines.map((line, idx) => {
-    const content = line.replace(/^\d+\.\s*/, '').trim();
+  list.innerHTML = history.items.map((record, idx) => {
+    const content = `${record.type} - ${record.details}`;
     return `
       <div class="list-item ${idx === 0 ? 'highlight' : ''}">
         <div class="list-item-content">
@@ -661,14 +628,63 @@ async function updateHistoryList() {
 }
 
 async function undoAction() {
-  const result = await apiCall('/api/undo');
+  const result = await apiCall('/api/undo', {});
+  showToast(result, result.includes('SUCCESS') ? 'success' : 'error');
+  updateHistoryList();
+  updateStatus();
+}
+
+async function redoAction() {
+  const result = await apiCall('/api/redo', {});
   showToast(result, result.includes('SUCCESS') ? 'success' : 'error');
   updateHistoryList();
   updateStatus();
 }
 
+// ------------ Live updates ------------
+
+// Sections to reload on the next tick; a burst of events costs one reload
+const staleSections = new Set();
+let refreshTimer = null;
+
+function refreshLater(...sections) {
+  sections.forEach(section => staleSections.add(section));
+  if (refreshTimer) return;
+  refreshTimer = setTimeout(() => {
+    refreshTimer = null;
+    const active = document.querySelector('.section.active');
+    if (active && staleSections.has(active.id)) {
+      showSection(active.id);
+    } else {
+      updateStatus();
+    }
+    staleSections.clear();
+  }, 20);
+}
+
+// Server-sent events from /api/events: changes made anywhere (other tabs,
+// the reminder clock) show up without polling. EventSource reconnects by itself.
+function subscribeToEvents() {
+  if (!window.EventSource) return;
+  const source = new EventSource(patientUrl('/api/events'));
+  const on = (name, handler) => source.addEventListener(name, event => handler(JSON.parse(event.data)));
+
+  on('reminder_due', reminder => {
+    showToast(`Time to take ${reminder.medicine} (${reminder.time})`);
+    refreshLater('queue');
+  });
+  on('reminder_taken', () => refreshLater('queue'));
+  on('stock', () => refreshLater('stock', 'medicines'));
+  on('low_stock', medicine => showToast(`Low stock: ${medicine.medicine} (${medicine.stock} left)`, 'error'));
+  const everything = () => refreshLater('categories', 'medicines', 'stock', 'reminders', 'queue', 'undo');
+  on('undo', everything);
+  on('redo', everything);
+  on('refresh', everything);
+}
+
 // Initialization on window load
 window.onload = () => {
   updateStatus();
   showSection('categories');
+  subscribeToEvents();
 };
@@ -0,0 +1,45 @@
+#!/bin/sh
+# Clean shutdown: SIGTERM and SIGINT must make the server stop serving, write
+# its final snapshot and exit 0, rather than die with the state only in the log.
+#
+# Usage: tests/shutdown_test.sh path/to/server   (needs curl; uses port 5000)
+set -u
+server="$(cd "$(dirname "$1")" && pwd)/$(basename "$1")"
+url=http://localhost:5000
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+cd "$dir" || exit 1
+
+fail() {
+    echo "FAIL: $*"
+    cat server.log
+    exit 1
+}
+
+for sig in TERM INT; do
+    rm -f medlogix.wal medlogix.snap
+    "$server" > server.log 2>&1 &
+    pid=$!
+    tries=0
+    until curl -s -o /dev/null "$url/api/status"; do
+        tries=$((tries + 1))
+        [ $tries -lt 50 ] || { kill -9 $pid; fail "server did not start"; }
+        sleep 0.1
+    done
+    curl -s -d "name=Aspirin&dose=100mg&timings=08:00&category=Pain" "$url/api/add_medicine" > /dev/null
+
+    kill -$sig $pid
+    tries=0
+    while kill -0 $pid 2> /dev/null; do
+        tries=$((tries + 1))
+        [ $tries -lt 100 ] || { kill -9 $pid; fail "SIG$sig: server did not exit"; }
+        sleep 0.1
+    done
+    wait $pid
+    status=$?
+    [ $status -eq 0 ] || fail "SIG$sig: exit status $status"
+    [ -s medlogix.snap ] || fail "SIG$sig: no snapshot written"
+    grep -q Aspirin medlogix.snap || fail "SIG$sig: snapshot does not hold the change"
+    echo "ok: SIG$sig"
+done
+echo PASS